@@ -24,7 +24,7 @@ int main(){
     for(int i = 0; i < N; i++){
 
         // Add 460Hz wave
-        signal[i] = 700 * sin(2 * M_PI * 460 * i);
+        signal[i] = 700 * sin(2 * M_PI * 460 * i / SAMPLE_RATE);
 
         // Add 58 wave
         signal[i] += 500 * sin(2 * M_PI * 58 * i / SAMPLE_RATE);
@@ -0,0 +1,281 @@
+// chromesthat_bench: runs the FFTW and Q15 analysis backends over the same
+// audio and reports how long each takes per frame and how far apart they are.
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <stdexcept>
+
+#include "analyzer.h"
+#include "analyzer_bank.h"
+#include "config.h"
+
+// Length of the synthesized test signal when no recording is given.
+#define SYNTH_SECONDS 10.0
+// Each synthesized chord lasts this long.
+#define SYNTH_CHORD_SECONDS 0.5
+
+void printUsage(const char *program) {
+    std::cout << "Usage: " << program << " [FILE] [--hop N] [--repeat N] [--OPTION VALUE ...]\n"
+              << "\n  FILE                     16-bit or float WAV, or raw s16 mono at --sample-rate;\n"
+              << "                           without one a chord sequence with noise is synthesized\n"
+              << "  --hop N                  Samples between analysed frames (fft_size / 4)\n"
+              << "  --repeat N               Passes over the audio, for steadier timings (1)\n"
+              << "\nAnalysis options (--config, --fft-size, --sample-rate, --min-freq, --min-magnitude,\n"
+              << "--window, --kaiser-beta, --analysis-bands) are as for chromesthat." << std::endl;
+}
+
+static uint32_t read_u32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24); }
+static uint16_t read_u16(const uint8_t *p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+
+// Reads a WAV file (PCM 16-bit or IEEE float), mixing channels down to mono.
+static std::vector<float> read_wav(const std::vector<uint8_t> &data, int &sample_rate) {
+    int channels = 0;
+    int bits = 0;
+    int format = 0;
+    size_t pos = 12;
+    while (pos + 8 <= data.size()) {
+        uint32_t size = read_u32(&data[pos + 4]);
+        const uint8_t *body = &data[pos + 8];
+        size_t avail = std::min<size_t>(size, data.size() - pos - 8);
+
+        if (std::memcmp(&data[pos], "fmt ", 4) == 0 && avail >= 16) {
+            format = read_u16(body);
+            channels = read_u16(body + 2);
+            sample_rate = static_cast<int>(read_u32(body + 4));
+            bits = read_u16(body + 14);
+            if (format == 0xFFFE && avail >= 26) {
+                format = read_u16(body + 24); // WAVE_FORMAT_EXTENSIBLE: the sub-format's first field
+            }
+        } else if (std::memcmp(&data[pos], "data", 4) == 0) {
+            bool pcm16 = format == 1 && bits == 16;
+            bool float32 = format == 3 && bits == 32;
+            if (channels <= 0 || (!pcm16 && !float32)) {
+                throw std::runtime_error("Error: Only 16-bit PCM and 32-bit float WAV files are supported.");
+            }
+            size_t frame_bytes = static_cast<size_t>(channels) * bits / 8;
+            std::vector<float> samples(avail / frame_bytes);
+            for (size_t i = 0; i < samples.size(); i++) {
+                const uint8_t *frame = body + i * frame_bytes;
+                float sum = 0;
+                for (int c = 0; c < channels; c++) {
+                    if (pcm16) {
+                        sum += static_cast<int16_t>(read_u16(frame + 2 * c)) / 32768.0f;
+                    } else {
+                        uint32_t bits32 = read_u32(frame + 4 * c);
+                        float value;
+                        std::memcpy(&value, &bits32, sizeof(value));
+                        sum += value;
+                    }
+                }
+                samples[i] = sum / channels;
+            }
+            return samples;
+        }
+        pos += 8 + size + (size & 1);
+    }
+    throw std::runtime_error("Error: WAV file has no data chunk.");
+}
+
+// Loads a recording: WAV if it has a RIFF header, otherwise raw s16 mono.
+static std::vector<float> load_audio(const std::string &path, int &sample_rate) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Error: Cannot open '" + path + "'.");
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (data.size() >= 12 && std::memcmp(&data[0], "RIFF", 4) == 0 && std::memcmp(&data[8], "WAVE", 4) == 0) {
+        return read_wav(data, sample_rate);
+    }
+    std::vector<float> samples(data.size() / 2);
+    for (size_t i = 0; i < samples.size(); i++) {
+        samples[i] = static_cast<int16_t>(read_u16(&data[2 * i])) / 32768.0f;
+    }
+    return samples;
+}
+
+// Three-note chords stepping round the circle of fifths, with harmonics and noise.
+static std::vector<float> synthesize(int sample_rate) {
+    std::vector<float> samples(static_cast<size_t>(SYNTH_SECONDS * sample_rate));
+    std::mt19937 rng(1);
+    std::normal_distribution<float> noise(0.0f, 0.003f);
+    const size_t chord_len = static_cast<size_t>(SYNTH_CHORD_SECONDS * sample_rate);
+
+    for (size_t i = 0; i < samples.size(); i++) {
+        int chord = static_cast<int>(i / chord_len);
+        int root = 48 + (chord * 7) % 12;   // MIDI note in the octave above C3
+        double t = static_cast<double>(i) / sample_rate;
+        double s = 0;
+        for (int interval : {0, 4, 7}) {
+            double freq = A4_FREQUENCY * std::pow(2.0, (root + interval - A4_MIDI_NUMBER) / 12.0);
+            for (int h = 1; h <= 3; h++) {
+                s += 0.1 / h * std::sin(2 * M_PI * freq * h * t);
+            }
+        }
+        samples[i] = static_cast<float>(s) + noise(rng);
+    }
+    return samples;
+}
+
+// Builds one backend's analyzer the way chromesthat does.
+static std::unique_ptr<Analyzer> build(const Config &config, double rate, FftBackend backend) {
+    if (config.analysis_bands > 1) {
+        return std::unique_ptr<Analyzer>(new AnalyzerBank(config.fft_size, config.analysis_bands, rate, config.min_freq,
+                                                          config.min_magnitude, config.window, config.kaiser_beta,
+                                                          backend));
+    }
+    return make_analyzer(config.fft_size, rate, config.min_freq, config.min_magnitude,
+                         config.window, config.kaiser_beta, backend);
+}
+
+struct Timing {
+    double total_us = 0;
+    double worst_us = 0;
+
+    void add(std::chrono::steady_clock::duration d) {
+        double us = std::chrono::duration<double, std::micro>(d).count();
+        total_us += us;
+        worst_us = std::max(worst_us, us);
+    }
+};
+
+int main(int argc, char *argv[]) {
+
+    std::vector<std::string> args(argv + 1, argv + argc);
+    std::string path;
+    int hop = 0;
+    int repeat = 1;
+    std::vector<std::string> config_args;
+
+    Config config;
+    try {
+        for (size_t i = 0; i < args.size(); i++) {
+            const std::string &arg = args[i];
+            if (arg == "--help" || arg == "-h") {
+                printUsage(argv[0]);
+                return 0;
+            } else if ((arg == "--hop" || arg == "--repeat") && i + 1 < args.size()) {
+                char *end;
+                long value = std::strtol(args[++i].c_str(), &end, 10);
+                if (*end != '\0' || value < 1) {
+                    throw std::runtime_error("Error: Invalid value '" + args[i] + "' for " + arg + ".");
+                }
+                (arg == "--hop" ? hop : repeat) = static_cast<int>(value);
+            } else if (i == 0 && arg.compare(0, 2, "--") != 0) {
+                path = arg;
+            } else {
+                config_args.push_back(arg);
+            }
+        }
+        config = config_from_args(config_args);
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    try {
+        int sample_rate = config.sample_rate;
+        std::vector<float> audio = path.empty() ? synthesize(sample_rate) : load_audio(path, sample_rate);
+        const int size = config.fft_size;
+        if (hop == 0) {
+            hop = size / 4;
+        }
+        if (audio.size() < static_cast<size_t>(size)) {
+            throw std::runtime_error("Error: The audio is shorter than one FFT window.");
+        }
+
+        std::unique_ptr<Analyzer> fftw = build(config, sample_rate, FFT_BACKEND_FFTW);
+        std::unique_ptr<Analyzer> q15 = build(config, sample_rate, FFT_BACKEND_Q15);
+        const int bins = fftw->num_bins();
+        std::vector<double> ref(bins);
+        std::vector<double> test(bins);
+
+        std::cout << (path.empty() ? std::string("Synthesized chords") : path) << ": "
+                  << audio.size() / static_cast<double>(sample_rate) << " s at " << sample_rate << " Hz, FFT "
+                  << size << (config.analysis_bands > 1 ? " (" + std::to_string(config.analysis_bands) + " bands)" : "")
+                  << ", hop " << hop << ", " << window_name(config.window) << " window." << std::endl;
+
+        Timing fftw_time, q15_time;
+        uint64_t frames = 0;
+        uint64_t peaks_agree = 0;
+        uint64_t notes_agree = 0;
+        uint64_t active_frames = 0;    // Frames where either backend detected a note
+        double worst_error_db = -200;  // Largest bin error relative to the frame's peak
+        double error_power = 0;        // Sum of squared bin errors relative to the peak
+        uint64_t error_bins = 0;
+
+        for (int pass = 0; pass < repeat; pass++) {
+            for (size_t start = 0; start + size <= audio.size(); start += hop) {
+                std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+                fftw->load_samples(audio.data() + start);
+                int ref_peak = fftw->calculate_magnitudes(ref.data());
+                std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+                q15->load_samples(audio.data() + start);
+                int test_peak = q15->calculate_magnitudes(test.data());
+                std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+                fftw_time.add(t1 - t0);
+                q15_time.add(t2 - t1);
+                frames++;
+
+                if (pass > 0) {
+                    continue; // The results are the same every pass
+                }
+
+                float ref_levels[NUM_NOTES], test_levels[NUM_NOTES];
+                double ref_notes[NUM_NOTES], test_notes[NUM_NOTES];
+                int ref_count = fftw->detect_notes(ref.data(), ref_levels, ref_notes);
+                int test_count = q15->detect_notes(test.data(), test_levels, test_notes);
+                peaks_agree += ref_peak == test_peak;
+                if (ref_count > 0 || test_count > 0) {
+                    active_frames++;
+                    notes_agree += std::equal(ref_levels, ref_levels + NUM_NOTES, test_levels);
+                }
+
+                double peak = *std::max_element(ref.begin(), ref.end());
+                if (peak <= 0) {
+                    continue;
+                }
+                for (int i = 0; i < bins; i++) {
+                    double e = (test[i] - ref[i]) / peak;
+                    error_power += e * e;
+                    worst_error_db = std::max(worst_error_db, 20 * std::log10(std::fabs(e) + 1e-12));
+                }
+                error_bins += bins;
+            }
+        }
+
+        if (frames == 0) {
+            throw std::runtime_error("Error: No frames analysed.");
+        }
+        const uint64_t compared = frames / repeat;
+        std::cout << std::fixed << std::setprecision(1)
+                  << "\n          mean us/frame  worst us/frame\n"
+                  << "  fftw    " << std::setw(13) << fftw_time.total_us / frames
+                  << std::setw(16) << fftw_time.worst_us << "\n"
+                  << "  q15     " << std::setw(13) << q15_time.total_us / frames
+                  << std::setw(16) << q15_time.worst_us << "\n"
+                  << "\nOver " << compared << " frames:\n"
+                  << "  RMS magnitude error:  " << (error_bins ? 10 * std::log10(error_power / error_bins + 1e-24) : 0)
+                  << " dB below the frame peak\n"
+                  << "  Worst bin error:      " << worst_error_db << " dB relative to the frame peak\n"
+                  << "  Same strongest bin:   " << 100.0 * peaks_agree / compared << " %\n"
+                  << "  Same notes detected:  "
+                  << (active_frames ? 100.0 * notes_agree / active_frames : 100.0) << " % of "
+                  << active_frames << " frames with notes" << std::endl;
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
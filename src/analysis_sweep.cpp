@@ -0,0 +1,365 @@
+// chromesthat_sweep: runs every combination of FFT size, hop, window and
+// detector engine over the labelled signal corpus and reports note precision
+// and recall against the cost per frame, so analysis settings can be chosen
+// from measured trade-offs.
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "analyzer.h"
+#include "analyzer_bank.h"
+#include "config.h"
+#include "partial_tracker.h"
+#include "signal_corpus.h"
+
+// Categories of corpus signal, in report order.
+static const char *const categories[] = {"single", "chord", "glide", "noise", "drums"};
+#define NUM_CATEGORIES 5
+
+void printUsage(const char *program) {
+    std::cout << "Usage: " << program << " [--LIST-OPTION a,b,...] [--csv] [--OPTION VALUE ...]\n"
+              << "\n  --fft-sizes LIST         FFT sizes to try (1024,2048,4096)\n"
+              << "  --hops LIST              Samples between frames; larger than the FFT is skipped (256,512,1024)\n"
+              << "  --windows LIST           Analysis windows (hann,blackman-harris)\n"
+              << "  --backends LIST          fftw and/or q15 (fftw,q15)\n"
+              << "  --bands LIST             FFT sizes per analysis, as --analysis-bands (1)\n"
+              << "  --detectors LIST         peaks (per-frame detection) and/or tracked (held by the\n"
+              << "                           partial tracker, as chromesthat lights the LEDs) (peaks,tracked)\n"
+              << "  --min-magnitudes LIST    Detection thresholds (--min-magnitude)\n"
+              << "  --csv                    Print CSV instead of a table\n"
+              << "  --write-corpus DIR       Write the corpus as WAV and label files to DIR and exit\n"
+              << "\nOther analysis options (--config, --sample-rate, --min-freq, --kaiser-beta,\n"
+              << "--note-release-ms) are as for chromesthat." << std::endl;
+}
+
+static std::vector<std::string> split_list(const std::string &list) {
+    std::vector<std::string> items;
+    std::stringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    if (items.empty()) {
+        throw std::runtime_error("Error: Empty list '" + list + "'.");
+    }
+    return items;
+}
+
+static std::vector<double> number_list(const std::string &option, const std::string &list) {
+    std::vector<double> values;
+    for (const std::string &item : split_list(list)) {
+        char *end;
+        double value = std::strtod(item.c_str(), &end);
+        if (*end != '\0' || value <= 0) {
+            throw std::runtime_error("Error: Invalid value '" + item + "' for " + option + ".");
+        }
+        values.push_back(value);
+    }
+    return values;
+}
+
+// Builds one analyzer the way chromesthat does.
+static std::unique_ptr<Analyzer> build(int fft_size, int bands, double rate, const Config &config,
+                                       WindowType window, double min_magnitude, FftBackend backend) {
+    if (bands > 1) {
+        return std::unique_ptr<Analyzer>(new AnalyzerBank(fft_size, bands, rate, config.min_freq, min_magnitude,
+                                                          window, config.kaiser_beta, backend));
+    }
+    return make_analyzer(fft_size, rate, config.min_freq, min_magnitude, window, config.kaiser_beta, backend);
+}
+
+// Pitch-class decisions scored against the labels.
+struct Score {
+    uint64_t true_pos = 0;
+    uint64_t false_pos = 0;
+    uint64_t false_neg = 0;
+
+    void add(const Score &other) {
+        true_pos += other.true_pos;
+        false_pos += other.false_pos;
+        false_neg += other.false_neg;
+    }
+    bool empty() const { return true_pos + false_pos + false_neg == 0; }
+    double precision() const { return true_pos + false_pos ? static_cast<double>(true_pos) / (true_pos + false_pos) : 1.0; }
+    double recall() const { return true_pos + false_neg ? static_cast<double>(true_pos) / (true_pos + false_neg) : 1.0; }
+    double f1() const {
+        double p = precision(), r = recall();
+        return p + r > 0 ? 2 * p * r / (p + r) : 0.0;
+    }
+};
+
+struct Setting {
+    int fft_size;
+    int hop;
+    WindowType window;
+    FftBackend backend;
+    int bands;
+    bool tracked;
+    double min_magnitude;
+};
+
+struct Result {
+    Setting setting;
+    Score total;
+    Score by_category[NUM_CATEGORIES];
+    double ns_per_frame;
+    double cpu_percent;     // Of one core, analysing in real time at this hop
+    bool pareto;            // No other setting is both cheaper and at least as accurate
+};
+
+// A pitch class counts where the window lies wholly inside one of its notes and
+// against where the window touches none; frames straddling an onset or release
+// are not scored for that pitch class.
+static Score score_frame(const std::vector<NoteLabel> &labels, double from, double to, const float levels[NUM_NOTES]) {
+    bool required[NUM_NOTES] = {false};
+    bool touched[NUM_NOTES] = {false};
+    for (const NoteLabel &label : labels) {
+        const int pc = label.midi % NUM_NOTES;
+        required[pc] |= label.start <= from && label.end >= to;
+        touched[pc] |= label.start < to && label.end > from;
+    }
+    Score score;
+    for (int pc = 0; pc < NUM_NOTES; pc++) {
+        const bool detected = levels[pc] > 0;
+        if (required[pc]) {
+            (detected ? score.true_pos : score.false_neg)++;
+        } else if (!touched[pc] && detected) {
+            score.false_pos++;
+        }
+    }
+    return score;
+}
+
+static Result run(const Setting &setting, const std::vector<CorpusSignal> &corpus, int sample_rate,
+                  const Config &config) {
+    std::unique_ptr<Analyzer> analyzer = build(setting.fft_size, setting.bands, sample_rate, config, setting.window,
+                                               setting.min_magnitude, setting.backend);
+    std::vector<double> magnitudes(analyzer->num_bins());
+    Result result = {setting, Score(), {}, 0, 0, false};
+    double total_ns = 0;
+    uint64_t frames = 0;
+
+    for (const CorpusSignal &signal : corpus) {
+        PartialTracker tracker(config.note_release_ms, setting.min_magnitude);
+        NoteEvent events[MAX_NOTE_EVENTS];
+        const int length = static_cast<int>(signal.samples.size());
+        const int category = static_cast<int>(std::find(categories, categories + NUM_CATEGORIES, signal.category) -
+                                              categories);
+
+        for (int start = 0; start + setting.fft_size <= length; start += setting.hop) {
+            const double from = static_cast<double>(start) / sample_rate;
+            const double to = static_cast<double>(start + setting.fft_size) / sample_rate;
+            float levels[NUM_NOTES];
+            double note_magnitudes[NUM_NOTES];
+
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+            analyzer->load_samples(signal.samples.data() + start);
+            analyzer->calculate_magnitudes(magnitudes.data());
+            analyzer->detect_notes(magnitudes.data(), levels, note_magnitudes);
+            if (setting.tracked) {
+                float held[NUM_NOTES];
+                tracker.update(magnitudes.data(), analyzer->num_bins(), *analyzer, to, events, MAX_NOTE_EVENTS);
+                tracker.pitch_levels(held);
+                for (int i = 0; i < NUM_NOTES; i++) {
+                    levels[i] = std::max(levels[i], held[i]);
+                }
+            }
+            std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+            total_ns += std::chrono::duration<double, std::nano>(t1 - t0).count();
+            frames++;
+
+            Score score = score_frame(signal.labels, from, to, levels);
+            result.total.add(score);
+            if (category < NUM_CATEGORIES) {
+                result.by_category[category].add(score);
+            }
+        }
+    }
+
+    result.ns_per_frame = frames ? total_ns / frames : 0;
+    result.cpu_percent = result.ns_per_frame * sample_rate / setting.hop / 1e7;
+    return result;
+}
+
+static std::string engine_name(const Setting &s) {
+    return std::string(s.backend == FFT_BACKEND_Q15 ? "q15" : "fftw") + (s.tracked ? "+tracked" : "");
+}
+
+static void print_table(const std::vector<Result> &results) {
+    std::cout << "   fft   hop  window           engine         bands  min_mag   prec recall     F1"
+              << "  single  chord  glide  noise  drums  ns/frame  cpu%\n";
+    for (const Result &r : results) {
+        const Setting &s = r.setting;
+        std::cout << (r.pareto ? '*' : ' ') << std::setw(5) << s.fft_size << std::setw(6) << s.hop << "  "
+                  << std::left << std::setw(17) << window_name(s.window) << std::setw(15) << engine_name(s)
+                  << std::right << std::setw(5) << s.bands << std::setw(9) << std::setprecision(1) << std::fixed
+                  << s.min_magnitude << std::setprecision(3) << std::setw(7) << r.total.precision()
+                  << std::setw(7) << r.total.recall() << std::setw(7) << r.total.f1();
+        for (int c = 0; c < NUM_CATEGORIES; c++) {
+            if (r.by_category[c].empty()) {
+                std::cout << std::setw(7) << "-";
+            } else {
+                std::cout << std::setw(7) << r.by_category[c].f1();
+            }
+        }
+        std::cout << std::setprecision(0) << std::setw(10) << r.ns_per_frame << std::setprecision(2)
+                  << std::setw(6) << r.cpu_percent << "\n";
+    }
+    std::cout << "\n* = Pareto front: no other setting is as accurate (F1) for less CPU.\n"
+              << "Per-category columns are F1; cpu% is one core analysing in real time at that hop." << std::endl;
+}
+
+static void print_csv(const std::vector<Result> &results) {
+    std::cout << "fft_size,hop,window,backend,tracked,bands,min_magnitude,precision,recall,f1";
+    for (int c = 0; c < NUM_CATEGORIES; c++) {
+        std::cout << ",f1_" << categories[c];
+    }
+    std::cout << ",ns_per_frame,cpu_percent,pareto\n";
+    for (const Result &r : results) {
+        const Setting &s = r.setting;
+        std::cout << s.fft_size << ',' << s.hop << ',' << window_name(s.window) << ','
+                  << (s.backend == FFT_BACKEND_Q15 ? "q15" : "fftw") << ',' << s.tracked << ',' << s.bands << ','
+                  << s.min_magnitude << ',' << r.total.precision() << ',' << r.total.recall() << ',' << r.total.f1();
+        for (int c = 0; c < NUM_CATEGORIES; c++) {
+            std::cout << ',';
+            if (!r.by_category[c].empty()) {
+                std::cout << r.by_category[c].f1();
+            }
+        }
+        std::cout << ',' << r.ns_per_frame << ',' << r.cpu_percent << ',' << r.pareto << "\n";
+    }
+    std::cout.flush();
+}
+
+int main(int argc, char *argv[]) {
+
+    std::vector<std::string> args(argv + 1, argv + argc);
+    std::vector<double> fft_sizes = {1024, 2048, 4096};
+    std::vector<double> hops = {256, 512, 1024};
+    std::vector<double> bands = {1};
+    std::vector<double> min_magnitudes;
+    std::vector<WindowType> windows = {WINDOW_HANN, WINDOW_BLACKMAN_HARRIS};
+    std::vector<FftBackend> backends = {FFT_BACKEND_FFTW, FFT_BACKEND_Q15};
+    std::vector<bool> detectors = {false, true};
+    bool csv = false;
+    std::string corpus_dir;
+    std::vector<std::string> config_args;
+
+    Config config;
+    try {
+        for (size_t i = 0; i < args.size(); i++) {
+            const std::string &arg = args[i];
+            const bool has_value = i + 1 < args.size();
+            if (arg == "--help" || arg == "-h") {
+                printUsage(argv[0]);
+                return 0;
+            } else if (arg == "--csv") {
+                csv = true;
+            } else if (arg == "--write-corpus" && has_value) {
+                corpus_dir = args[++i];
+            } else if (arg == "--fft-sizes" && has_value) {
+                fft_sizes = number_list(arg, args[++i]);
+            } else if (arg == "--hops" && has_value) {
+                hops = number_list(arg, args[++i]);
+            } else if (arg == "--bands" && has_value) {
+                bands = number_list(arg, args[++i]);
+            } else if (arg == "--min-magnitudes" && has_value) {
+                min_magnitudes = number_list(arg, args[++i]);
+            } else if (arg == "--windows" && has_value) {
+                windows.clear();
+                for (const std::string &name : split_list(args[++i])) {
+                    windows.push_back(window_from_name(name));
+                }
+            } else if (arg == "--backends" && has_value) {
+                backends.clear();
+                for (const std::string &name : split_list(args[++i])) {
+                    if (name != "fftw" && name != "q15") {
+                        throw std::runtime_error("Error: Unknown backend '" + name + "' (expected fftw or q15).");
+                    }
+                    backends.push_back(name == "q15" ? FFT_BACKEND_Q15 : FFT_BACKEND_FFTW);
+                }
+            } else if (arg == "--detectors" && has_value) {
+                detectors.clear();
+                for (const std::string &name : split_list(args[++i])) {
+                    if (name != "peaks" && name != "tracked") {
+                        throw std::runtime_error("Error: Unknown detector '" + name + "' (expected peaks or tracked).");
+                    }
+                    detectors.push_back(name == "tracked");
+                }
+            } else {
+                config_args.push_back(arg);
+            }
+        }
+        config = config_from_args(config_args);
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (min_magnitudes.empty()) {
+        min_magnitudes.push_back(config.min_magnitude);
+    }
+
+    try {
+        const int sample_rate = config.sample_rate;
+        std::vector<CorpusSignal> corpus = generate_corpus(sample_rate);
+        if (!corpus_dir.empty()) {
+            write_corpus(corpus, sample_rate, corpus_dir);
+            std::cout << "Wrote " << corpus.size() << " signals to " << corpus_dir << "." << std::endl;
+            return 0;
+        }
+
+        std::vector<Result> results;
+        for (double fft_size : fft_sizes)
+            for (double hop : hops)
+                for (WindowType window : windows)
+                    for (FftBackend backend : backends)
+                        for (double band_count : bands)
+                            for (bool tracked : detectors)
+                                for (double min_magnitude : min_magnitudes) {
+                                    if (hop > fft_size) {
+                                        continue;
+                                    }
+                                    Setting setting = {static_cast<int>(fft_size), static_cast<int>(hop), window,
+                                                       backend, static_cast<int>(band_count), tracked, min_magnitude};
+                                    results.push_back(run(setting, corpus, sample_rate, config));
+                                    if (!csv) {
+                                        std::cerr << "\r" << results.size() << " settings measured" << std::flush;
+                                    }
+                                }
+        if (!csv) {
+            std::cerr << std::endl;
+        }
+
+        for (Result &r : results) {
+            r.pareto = std::none_of(results.begin(), results.end(), [&r](const Result &other) {
+                return other.total.f1() >= r.total.f1() && other.ns_per_frame * r.setting.hop <
+                       r.ns_per_frame * other.setting.hop;
+            });
+        }
+        if (csv) {
+            print_csv(results);
+        } else {
+            double seconds = 0;
+            for (const CorpusSignal &signal : corpus) {
+                seconds += static_cast<double>(signal.samples.size()) / sample_rate;
+            }
+            std::cout << "Corpus: " << corpus.size() << " signals, " << std::fixed << std::setprecision(1)
+                      << seconds << " s at " << sample_rate << " Hz.\n" << std::endl;
+            print_table(results);
+        }
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
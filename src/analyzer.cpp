@@ -0,0 +1,197 @@
+#include "analyzer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#include "q15_analyzer.h"
+
+/**
+ * @brief Constructor that allocates the FFT buffers and builds the plan and bin tables.
+ * @param sample_rate Rate of the analysed samples in Hz (after decimation).
+ * @param min_freq Bins below this frequency (Hz) are ignored.
+ * @param min_magnitude Bins must exceed this magnitude to count as a note.
+ * @param window_type Analysis window applied to every frame.
+ * @param kaiser_beta Shape of the Kaiser window (ignored for the others).
+ */
+template <int FFT_SIZE>
+FixedAnalyzer<FFT_SIZE>::FixedAnalyzer(double sample_rate, int min_freq, double min_magnitude,
+                                       WindowType window_type, double kaiser_beta)
+    : bin_hz(sample_rate / FFT_SIZE), min_magnitude(min_magnitude) {
+
+    // For a real input, the input array is of type double
+    fft_in = (double*) fftw_malloc(sizeof(double) * FFT_SIZE);
+    if (!fft_in) {
+        throw std::runtime_error("Error: fftw_malloc for input array failed.");
+    }
+
+    // For a real-to-complex transform (DFT_R2C), the output array size is N/2 + 1 complex numbers
+    fft_out = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * BINS);
+    if (!fft_out) {
+        fftw_free(fft_in);
+        throw std::runtime_error("Error: fftw_malloc for output array failed.");
+    }
+
+    // fftw_malloc gives SIMD alignment, so the windowing loop vectorises like fft_in's
+    window = (double*) fftw_malloc(sizeof(double) * FFT_SIZE);
+    if (!window) {
+        fftw_free(fft_in);
+        fftw_free(fft_out);
+        throw std::runtime_error("Error: fftw_malloc for window failed.");
+    }
+    window_fill(window_type, kaiser_beta, window, FFT_SIZE);
+
+    plan = fftw_plan_dft_r2c_1d(FFT_SIZE, fft_in, fft_out, FFTW_MEASURE);
+    if (!plan) {
+        fftw_free(fft_in);
+        fftw_free(fft_out);
+        fftw_free(window);
+        throw std::runtime_error("Error: fftw_plan_dft_r2c_1d failed.");
+    }
+
+    min_index = std::max(1, static_cast<int>(min_freq * FFT_SIZE / sample_rate));
+
+    // The pitch class of a bin never changes, so look it up once here instead of per frame.
+    for (int i = 0; i < BINS; i++) {
+        double freq = i * bin_hz;
+        bin_note[i] = i > 0 ? static_cast<int8_t>(freq_to_note_index(freq)) : 0;
+    }
+}
+
+template <int FFT_SIZE>
+FixedAnalyzer<FFT_SIZE>::~FixedAnalyzer() {
+    fftw_destroy_plan(plan);
+    fftw_free(fft_in);
+    fftw_free(fft_out);
+    fftw_free(window);
+}
+
+template <int FFT_SIZE>
+void FixedAnalyzer<FFT_SIZE>::load_samples(const float *samples) {
+    // The window is applied while widening to double, so the frame is only touched once.
+    for (int i = 0; i < FFT_SIZE; i++) {
+        fft_in[i] = window[i] * samples[i];
+    }
+}
+
+template <int FFT_SIZE>
+int FixedAnalyzer<FFT_SIZE>::calculate_magnitudes(double *magnitudes) {
+
+    fftw_execute(plan);
+
+    double max_mag = 0;
+    int max_idx = 0;
+
+    std::fill(magnitudes, magnitudes + min_index, 0.0);
+    for (int i = min_index; i < BINS; ++i) {
+        double real_part = fft_out[i][0];
+        double imag_part = fft_out[i][1];
+        magnitudes[i] = std::sqrt(real_part * real_part + imag_part * imag_part);
+
+        if (magnitudes[i] > max_mag) {
+            max_mag = magnitudes[i];
+            max_idx = i;
+        }
+    }
+
+    if (max_mag < min_magnitude) {
+        return 0;
+    }
+
+    return max_idx;
+}
+
+template <int FFT_SIZE>
+int FixedAnalyzer<FFT_SIZE>::detect_notes(const double *magnitudes, float levels[NUM_NOTES],
+                                          double note_magnitudes[NUM_NOTES]) const {
+    return detect_pitch_classes(magnitudes, min_index, BINS, bin_note.data(), min_magnitude,
+                                levels, note_magnitudes);
+}
+
+/**
+ * @brief Keeps the strongest bin above min_magnitude per pitch class (shared by the analyzers).
+ * @param magnitudes Bin magnitudes.
+ * @param first_bin First bin to consider.
+ * @param end_bin One past the last bin to consider.
+ * @param bin_note Pitch class of each bin.
+ * @param min_magnitude Bins must exceed this to count.
+ * @param levels Output, 1.0 for every detected pitch class and 0.0 otherwise.
+ * @param note_magnitudes Output, strongest bin magnitude per pitch class (0 if none).
+ * @return Number of pitch classes detected.
+ */
+int detect_pitch_classes(const double *magnitudes, int first_bin, int end_bin, const int8_t *bin_note,
+                         double min_magnitude, float levels[NUM_NOTES], double note_magnitudes[NUM_NOTES]) {
+
+    std::fill(note_magnitudes, note_magnitudes + NUM_NOTES, 0.0);
+
+    // Keep the strongest bin above threshold for every pitch class
+    for (int i = first_bin; i < end_bin; i++) {
+        double mag = magnitudes[i] > min_magnitude ? magnitudes[i] : 0.0;
+        double &note_mag = note_magnitudes[bin_note[i]];
+        note_mag = std::max(note_mag, mag);
+    }
+
+    int detected = 0;
+    for (int note_idx = 0; note_idx < NUM_NOTES; note_idx++) {
+        levels[note_idx] = note_magnitudes[note_idx] > 0 ? 1.0f : 0.0f;
+        detected += note_magnitudes[note_idx] > 0;
+    }
+
+    return detected;
+}
+
+// Sizes compiled in. Add a line here and in make_analyzer() to support another.
+template class FixedAnalyzer<256>;
+template class FixedAnalyzer<512>;
+template class FixedAnalyzer<1024>;
+template class FixedAnalyzer<2048>;
+template class FixedAnalyzer<4096>;
+template class FixedAnalyzer<8192>;
+template class FixedAnalyzer<16384>;
+
+// One analyzer class template, instantiated at the requested size.
+template <template <int> class A>
+static std::unique_ptr<Analyzer> make_sized(int fft_size, double sample_rate, int min_freq, double min_magnitude,
+                                            WindowType window, double kaiser_beta) {
+    switch (fft_size) {
+    case 256:   return std::unique_ptr<Analyzer>(new A<256>(sample_rate, min_freq, min_magnitude, window, kaiser_beta));
+    case 512:   return std::unique_ptr<Analyzer>(new A<512>(sample_rate, min_freq, min_magnitude, window, kaiser_beta));
+    case 1024:  return std::unique_ptr<Analyzer>(new A<1024>(sample_rate, min_freq, min_magnitude, window, kaiser_beta));
+    case 2048:  return std::unique_ptr<Analyzer>(new A<2048>(sample_rate, min_freq, min_magnitude, window, kaiser_beta));
+    case 4096:  return std::unique_ptr<Analyzer>(new A<4096>(sample_rate, min_freq, min_magnitude, window, kaiser_beta));
+    case 8192:  return std::unique_ptr<Analyzer>(new A<8192>(sample_rate, min_freq, min_magnitude, window, kaiser_beta));
+    case 16384: return std::unique_ptr<Analyzer>(new A<16384>(sample_rate, min_freq, min_magnitude, window, kaiser_beta));
+    }
+    throw std::runtime_error("Error: Unsupported FFT size " + std::to_string(fft_size) +
+                             " (supported: 256, 512, 1024, 2048, 4096, 8192, 16384).");
+}
+
+/**
+ * @brief Creates the analyzer specialised for fft_size.
+ * @param backend FFTW (double) or the integer Q15 FFT.
+ * @throws std::runtime_error if fft_size is not one of the compiled sizes.
+ */
+std::unique_ptr<Analyzer> make_analyzer(int fft_size, double sample_rate, int min_freq, double min_magnitude,
+                                        WindowType window, double kaiser_beta, FftBackend backend) {
+    if (backend == FFT_BACKEND_Q15) {
+        return make_sized<Q15Analyzer>(fft_size, sample_rate, min_freq, min_magnitude, window, kaiser_beta);
+    }
+    return make_sized<FixedAnalyzer>(fft_size, sample_rate, min_freq, min_magnitude, window, kaiser_beta);
+}
+
+/**
+ * @brief Loads FFTW plans measured on an earlier run, so FFTW_MEASURE planning is quick.
+ * @return False if the file does not exist or is invalid.
+ */
+bool load_fftw_wisdom(const std::string &path) {
+    return fftw_import_wisdom_from_filename(path.c_str()) != 0;
+}
+
+/**
+ * @brief Saves the plans measured so far for load_fftw_wisdom().
+ * @return False if the file cannot be written.
+ */
+bool save_fftw_wisdom(const std::string &path) {
+    return fftw_export_wisdom_to_filename(path.c_str()) != 0;
+}
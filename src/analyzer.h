@@ -0,0 +1,161 @@
+#ifndef _ANALYZER_H_
+#define _ANALYZER_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <fftw3.h>
+
+#include "notes.h"
+#include "window.h"
+
+// Smallest and largest FFT sizes compiled in (every power of two between);
+// capture history is kept at least MAX_FFT_SIZE long.
+#define MIN_FFT_SIZE 256
+#define MAX_FFT_SIZE 16384
+
+/**
+ * @brief How the FFT is computed.
+ */
+enum FftBackend {
+    FFT_BACKEND_FFTW,   // Double-precision FFTW (FixedAnalyzer)
+    FFT_BACKEND_Q15     // Q15 integer FFT core (Q15Analyzer)
+};
+
+/**
+ * @class Analyzer
+ * @brief Runtime interface to the spectrum analysis, whatever the FFT size.
+ */
+class Analyzer {
+public:
+    virtual ~Analyzer() {}
+
+    /**
+     * @brief Number of samples per analysis (the longest FFT window).
+     */
+    virtual int fft_size() const = 0;
+
+    /**
+     * @brief Number of magnitude bins calculate_magnitudes() writes.
+     */
+    virtual int num_bins() const = 0;
+
+    /**
+     * @brief Centre frequency of a magnitude bin in Hz.
+     */
+    virtual double bin_frequency(int bin) const = 0;
+
+    /**
+     * @brief First bin that calculate_magnitudes() refreshes on every call.
+     *
+     * Bins below it may be reused from earlier calls (see AnalyzerBank), so
+     * frame-to-frame measures such as spectral flux should start here.
+     */
+    virtual int first_live_bin() const { return 0; }
+
+    /**
+     * @brief Copies fft_size() samples into the FFT input, applying the analysis
+     * window in the same pass.
+     * @param samples fft_size() contiguous samples, oldest first (e.g. CaptureRing::newest()).
+     */
+    virtual void load_samples(const float *samples) = 0;
+
+    /**
+     * @brief Runs the FFT on the loaded samples and computes bin magnitudes.
+     * @param magnitudes Output, num_bins() values. Bins below the minimum frequency are 0.
+     * @return Index of the strongest bin, or 0 if nothing is above the threshold.
+     */
+    virtual int calculate_magnitudes(double *magnitudes) = 0;
+
+    /**
+     * @brief Finds which pitch classes have a bin above the threshold.
+     *
+     * Only reads the analyzer's tables, so it may run on another thread than the FFT.
+     * @param magnitudes Bin magnitudes from calculate_magnitudes().
+     * @param levels Output, 1.0 for every detected pitch class and 0.0 otherwise.
+     * @param note_magnitudes Output, strongest bin magnitude per pitch class (0 if none).
+     * @return Number of pitch classes detected.
+     */
+    virtual int detect_notes(const double *magnitudes, float levels[NUM_NOTES], double note_magnitudes[NUM_NOTES]) const = 0;
+};
+
+/**
+ * @class FixedAnalyzer
+ * @brief FFT analysis specialised for one FFT size.
+ *
+ * All loops run over compile-time bounds and the per-bin tables are fixed-size
+ * arrays, so the compiler can unroll and vectorise them.
+ */
+template <int FFT_SIZE>
+class FixedAnalyzer : public Analyzer {
+public:
+    static const int BINS = FFT_SIZE / 2 + 1;
+
+    /**
+     * @brief Constructor that allocates the FFT buffers and builds the plan and bin tables.
+     * @param sample_rate Rate of the analysed samples in Hz (after decimation).
+     * @param min_freq Bins below this frequency (Hz) are ignored.
+     * @param min_magnitude Bins must exceed this magnitude to count as a note.
+     * @param window_type Analysis window applied to every frame.
+     * @param kaiser_beta Shape of the Kaiser window (ignored for the others).
+     */
+    FixedAnalyzer(double sample_rate, int min_freq, double min_magnitude, WindowType window_type, double kaiser_beta);
+    ~FixedAnalyzer();
+
+    int fft_size() const { return FFT_SIZE; }
+    int num_bins() const { return BINS; }
+    double bin_frequency(int bin) const { return bin * bin_hz; }
+    void load_samples(const float *samples);
+    int calculate_magnitudes(double *magnitudes);
+    int detect_notes(const double *magnitudes, float levels[NUM_NOTES], double note_magnitudes[NUM_NOTES]) const;
+
+private:
+    double *fft_in;
+    fftw_complex *fft_out;
+    double *window;    // Precomputed window, scaled to unit coherent gain
+    fftw_plan plan;
+
+    double bin_hz;
+    int min_index;
+    double min_magnitude;
+
+    std::array<int8_t, BINS> bin_note; // Pitch class of each bin
+};
+
+/**
+ * @brief Keeps the strongest bin above min_magnitude per pitch class (shared by the analyzers).
+ * @param magnitudes Bin magnitudes.
+ * @param first_bin First bin to consider.
+ * @param end_bin One past the last bin to consider.
+ * @param bin_note Pitch class of each bin.
+ * @param min_magnitude Bins must exceed this to count.
+ * @param levels Output, 1.0 for every detected pitch class and 0.0 otherwise.
+ * @param note_magnitudes Output, strongest bin magnitude per pitch class (0 if none).
+ * @return Number of pitch classes detected.
+ */
+int detect_pitch_classes(const double *magnitudes, int first_bin, int end_bin, const int8_t *bin_note,
+                         double min_magnitude, float levels[NUM_NOTES], double note_magnitudes[NUM_NOTES]);
+
+/**
+ * @brief Creates the analyzer specialised for fft_size.
+ * @param backend FFTW (double) or the integer Q15 FFT.
+ * @throws std::runtime_error if fft_size is not one of the compiled sizes.
+ */
+std::unique_ptr<Analyzer> make_analyzer(int fft_size, double sample_rate, int min_freq, double min_magnitude,
+                                        WindowType window, double kaiser_beta,
+                                        FftBackend backend = FFT_BACKEND_FFTW);
+
+/**
+ * @brief Loads FFTW plans measured on an earlier run, so FFTW_MEASURE planning is quick.
+ * @return False if the file does not exist or is invalid.
+ */
+bool load_fftw_wisdom(const std::string &path);
+
+/**
+ * @brief Saves the plans measured so far for load_fftw_wisdom().
+ * @return False if the file cannot be written.
+ */
+bool save_fftw_wisdom(const std::string &path);
+
+#endif // _ANALYZER_H_
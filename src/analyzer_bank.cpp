@@ -0,0 +1,143 @@
+#include "analyzer_bank.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+/**
+ * @brief Constructor that builds every band's FFT plan and the schedule.
+ * @param fft_size Longest window, used for the lowest band.
+ * @param num_bands Number of FFT sizes, 2 to MAX_ANALYSIS_BANDS.
+ * @param sample_rate Rate of the analysed samples in Hz (after decimation).
+ * @param min_freq Lowest analysed frequency (Hz); must be > 0.
+ * @param min_magnitude Bins must exceed this magnitude to count as a note.
+ * @param window_type Analysis window applied in every band.
+ * @param kaiser_beta Shape of the Kaiser window (ignored for the others).
+ * @param backend FFT implementation used by every band.
+ * @throws std::runtime_error if the band sizes are not compiled in or the ranges are empty.
+ */
+AnalyzerBank::AnalyzerBank(int fft_size, int num_bands, double sample_rate, int min_freq, double min_magnitude,
+                           WindowType window_type, double kaiser_beta, FftBackend backend)
+    : longest(fft_size), min_magnitude(min_magnitude), tick(0), scratch(fft_size / 2 + 1) {
+
+    if (num_bands < 2 || num_bands > MAX_ANALYSIS_BANDS) {
+        throw std::runtime_error("Error: Analysis bands must be between 2 and " +
+                                 std::to_string(MAX_ANALYSIS_BANDS) + ".");
+    }
+    if (min_freq <= 0) {
+        throw std::runtime_error("Error: Multi-resolution analysis needs min_freq > 0.");
+    }
+
+    const int smallest = fft_size >> (num_bands - 1);
+    int offset = 0;
+    for (int b = 0; b < num_bands; b++) {
+        Band band;
+        band.size = fft_size >> b;
+
+        // Band b covers [min_freq * 2^b, min_freq * 2^(b+1)); the last one runs to Nyquist.
+        double low = static_cast<double>(min_freq) * (1 << b);
+        double high = static_cast<double>(min_freq) * (2 << b);
+        band.first_bin = std::max(1, static_cast<int>(std::ceil(low * band.size / sample_rate)));
+        if (band.first_bin > band.size / 2) {
+            throw std::runtime_error("Error: Analysis band " + std::to_string(band.size) +
+                                     " starts above Nyquist; use fewer bands or a lower min_freq.");
+        }
+        // High bands can reach Nyquist early at low (decimated) rates; scratch holds no more bins.
+        band.last_bin = b == num_bands - 1 ? band.size / 2
+                                           : std::min(band.size / 2,
+                                                      static_cast<int>(std::ceil(high * band.size / sample_rate)) - 1);
+        if (band.last_bin < band.first_bin) {
+            throw std::runtime_error("Error: Analysis band " + std::to_string(band.size) +
+                                     " has no bins; use fewer bands or a larger FFT size.");
+        }
+
+        // Skip computing magnitudes below the band's range.
+        band.fft = make_analyzer(band.size, sample_rate, static_cast<int>(low), min_magnitude, window_type, kaiser_beta,
+                                 backend);
+        band.offset = offset;
+        band.gain = static_cast<double>(fft_size) / band.size;
+        band.period = band.size / smallest;
+        band.phase = 0;
+        offset += band.last_bin - band.first_bin + 1;
+
+        for (int i = band.first_bin; i <= band.last_bin; i++) {
+            double freq = band.fft->bin_frequency(i);
+            bin_freq.push_back(freq);
+            bin_note.push_back(static_cast<int8_t>(freq_to_note_index(freq)));
+        }
+        bands.push_back(std::move(band));
+    }
+
+    cached.assign(offset, 0.0);
+    stagger();
+}
+
+// Spreads the bands over their periods so every call does about the same FFT work.
+void AnalyzerBank::stagger() {
+    const int slots = bands.front().period;
+    std::vector<double> load(slots, 0.0);
+
+    // Place the most expensive band first; bands are ordered longest first already.
+    for (Band &band : bands) {
+        double cost = band.size * std::log2(static_cast<double>(band.size));
+        int best_phase = 0;
+        double best_peak = 0;
+        for (int phase = 0; phase < band.period; phase++) {
+            double peak = 0;
+            for (int t = phase; t < slots; t += band.period) {
+                peak = std::max(peak, load[t]);
+            }
+            if (phase == 0 || peak < best_peak) {
+                best_peak = peak;
+                best_phase = phase;
+            }
+        }
+        band.phase = best_phase;
+        for (int t = best_phase; t < slots; t += band.period) {
+            load[t] += cost;
+        }
+    }
+}
+
+void AnalyzerBank::load_samples(const float *samples) {
+    for (Band &band : bands) {
+        if (due(band)) {
+            // Every band ends at the newest sample.
+            band.fft->load_samples(samples + longest - band.size);
+        }
+    }
+}
+
+int AnalyzerBank::calculate_magnitudes(double *magnitudes) {
+    for (Band &band : bands) {
+        if (!due(band)) {
+            continue;
+        }
+        band.fft->calculate_magnitudes(scratch.data());
+        double *out = &cached[band.offset];
+        for (int i = band.first_bin; i <= band.last_bin; i++) {
+            *out++ = scratch[i] * band.gain;
+        }
+    }
+    tick++;
+
+    double max_mag = 0;
+    int max_idx = 0;
+    for (size_t i = 0; i < cached.size(); i++) {
+        magnitudes[i] = cached[i];
+        if (cached[i] > max_mag) {
+            max_mag = cached[i];
+            max_idx = static_cast<int>(i);
+        }
+    }
+
+    return max_mag < min_magnitude ? 0 : max_idx;
+}
+
+int AnalyzerBank::detect_notes(const double *magnitudes, float levels[NUM_NOTES],
+                               double note_magnitudes[NUM_NOTES]) const {
+    // Keep the strongest bin above threshold for every pitch class, across all bands
+    return detect_pitch_classes(magnitudes, 0, static_cast<int>(cached.size()), bin_note.data(), min_magnitude,
+                                levels, note_magnitudes);
+}
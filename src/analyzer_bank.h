@@ -0,0 +1,80 @@
+#ifndef _ANALYZER_BANK_H_
+#define _ANALYZER_BANK_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "analyzer.h"
+
+// Most FFTs in one bank; the shortest window must still be a compiled size.
+#define MAX_ANALYSIS_BANDS 5
+
+/**
+ * @class AnalyzerBank
+ * @brief Multi-resolution analysis: several FFT sizes over the same sample history.
+ *
+ * Band 0 is the full fft_size window and covers the lowest octave from
+ * min_freq; each following band halves the window and starts one octave
+ * higher, the last one running up to Nyquist. The bands' bins are
+ * concatenated (low to high frequency) into one magnitude array, so the
+ * feature stage sees a single spectrum and produces one chroma vector.
+ *
+ * A band of size n is recomputed every n / smallest calls (the same overlap
+ * for every band), and the bands' phases are staggered at construction so
+ * the long FFTs never land on the same call. Between updates a band's last
+ * magnitudes are reused. Magnitudes are scaled to the longest window, so
+ * min_magnitude means the same thing in every band.
+ */
+class AnalyzerBank : public Analyzer {
+public:
+    /**
+     * @brief Constructor that builds every band's FFT plan and the schedule.
+     * @param fft_size Longest window, used for the lowest band.
+     * @param num_bands Number of FFT sizes, 2 to MAX_ANALYSIS_BANDS.
+     * @param sample_rate Rate of the analysed samples in Hz (after decimation).
+     * @param min_freq Lowest analysed frequency (Hz); must be > 0.
+     * @param min_magnitude Bins must exceed this magnitude to count as a note.
+     * @param window_type Analysis window applied in every band.
+     * @param kaiser_beta Shape of the Kaiser window (ignored for the others).
+     * @param backend FFT implementation used by every band.
+     * @throws std::runtime_error if the band sizes are not compiled in or the ranges are empty.
+     */
+    AnalyzerBank(int fft_size, int num_bands, double sample_rate, int min_freq, double min_magnitude,
+                 WindowType window_type, double kaiser_beta, FftBackend backend = FFT_BACKEND_FFTW);
+
+    int fft_size() const { return longest; }
+    int num_bins() const { return static_cast<int>(cached.size()); }
+    double bin_frequency(int bin) const { return bin_freq[bin]; }
+    int first_live_bin() const { return bands.back().offset; } // The shortest band runs every call
+    void load_samples(const float *samples);
+    int calculate_magnitudes(double *magnitudes);
+    int detect_notes(const double *magnitudes, float levels[NUM_NOTES], double note_magnitudes[NUM_NOTES]) const;
+
+private:
+    struct Band {
+        std::unique_ptr<Analyzer> fft;
+        int size;
+        int first_bin;  // Range of the band's own bins that it contributes
+        int last_bin;   // (inclusive)
+        int offset;     // Where that range starts in the combined magnitudes
+        double gain;    // Scales magnitudes to the longest window
+        int period;     // Recomputed every period calls...
+        int phase;      // ...when tick % period == phase
+    };
+
+    std::vector<Band> bands;
+    int longest;
+    double min_magnitude;
+    uint64_t tick;
+
+    std::vector<double> scratch;   // One band's full spectrum
+    std::vector<double> cached;    // Combined magnitudes, updated band by band
+    std::vector<double> bin_freq;
+    std::vector<int8_t> bin_note;  // Pitch class of each combined bin
+
+    bool due(const Band &band) const { return tick % band.period == static_cast<uint64_t>(band.phase); }
+    void stagger();
+};
+
+#endif // _ANALYZER_BANK_H_
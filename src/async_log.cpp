@@ -0,0 +1,246 @@
+#include "async_log.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "notes.h"
+
+// Records each thread can have in flight; 64 bytes each.
+#define LOG_QUEUE_RECORDS 1024
+
+// How often the writer drains the queues.
+#define LOG_POLL_MS 50
+
+// printf-style format of every LogFormat, in enum order.
+static const char *const log_formats[LOG_FORMAT_COUNT] = {
+    "Note on: %s%d #%u (%.1f Hz)",
+    "Note off: %s%d #%u after %.3f s",
+    "Cycles per second: %u, worst frame: %u us, LED frames: %u, dropped: %u",
+    "Input buffer: %.1f ms, underruns: %u, late: %u, lost: %u, skipped: %u",
+    "End of input.",
+    "Chord: %s, key: %s",
+    "Hi-res peak: %s%d %.3f Hz, %+.2f cents (magnitude %.0f)",
+};
+
+// Per-thread queue of the log the thread used last.
+struct ThreadSlot {
+    uint32_t log_id;
+    void *queue;
+    uint16_t index;
+};
+static thread_local ThreadSlot thread_slot = {0, nullptr, 0};
+static std::atomic<uint32_t> next_log_id(1);
+
+/**
+ * @brief Constructor.
+ * @param out Where the writer sends formatted lines.
+ */
+AsyncLog::AsyncLog(std::ostream &out)
+    : out(out), id(next_log_id++), start_time(clock::now()), writer("log", [this]() { write_step(); }) {
+}
+
+AsyncLog::~AsyncLog() {
+    stop();
+}
+
+/**
+ * @brief Creates the calling thread's queue now instead of on its first log().
+ * @param name Shown in the drop report.
+ */
+void AsyncLog::attach_thread(const char *name) {
+    queue_for_this_thread(name);
+}
+
+/**
+ * @brief Starts the writer thread.
+ */
+void AsyncLog::start() {
+    writer.start();
+}
+
+/**
+ * @brief Stops the writer thread after writing everything queued.
+ */
+void AsyncLog::stop() {
+    writer.stop();
+    drain();
+}
+
+/**
+ * @brief Records dropped because a queue was full.
+ */
+uint64_t AsyncLog::dropped_count() const {
+    std::lock_guard<std::mutex> lock(threads_mutex);
+    uint64_t total = 0;
+    for (const std::unique_ptr<ThreadQueue> &t : threads) {
+        total += t->dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void AsyncLog::push(LogRecord &record) {
+    ThreadQueue *queue = thread_slot.log_id == id ? static_cast<ThreadQueue *>(thread_slot.queue)
+                                                  : queue_for_this_thread(nullptr);
+    record.thread = thread_slot.index;
+    if (!queue->records.push(record)) {
+        queue->dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// Finds or creates the calling thread's queue. Locks and may allocate.
+AsyncLog::ThreadQueue *AsyncLog::queue_for_this_thread(const char *name) {
+    std::lock_guard<std::mutex> lock(threads_mutex);
+    std::string wanted = name ? name : "thread " + std::to_string(threads.size());
+    std::thread::id self = std::this_thread::get_id();
+
+    size_t index = 0;
+    while (index < threads.size() && threads[index]->owner != self) {
+        index++;
+    }
+    if (index == threads.size()) {
+        threads.emplace_back(new ThreadQueue(wanted, LOG_QUEUE_RECORDS));
+        threads.back()->owner = self;
+    } else if (name) {
+        threads[index]->name = wanted;
+    }
+
+    thread_slot.log_id = id;
+    thread_slot.queue = threads[index].get();
+    thread_slot.index = static_cast<uint16_t>(index);
+    return threads[index].get();
+}
+
+void AsyncLog::write_step() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(LOG_POLL_MS));
+    drain();
+}
+
+// Writes out everything queued, oldest first, with a single flush.
+void AsyncLog::drain() {
+    batch.clear();
+    std::vector<std::pair<std::string, uint64_t>> drops;
+    {
+        std::lock_guard<std::mutex> lock(threads_mutex);
+        reported_drops.resize(threads.size(), 0);
+        LogRecord r;
+        for (size_t i = 0; i < threads.size(); i++) {
+            ThreadQueue &t = *threads[i];
+            while (t.records.pop(r)) {
+                batch.push_back(r);
+            }
+            uint64_t dropped = t.dropped.load(std::memory_order_relaxed);
+            if (dropped != reported_drops[i]) {
+                drops.push_back(std::make_pair(t.name, dropped - reported_drops[i]));
+                reported_drops[i] = dropped;
+            }
+        }
+    }
+    if (batch.empty() && drops.empty()) {
+        return;
+    }
+
+    std::stable_sort(batch.begin(), batch.end(), [](const LogRecord &a, const LogRecord &b) {
+        return a.time_ns < b.time_ns;
+    });
+    for (const LogRecord &r : batch) {
+        format(r);
+        out << line << '\n';
+    }
+    for (const std::pair<std::string, uint64_t> &d : drops) {
+        out << "Log: " << d.second << " records from " << d.first << " dropped (writer behind)\n";
+    }
+    out.flush();
+}
+
+// Renders one record into line.
+void AsyncLog::format(const LogRecord &r) {
+    char buf[64];
+    uint64_t start_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        start_time.time_since_epoch()).count());
+    std::snprintf(buf, sizeof(buf), "[%11.6f] ", (static_cast<int64_t>(r.time_ns - start_ns)) / 1e9);
+    line = buf;
+
+    if (r.format >= LOG_FORMAT_COUNT) {
+        line += "Unknown log format " + std::to_string(r.format);
+        return;
+    }
+
+    uint32_t arg = 0;
+    for (const char *p = log_formats[r.format]; *p; p++) {
+        if (*p != '%') {
+            line += *p;
+            continue;
+        }
+        if (p[1] == '%') {
+            line += '%';
+            p++;
+            continue;
+        }
+
+        // Copy the conversion spec (flags, width, precision) up to its letter.
+        char spec[16];
+        size_t n = 0;
+        spec[n++] = *p++;
+        while (*p && std::strchr("-+ #0123456789.", *p) && n < sizeof(spec) - 4) {
+            spec[n++] = *p++;
+        }
+        const char conv = *p;
+        if (!conv) {
+            break;
+        }
+        if (arg >= r.num_args) {
+            line += "<missing>";
+            continue;
+        }
+
+        const LogArg &a = r.args[arg++];
+        switch (conv) {
+        case 'd':
+        case 'u':
+            spec[n++] = 'l';
+            spec[n++] = 'l';
+            spec[n++] = conv;
+            spec[n] = '\0';
+            std::snprintf(buf, sizeof(buf), spec, static_cast<long long>(a.i));
+            line += buf;
+            break;
+        case 'f':
+        case 'g':
+        case 'e':
+            spec[n++] = conv;
+            spec[n] = '\0';
+            std::snprintf(buf, sizeof(buf), spec, a.d);
+            line += buf;
+            break;
+        case 's':
+            line += a.s ? a.s : "(null)";
+            break;
+        case 'N': {
+            bool any = false;
+            for (int i = 0; i < NUM_NOTES; i++) {
+                if (a.i & (1 << i)) {
+                    line += any ? " " : "";
+                    line += note_name(i);
+                    any = true;
+                }
+            }
+            line += any ? "" : "-";
+            break;
+        }
+        default:
+            line += '?';
+            break;
+        }
+    }
+}
+
+/**
+ * @brief The program's log, writing to standard output.
+ */
+AsyncLog &app_log() {
+    static AsyncLog log(std::cout);
+    return log;
+}
@@ -0,0 +1,166 @@
+#ifndef _ASYNC_LOG_H_
+#define _ASYNC_LOG_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spsc_queue.h"
+#include "stage.h"
+
+// Most arguments one record carries.
+#define LOG_MAX_ARGS 6
+
+/**
+ * @brief Messages the log can carry. Each has a printf-style format in async_log.cpp.
+ *
+ * Formats take %d / %u (integers), %f / %g / %e (doubles), %s (a string that
+ * outlives the log, e.g. a literal) and %N (a 12-bit pitch-class mask, printed
+ * as note names).
+ */
+enum LogFormat {
+    LOG_NOTE_ON,            // note name, octave, note id, frequency
+    LOG_NOTE_OFF,           // note name, octave, note id, duration
+    LOG_STATS,              // analysis cycles, worst FFT us, LED frames, dropped
+    LOG_INPUT_STATS,        // buffered ms, underruns, late, lost, skipped
+    LOG_END_OF_INPUT,       // (none)
+    LOG_HARMONY,            // chord name, key name
+    LOG_HIRES_PEAK,         // note name, octave, frequency, cents, magnitude
+    LOG_FORMAT_COUNT
+};
+
+/**
+ * @brief One argument, stored raw; the format says which member is set.
+ */
+union LogArg {
+    int64_t i;
+    double d;
+    const char *s;
+};
+
+/**
+ * @brief Fixed-size record queued by the logging thread and formatted by the writer.
+ */
+struct LogRecord {
+    uint64_t time_ns;           // steady_clock time of the call
+    uint16_t format;            // LogFormat
+    uint16_t thread;            // Index of the producing thread
+    uint32_t num_args;
+    LogArg args[LOG_MAX_ARGS];
+};
+
+inline LogArg to_log_arg(int v)                { LogArg a; a.i = v; return a; }
+inline LogArg to_log_arg(unsigned int v)       { LogArg a; a.i = v; return a; }
+inline LogArg to_log_arg(long v)               { LogArg a; a.i = v; return a; }
+inline LogArg to_log_arg(unsigned long v)      { LogArg a; a.i = static_cast<int64_t>(v); return a; }
+inline LogArg to_log_arg(long long v)          { LogArg a; a.i = v; return a; }
+inline LogArg to_log_arg(unsigned long long v) { LogArg a; a.i = static_cast<int64_t>(v); return a; }
+inline LogArg to_log_arg(float v)              { LogArg a; a.d = v; return a; }
+inline LogArg to_log_arg(double v)             { LogArg a; a.d = v; return a; }
+inline LogArg to_log_arg(const char *v)        { LogArg a; a.s = v; return a; }
+
+/**
+ * @class AsyncLog
+ * @brief Binary, asynchronous log for threads that must not block on I/O.
+ *
+ * log() stores a format ID and its raw arguments in a fixed-size record and
+ * pushes it into the calling thread's own lock-free queue: no formatting,
+ * locking, allocation or system call. A writer thread drains every queue,
+ * formats the records in time order and writes them out with one flush per
+ * batch. If a thread logs faster than the writer drains, records are dropped
+ * and counted rather than stalling the caller.
+ *
+ * A thread's queue is created the first time it logs; threads that must not
+ * allocate in their loop call attach_thread() from their init function.
+ */
+class AsyncLog {
+public:
+    /**
+     * @brief Constructor.
+     * @param out Where the writer sends formatted lines.
+     */
+    explicit AsyncLog(std::ostream &out);
+    ~AsyncLog();
+
+    /**
+     * @brief Queues a record. Never blocks; safe on real-time threads once attached.
+     */
+    template <typename... Args>
+    void log(LogFormat format, Args... args) {
+        static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many log arguments");
+        LogRecord r;
+        r.time_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            clock::now().time_since_epoch()).count());
+        r.format = static_cast<uint16_t>(format);
+        r.num_args = sizeof...(Args);
+        const LogArg packed[] = {to_log_arg(args)..., LogArg()};
+        for (size_t i = 0; i < sizeof...(Args); i++) {
+            r.args[i] = packed[i];
+        }
+        push(r);
+    }
+
+    /**
+     * @brief Creates the calling thread's queue now instead of on its first log().
+     * @param name Shown in the drop report.
+     */
+    void attach_thread(const char *name);
+
+    /**
+     * @brief Starts the writer thread.
+     */
+    void start();
+
+    /**
+     * @brief Stops the writer thread after writing everything queued.
+     */
+    void stop();
+
+    /**
+     * @brief Records dropped because a queue was full.
+     */
+    uint64_t dropped_count() const;
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    struct ThreadQueue {
+        std::string name;
+        std::thread::id owner;
+        SpscQueue<LogRecord> records;
+        std::atomic<uint64_t> dropped;
+
+        ThreadQueue(const std::string &name, size_t capacity) : name(name), records(capacity), dropped(0) {}
+    };
+
+    std::ostream &out;
+    const uint32_t id;                  // Tells this log's thread-local queues from another's
+    mutable std::mutex threads_mutex;   // Guards the list, not the queues
+    std::vector<std::unique_ptr<ThreadQueue>> threads;
+    clock::time_point start_time;
+
+    // Writer thread state
+    std::vector<LogRecord> batch;
+    std::vector<uint64_t> reported_drops;
+    std::string line;
+    StageThread writer;
+
+    void push(LogRecord &record);
+    ThreadQueue *queue_for_this_thread(const char *name);
+    void write_step();
+    void drain();
+    void format(const LogRecord &record);
+};
+
+/**
+ * @brief The program's log, writing to standard output.
+ */
+AsyncLog &app_log();
+
+#endif // _ASYNC_LOG_H_
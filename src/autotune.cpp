@@ -0,0 +1,350 @@
+#include "autotune.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "analyzer.h"
+#include "analyzer_bank.h"
+#include "capture_ring.h"
+#include "decimator.h"
+#include "harmony.h"
+#include "note_painter.h"
+#include "partial_tracker.h"
+#include "rhythm.h"
+
+// Candidate analysis windows and capture block sizes.
+static const int candidate_fft_sizes[] = {1024, 2048, 4096, 8192, 16384};
+static const int candidate_blocks[] = {128, 256, 512, 1024, 2048, 4096};
+// Blocks run before and while timing each candidate; timing stops early after CALIBRATION_MS.
+#define CALIBRATION_WARMUP_BLOCKS 4
+#define CALIBRATION_BLOCKS 48
+#define CALIBRATION_MS 100
+// LED frames painted and encoded to time the output side.
+#define ENCODE_RUNS 100
+// Latency counts the slowest 5% of processing times.
+#define LATENCY_PERCENTILE 0.95
+// Bump when the measurement changes so old caches are ignored.
+#define CACHE_VERSION 1
+
+struct Measurement {
+    double mean_us;
+    double slow_us;     // LATENCY_PERCENTILE of the samples
+};
+
+static Measurement summarise(std::vector<double> &us) {
+    std::sort(us.begin(), us.end());
+    double sum = 0;
+    for (double u : us) {
+        sum += u;
+    }
+    size_t slow = static_cast<size_t>(LATENCY_PERCENTILE * (us.size() - 1));
+    return {sum / us.size(), us[slow]};
+}
+
+static double elapsed_us(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - since).count();
+}
+
+// One second of chords with harmonics and noise, so every stage does its usual work.
+static std::vector<float> calibration_audio(int sample_rate) {
+    std::vector<float> samples(sample_rate);
+    std::mt19937 rng(1);
+    std::normal_distribution<float> noise(0.0f, 0.01f);
+    for (size_t i = 0; i < samples.size(); i++) {
+        const double t = static_cast<double>(i) / sample_rate;
+        const int root = t < 0.5 ? 57 : 60;
+        double s = 0;
+        for (int interval : {0, 4, 7}) {
+            const double freq = A4_FREQUENCY * std::pow(2.0, (root + interval - A4_MIDI_NUMBER) / 12.0);
+            for (int h = 1; h <= 3; h++) {
+                s += 0.1 / h * std::sin(2 * M_PI * freq * h * t);
+            }
+        }
+        samples[i] = static_cast<float>(s) + noise(rng);
+    }
+    return samples;
+}
+
+static std::unique_ptr<Analyzer> build_analyzer(const Config &config, int fft_size, FftBackend backend) {
+    const double rate = static_cast<double>(config.sample_rate) / config.decimation;
+    if (config.analysis_bands > 1) {
+        return std::unique_ptr<Analyzer>(new AnalyzerBank(fft_size, config.analysis_bands, rate, config.min_freq,
+                                                          config.min_magnitude, config.window, config.kaiser_beta,
+                                                          backend));
+    }
+    return make_analyzer(fft_size, rate, config.min_freq, config.min_magnitude, config.window, config.kaiser_beta,
+                         backend);
+}
+
+// Times the FFT and feature stages for one capture block size, as the pipeline runs them.
+static Measurement time_analysis(const Config &config, Analyzer &analyzer, int block,
+                                 const std::vector<float> &audio) {
+    Decimator decimator(config.decimation, block);
+    CaptureRing history(MAX_FFT_SIZE, decimator.max_output(block));
+    std::vector<double> magnitudes(analyzer.num_bins());
+    RhythmTracker rhythm(static_cast<double>(block) / config.sample_rate);
+    PartialTracker tracker(config.note_release_ms, config.min_magnitude);
+    HarmonyEstimator harmony;
+    NoteEvent events[MAX_NOTE_EVENTS];
+    std::vector<double> us;
+    us.reserve(CALIBRATION_BLOCKS);
+
+    const std::chrono::steady_clock::time_point began = std::chrono::steady_clock::now();
+    size_t offset = 0;
+    for (int b = 0; b < CALIBRATION_WARMUP_BLOCKS + CALIBRATION_BLOCKS; b++) {
+        if (offset + block > audio.size()) {
+            offset = 0;
+        }
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        history.commit(decimator.process(audio.data() + offset, block, history.write_pointer()));
+        analyzer.load_samples(history.newest(analyzer.fft_size()));
+        analyzer.calculate_magnitudes(magnitudes.data());
+
+        const double stream_time = static_cast<double>(b) * block / config.sample_rate;
+        float levels[NUM_NOTES];
+        double note_magnitudes[NUM_NOTES];
+        rhythm.update(magnitudes.data(), analyzer.first_live_bin(), analyzer.num_bins(), b);
+        analyzer.detect_notes(magnitudes.data(), levels, note_magnitudes);
+        tracker.update(magnitudes.data(), analyzer.num_bins(), analyzer, stream_time, events, MAX_NOTE_EVENTS);
+        harmony.update(note_magnitudes, stream_time);
+
+        if (b >= CALIBRATION_WARMUP_BLOCKS) {
+            us.push_back(elapsed_us(start));
+            if (elapsed_us(began) > CALIBRATION_MS * 1000.0) {
+                break;
+            }
+        }
+        offset += block;
+    }
+    return summarise(us);
+}
+
+// Times painting and encoding one LED frame.
+static Measurement time_encode(const Config &config, LedOutput &strip, const LedLayout *layout) {
+    std::unique_ptr<NotePainter> painter = make_note_painter(config.num_leds, layout);
+    std::vector<Pixel> pixels(config.num_leds);
+    std::vector<uint8_t> wire(strip.encoded_size());
+    Pixel colours[NUM_NOTES + 1] = {};
+    std::vector<double> us;
+    us.reserve(ENCODE_RUNS);
+
+    for (int run = 0; run < ENCODE_RUNS; run++) {
+        for (int i = 0; i < NUM_NOTES; i++) {
+            colours[i].r = static_cast<uint8_t>(run + i * 20);
+            colours[i].g = static_cast<uint8_t>(run * 3 + i);
+            colours[i].b = static_cast<uint8_t>(255 - run);
+        }
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        painter->paint(colours, pixels.data());
+        strip.encode(pixels.data(), wire.data());
+        us.push_back(elapsed_us(start));
+    }
+    return summarise(us);
+}
+
+static std::string trim(const std::string &s) {
+    size_t start = s.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) {
+        return "";
+    }
+    size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(start, end - start + 1);
+}
+
+// CPU model and core count, so a cache copied to another board is not trusted.
+static std::string machine_id() {
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    std::string model = "unknown";
+    while (std::getline(cpuinfo, line)) {
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        std::string key = trim(line.substr(0, colon));
+        if (key == "model name" || key == "Model") {
+            model = trim(line.substr(colon + 1));
+        }
+    }
+    return model + " x" + std::to_string(std::thread::hardware_concurrency());
+}
+
+// Every option the choice depends on.
+static std::string tuning_inputs(const Config &config, const LedOutput &strip) {
+    std::ostringstream key;
+    key << "v" << CACHE_VERSION << " rate=" << config.sample_rate << " decimation=" << config.decimation
+        << " bands=" << config.analysis_bands << " min_freq=" << config.min_freq
+        << " window=" << window_name(config.window) << " leds=" << config.num_leds
+        << " layout=" << (config.layout.empty() ? "-" : config.layout) << " output=" << config.output
+        << " fps=" << std::min(config.led_fps, strip.max_frame_rate())
+        << " latency_ms=" << config.latency_budget_ms << " cpu=" << config.cpu_budget;
+    return key.str();
+}
+
+static std::string cache_path(const Config &config) {
+    return config.state_dir + "/autotune.conf";
+}
+
+static bool load_cache(const Config &config, const std::string &machine, const std::string &inputs,
+                       TuningResult &result) {
+    std::ifstream file(cache_path(config));
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string line;
+    bool machine_ok = false, inputs_ok = false;
+    int fields = 0;
+    try {
+        while (std::getline(file, line)) {
+            size_t eq = line.find('=');
+            if (line.empty() || line[0] == '#' || eq == std::string::npos) {
+                continue;
+            }
+            const std::string key = trim(line.substr(0, eq));
+            const std::string value = trim(line.substr(eq + 1));
+            if (key == "machine") {
+                machine_ok = value == machine;
+            } else if (key == "inputs") {
+                inputs_ok = value == inputs;
+            } else if (key == "fft_size") {
+                result.fft_size = std::stoi(value);
+                fields++;
+            } else if (key == "buffer_frames") {
+                result.buffer_frames = std::stoi(value);
+                fields++;
+            } else if (key == "fft_backend") {
+                result.fft_backend = value;
+                fields++;
+            } else if (key == "latency_ms") {
+                result.latency_ms = std::stod(value);
+            } else if (key == "cpu_percent") {
+                result.cpu_percent = std::stod(value);
+            } else if (key == "within_budget") {
+                result.within_budget = value == "true";
+            }
+        }
+    } catch (const std::exception &) {
+        return false;
+    }
+    return machine_ok && inputs_ok && fields == 3;
+}
+
+static void save_cache(const Config &config, const std::string &machine, const std::string &inputs,
+                       const TuningResult &result) {
+    std::ofstream file(cache_path(config));
+    file << "# Written by chromesthat --autotune; delete to recalibrate.\n"
+         << "machine = " << machine << "\n"
+         << "inputs = " << inputs << "\n"
+         << "fft_size = " << result.fft_size << "\n"
+         << "buffer_frames = " << result.buffer_frames << "\n"
+         << "fft_backend = " << result.fft_backend << "\n"
+         << "latency_ms = " << result.latency_ms << "\n"
+         << "cpu_percent = " << result.cpu_percent << "\n"
+         << "within_budget = " << (result.within_budget ? "true" : "false") << "\n";
+    if (!file) {
+        std::cerr << "Autotune: cannot write " << cache_path(config) << "; calibrating again next time." << std::endl;
+    }
+}
+
+// How far over budget a candidate is; at most 1.0 if it fits.
+static double budget_use(const Config &config, const TuningResult &r) {
+    return std::max(r.latency_ms / config.latency_budget_ms, r.cpu_percent / config.cpu_budget);
+}
+
+// True if a is the better choice: fits, then larger FFT, then shorter block, then cheaper.
+static bool better(const Config &config, const TuningResult &a, const TuningResult &b) {
+    if (a.within_budget != b.within_budget) {
+        return a.within_budget;
+    }
+    if (!a.within_budget) {
+        return budget_use(config, a) < budget_use(config, b);
+    }
+    if (a.fft_size != b.fft_size) {
+        return a.fft_size > b.fft_size;
+    }
+    if (a.buffer_frames != b.buffer_frames) {
+        return a.buffer_frames < b.buffer_frames;
+    }
+    return a.cpu_percent < b.cpu_percent;
+}
+
+/**
+ * @brief Picks fft_size, buffer_frames and fft_backend for this machine.
+ * @param config Settings to tune; fft_size, buffer_frames and fft_backend are replaced.
+ * @param strip The LED output whose encoder is timed.
+ * @param layout LED layout, or nullptr.
+ */
+TuningResult autotune(Config &config, LedOutput &strip, const LedLayout *layout) {
+    const std::string machine = machine_id();
+    const std::string inputs = tuning_inputs(config, strip);
+    TuningResult best = {0, 0, "", 0, 0, false, false};
+
+    if (!config.state_dir.empty() && load_cache(config, machine, inputs, best)) {
+        best.cached = true;
+    } else {
+        const std::vector<float> audio = calibration_audio(config.sample_rate);
+        const Measurement encode = time_encode(config, strip, layout);
+        const double led_fps = std::min(config.led_fps, strip.max_frame_rate());
+        bool found = false;
+
+        for (int fft_size : candidate_fft_sizes) {
+            for (FftBackend backend : {FFT_BACKEND_FFTW, FFT_BACKEND_Q15}) {
+                std::unique_ptr<Analyzer> analyzer;
+                try {
+                    analyzer = build_analyzer(config, fft_size, backend);
+                } catch (const std::runtime_error &) {
+                    continue; // Not a valid size for these options (e.g. too many bands)
+                }
+                const double window_ms = 1000.0 * fft_size * config.decimation / config.sample_rate;
+
+                for (int block : candidate_blocks) {
+                    if (block / config.decimation > fft_size) {
+                        continue; // Samples would go unanalysed
+                    }
+                    const Measurement dsp = time_analysis(config, *analyzer, block, audio);
+                    TuningResult r;
+                    r.fft_size = fft_size;
+                    r.buffer_frames = block;
+                    r.fft_backend = backend == FFT_BACKEND_Q15 ? "q15" : "fftw";
+                    r.latency_ms = 1000.0 * block / config.sample_rate + window_ms / 2 +
+                                   (dsp.slow_us + encode.slow_us) / 1000.0;
+                    r.cpu_percent = (dsp.mean_us * config.sample_rate / block + encode.mean_us * led_fps) / 1e4;
+                    r.within_budget = r.latency_ms <= config.latency_budget_ms && r.cpu_percent <= config.cpu_budget;
+                    r.cached = false;
+                    if (!found || better(config, r, best)) {
+                        best = r;
+                        found = true;
+                    }
+                }
+            }
+        }
+        if (!found) {
+            throw std::runtime_error("Error: Autotune found no usable analysis settings.");
+        }
+        if (!config.state_dir.empty()) {
+            save_cache(config, machine, inputs, best);
+        }
+    }
+
+    config.fft_size = best.fft_size;
+    config.buffer_frames = best.buffer_frames;
+    config.fft_backend = best.fft_backend;
+    return best;
+}
+
+/**
+ * @brief Path of the FFTW wisdom file in state_dir.
+ */
+std::string fftw_wisdom_path(const Config &config) {
+    return config.state_dir + "/fftw.wisdom";
+}
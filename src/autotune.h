@@ -0,0 +1,49 @@
+#ifndef _AUTOTUNE_H_
+#define _AUTOTUNE_H_
+
+#include <string>
+
+#include "config.h"
+#include "led_layout.h"
+#include "led_output.h"
+
+/**
+ * @brief The settings the auto-tuner chose and what it measured for them.
+ */
+struct TuningResult {
+    int fft_size;
+    int buffer_frames;
+    std::string fft_backend;
+    double latency_ms;      // Estimated capture-to-wire latency
+    double cpu_percent;     // Of one core, for the analysis and encode path
+    bool within_budget;     // False if nothing fitted and the closest was taken
+    bool cached;            // Read from the cache instead of measured
+};
+
+/**
+ * @brief Picks fft_size, buffer_frames and fft_backend for this machine.
+ *
+ * Every candidate FFT size, capture block size and FFT backend is timed on
+ * the real path: decimation, the analyzer, the feature stage (rhythm, note
+ * tracking and harmony) and the LED encoder, fed with synthetic audio. The
+ * latency estimate is one capture block, half the analysis window (its
+ * centre lags the newest sample by that much) and the slowest 5% of the
+ * measured processing. The highest frequency resolution that fits
+ * latency_budget_ms and cpu_budget wins, then the shortest block, then the
+ * lower CPU load.
+ *
+ * With state_dir set the choice is cached there next to the FFTW wisdom, keyed
+ * by the CPU and every option that affects it, so later boots skip the
+ * measurement. Delete the cache to recalibrate.
+ * @param config Settings to tune; fft_size, buffer_frames and fft_backend are replaced.
+ * @param strip The LED output whose encoder is timed.
+ * @param layout LED layout, or nullptr.
+ */
+TuningResult autotune(Config &config, LedOutput &strip, const LedLayout *layout);
+
+/**
+ * @brief Path of the FFTW wisdom file in state_dir.
+ */
+std::string fftw_wisdom_path(const Config &config);
+
+#endif // _AUTOTUNE_H_
@@ -0,0 +1,66 @@
+#ifndef _BUFFER_POOL_H_
+#define _BUFFER_POOL_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "spsc_queue.h"
+
+/**
+ * @class BufferPool
+ * @brief Fixed set of preallocated buffers handed out by pointer.
+ *
+ * One thread acquires (the producer of a stage link) and one thread releases
+ * (its consumer). Nothing is allocated after construction.
+ */
+template <typename T>
+class BufferPool {
+public:
+    /**
+     * @brief Constructor that allocates every buffer up front.
+     * @param count Number of buffers.
+     * @param init Called once per buffer to size it, e.g. resize its vectors.
+     */
+    template <typename Init>
+    BufferPool(size_t count, Init init) : free_list(count) {
+        for (size_t i = 0; i < count; i++) {
+            storage.push_back(std::unique_ptr<T>(new T()));
+            init(*storage.back());
+            free_list.push(storage.back().get());
+        }
+    }
+
+    /**
+     * @brief Takes a free buffer. Producer thread only.
+     * @return nullptr if every buffer is in flight.
+     */
+    T *acquire() {
+        T *buf = nullptr;
+        free_list.pop(buf);
+        return buf;
+    }
+
+    /**
+     * @brief Returns a buffer to the pool. Consumer thread only.
+     */
+    void release(T *buf) {
+        free_list.push(buf);
+    }
+
+    /**
+     * @brief Visits every buffer, e.g. to pre-fault them. Only while no stage is running.
+     */
+    template <typename Fn>
+    void for_each(Fn fn) {
+        for (auto &buf : storage) {
+            fn(*buf);
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<T>> storage;
+    SpscQueue<T*> free_list;
+};
+
+#endif // _BUFFER_POOL_H_
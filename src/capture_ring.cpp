@@ -0,0 +1,63 @@
+#include "capture_ring.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "realtime.h"
+
+/**
+ * @brief Constructor that creates the double mapping.
+ * @param min_capacity Samples the ring must hold; rounded up to a power of two of whole pages.
+ * @param max_write Most samples one write_pointer()/commit() pair may write.
+ * @throws std::runtime_error if the memory cannot be mapped.
+ */
+CaptureRing::CaptureRing(size_t min_capacity, size_t max_write) : max_write(max_write), total(0) {
+    const size_t page_samples = static_cast<size_t>(sysconf(_SC_PAGESIZE)) / sizeof(float);
+    size_t capacity = page_samples;
+    while (capacity < min_capacity || capacity < max_write) {
+        capacity <<= 1;
+    }
+    mask = capacity - 1;
+    const size_t bytes = capacity * sizeof(float);
+
+    int fd = memfd_create("chromesthat-capture", MFD_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("Error: Cannot create the capture ring: ") + strerror(errno));
+    }
+    if (ftruncate(fd, bytes) < 0) {
+        close(fd);
+        throw std::runtime_error(std::string("Error: Cannot size the capture ring: ") + strerror(errno));
+    }
+
+    // Reserve both halves in one go, then map the same pages over each.
+    void *mem = mmap(nullptr, 2 * bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error(std::string("Error: Cannot reserve the capture ring: ") + strerror(errno));
+    }
+    char *first = static_cast<char*>(mem);
+    if (mmap(first, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(first + bytes, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        int err = errno;
+        munmap(mem, 2 * bytes);
+        close(fd);
+        throw std::runtime_error(std::string("Error: Cannot map the capture ring: ") + strerror(err));
+    }
+    close(fd);
+    base = reinterpret_cast<float*>(first);
+}
+
+CaptureRing::~CaptureRing() {
+    munmap(base, 2 * capacity() * sizeof(float));
+}
+
+/**
+ * @brief Touches both mappings so they are resident before streaming starts.
+ */
+void CaptureRing::prefault() {
+    realtime_prefault(base, 2 * capacity() * sizeof(float));
+}
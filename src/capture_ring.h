@@ -0,0 +1,82 @@
+#ifndef _CAPTURE_RING_H_
+#define _CAPTURE_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class CaptureRing
+ * @brief Decimated sample history, mapped twice back to back so every window is one span.
+ *
+ * The same pages appear at base and at base + capacity(), so the newest n
+ * samples (n <= capacity()) are always contiguous in memory: the decimator
+ * writes its output straight into the ring and the analyzers window their
+ * input straight out of it, with no wrap split and no staging copy. The
+ * mapping is page-aligned, which also satisfies FFTW's SIMD alignment.
+ *
+ * One writer thread; readers on other threads check holds() after reading
+ * to find out whether the writer lapped them meanwhile.
+ */
+class CaptureRing {
+public:
+    /**
+     * @brief Constructor that creates the double mapping.
+     * @param min_capacity Samples the ring must hold; rounded up to a power of two of whole pages.
+     * @param max_write Most samples one write_pointer()/commit() pair may write.
+     * @throws std::runtime_error if the memory cannot be mapped.
+     */
+    CaptureRing(size_t min_capacity, size_t max_write);
+    ~CaptureRing();
+
+    CaptureRing(const CaptureRing&) = delete;
+    CaptureRing &operator=(const CaptureRing&) = delete;
+
+    /**
+     * @brief Where the next samples go; room for max_write contiguous samples. Writer only.
+     */
+    float *write_pointer() { return base + (total.load(std::memory_order_relaxed) & mask); }
+
+    /**
+     * @brief Publishes count samples written at write_pointer(). Writer only.
+     */
+    void commit(size_t count) { total.store(total.load(std::memory_order_relaxed) + count, std::memory_order_release); }
+
+    /**
+     * @brief Total samples committed since construction.
+     */
+    uint64_t written() const { return total.load(std::memory_order_acquire); }
+
+    /**
+     * @brief The samples from stream position from on, as one span of up to capacity() samples.
+     */
+    const float *span(uint64_t from) const { return base + (from & mask); }
+
+    /**
+     * @brief The newest n samples, oldest first. Zero before enough were written.
+     */
+    const float *newest(size_t n) const { return span(written() - n); }
+
+    /**
+     * @brief True if the samples from position from on have not been overwritten, even partly.
+     *
+     * Call after reading: the writer may already be filling the next max_write
+     * samples past written().
+     */
+    bool holds(uint64_t from) const { return written() + max_write - from <= capacity(); }
+
+    size_t capacity() const { return mask + 1; }
+
+    /**
+     * @brief Touches both mappings so they are resident before streaming starts.
+     */
+    void prefault();
+
+private:
+    float *base;
+    size_t mask;
+    size_t max_write;
+    std::atomic<uint64_t> total;
+};
+
+#endif // _CAPTURE_RING_H_
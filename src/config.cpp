@@ -0,0 +1,469 @@
+#include "config.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "analyzer_bank.h"
+#include "led_strip.h"
+
+static std::string trim(const std::string &s) {
+    size_t start = s.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) {
+        return "";
+    }
+    size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(start, end - start + 1);
+}
+
+static int to_int(const std::string &key, const std::string &value) {
+    try {
+        size_t used;
+        int v = std::stoi(value, &used);
+        if (used == value.size()) {
+            return v;
+        }
+    } catch (const std::exception &) {
+    }
+    throw std::runtime_error("Error: Option '" + key + "' expects an integer, got '" + value + "'.");
+}
+
+static double to_double(const std::string &key, const std::string &value) {
+    try {
+        size_t used;
+        double v = std::stod(value, &used);
+        if (used == value.size()) {
+            return v;
+        }
+    } catch (const std::exception &) {
+    }
+    throw std::runtime_error("Error: Option '" + key + "' expects a number, got '" + value + "'.");
+}
+
+static bool to_bool(const std::string &key, const std::string &value) {
+    if (value == "1" || value == "true" || value == "yes" || value == "on") {
+        return true;
+    }
+    if (value == "0" || value == "false" || value == "no" || value == "off") {
+        return false;
+    }
+    throw std::runtime_error("Error: Option '" + key + "' expects true or false, got '" + value + "'.");
+}
+
+/**
+ * @brief Sets one option from its textual key and value.
+ * @throws std::runtime_error for unknown keys or malformed values.
+ */
+void config_set(Config &config, const std::string &raw_key, const std::string &value) {
+    std::string key = raw_key;
+    for (char &c : key) {
+        if (c == '-') c = '_';
+    }
+
+    if (key == "audio_device")        config.audio_device = value;
+    else if (key == "sample_rate")    config.sample_rate = to_int(key, value);
+    else if (key == "buffer_frames")  config.buffer_frames = to_int(key, value);
+    else if (key == "input") {
+        if (value != "device" && value != "pipe" && value != "udp" && value != "rtp") {
+            throw std::runtime_error("Error: Option 'input' must be device, pipe, udp or rtp, got '" + value + "'.");
+        }
+        config.input = value;
+    }
+    else if (key == "input_path")     config.input_path = value;
+    else if (key == "input_host")     config.input_host = value;
+    else if (key == "input_port")     config.input_port = to_int(key, value);
+    else if (key == "input_format") {
+        if (value != "s16" && value != "s16be" && value != "s24be" && value != "f32") {
+            throw std::runtime_error("Error: Option 'input_format' must be s16, s16be, s24be or f32, got '" + value + "'.");
+        }
+        config.input_format = value;
+    }
+    else if (key == "input_channels") config.input_channels = to_int(key, value);
+    else if (key == "jitter_ms")      config.jitter_ms = to_int(key, value);
+    else if (key == "decimation")     config.decimation = to_int(key, value);
+    else if (key == "fft_size")       config.fft_size = to_int(key, value);
+    else if (key == "analysis_bands") config.analysis_bands = to_int(key, value);
+    else if (key == "min_freq")       config.min_freq = to_int(key, value);
+    else if (key == "min_magnitude")  config.min_magnitude = to_double(key, value);
+    else if (key == "note_release_ms") config.note_release_ms = static_cast<float>(to_double(key, value));
+    else if (key == "window")         config.window = window_from_name(value);
+    else if (key == "kaiser_beta")    config.kaiser_beta = to_double(key, value);
+    else if (key == "fft_backend") {
+        if (value != "fftw" && value != "q15") {
+            throw std::runtime_error("Error: Option 'fft_backend' expects fftw or q15, got '" + value + "'.");
+        }
+        config.fft_backend = value;
+    }
+    else if (key == "hires_fft_size") config.hires_fft_size = to_int(key, value);
+    else if (key == "hires_hop_ms")   config.hires_hop_ms = static_cast<float>(to_double(key, value));
+    else if (key == "hires_threads")  config.hires_threads = to_int(key, value);
+    else if (key == "hires_cpus") {
+        config.hires_cpus.clear();
+        std::stringstream list(value);
+        std::string item;
+        while (std::getline(list, item, ',')) {
+            item = trim(item);
+            if (!item.empty()) {
+                int cpu = to_int(key, item);
+                if (cpu < 0) {
+                    throw std::runtime_error("Error: Option 'hires_cpus' expects CPU numbers, got '" + item + "'.");
+                }
+                config.hires_cpus.push_back(cpu);
+            }
+        }
+    }
+    else if (key == "num_leds")       config.num_leds = to_int(key, value);
+    else if (key == "layout")         config.layout = value;
+    else if (key == "output") {
+        if (value != "spi" && value != "e131" && value != "artnet") {
+            throw std::runtime_error("Error: Option 'output' expects spi, e131 or artnet, got '" + value + "'.");
+        }
+        config.output = value;
+    }
+    else if (key == "output_host")    config.output_host = value;
+    else if (key == "output_port")    config.output_port = to_int(key, value);
+    else if (key == "output_universe") config.output_universe = to_int(key, value);
+    else if (key == "output_sync_universe") config.output_sync_universe = to_int(key, value);
+    else if (key == "spi_device")     config.spi_device = value;
+    else if (key == "spi_speed")      config.spi_speed = static_cast<uint32_t>(to_int(key, value));
+    else if (key == "led_fps")        config.led_fps = static_cast<float>(to_double(key, value));
+    else if (key == "led_attack_ms")  config.led_attack_ms = static_cast<float>(to_double(key, value));
+    else if (key == "led_decay_ms")   config.led_decay_ms = static_cast<float>(to_double(key, value));
+    else if (key == "led_beat_pulse") config.led_beat_pulse = static_cast<float>(to_double(key, value));
+    else if (key == "colour_mode") {
+        if (value != "notes" && value != "chord" && value != "key") {
+            throw std::runtime_error("Error: Option 'colour_mode' expects notes, chord or key, got '" + value + "'.");
+        }
+        config.colour_mode = value;
+    }
+    else if (key == "led_supply_ma") {
+        const int ma = to_int(key, value);
+        if (ma < 0) {
+            throw std::runtime_error("Error: Option '" + raw_key + "' is out of range: '" + value + "'.");
+        }
+        config.led_supply_ma = static_cast<uint32_t>(ma);
+    }
+    else if (key == "shm_feed") {
+        if (!value.empty() && (value[0] != '/' || value.find('/', 1) != std::string::npos)) {
+            throw std::runtime_error("Error: Option 'shm_feed' expects a name like /chromesthat, got '" + value + "'.");
+        }
+        config.shm_feed = value;
+    }
+    else if (key == "record_path")    config.record_path = value;
+    else if (key == "spectrum_log_path") config.spectrum_log_path = value;
+    else if (key == "spectrum_log_bits") config.spectrum_log_bits = to_int(key, value);
+    else if (key == "trace_notes")    config.trace_notes = to_bool(key, value);
+    else if (key == "autotune")       config.autotune = to_bool(key, value);
+    else if (key == "latency_budget_ms") config.latency_budget_ms = static_cast<float>(to_double(key, value));
+    else if (key == "cpu_budget")     config.cpu_budget = static_cast<float>(to_double(key, value));
+    else if (key == "state_dir")      config.state_dir = value;
+    else if (key == "realtime")       config.realtime = to_bool(key, value);
+    else if (key == "audio_priority") config.audio_priority = to_int(key, value);
+    else if (key == "analysis_cpu")   config.analysis_cpu = to_int(key, value);
+    else if (key == "analysis_priority") config.analysis_priority = to_int(key, value);
+    else if (key == "led_cpu")        config.led_cpu = to_int(key, value);
+    else if (key == "led_priority")   config.led_priority = to_int(key, value);
+    else if (key == "list_devices")   config.list_devices = to_bool(key, value);
+    else {
+        throw std::runtime_error("Error: Unknown option '" + raw_key + "'.");
+    }
+
+    if (config.sample_rate <= 0 || config.buffer_frames <= 0 ||
+        config.fft_size < MIN_FFT_SIZE || config.fft_size > MAX_FFT_SIZE || (config.fft_size & (config.fft_size - 1)) ||
+        config.input_port < 1 || config.input_port > 65535 ||
+        config.input_channels < 1 || config.input_channels > 32 ||
+        config.jitter_ms < 0 || config.jitter_ms > 2000 || config.min_freq < 0 || config.kaiser_beta < 0 ||
+        config.note_release_ms < 0 || config.note_release_ms > 10000 ||
+        (config.hires_fft_size != 0 && config.hires_fft_size != 65536 && config.hires_fft_size != 131072 &&
+         config.hires_fft_size != 262144) ||
+        config.hires_hop_ms < 10 || config.hires_hop_ms > 60000 ||
+        config.hires_threads < 1 || config.hires_threads > 64 ||
+        (config.spectrum_log_bits != 8 && config.spectrum_log_bits != 16) ||
+        config.latency_budget_ms <= 0 || config.latency_budget_ms > 10000 ||
+        config.cpu_budget <= 0 || config.cpu_budget > 100 ||
+        config.analysis_bands < 1 || config.analysis_bands > MAX_ANALYSIS_BANDS ||
+        config.num_leds <= 0 || config.led_fps <= 0 || config.led_attack_ms <= 0 || config.led_decay_ms <= 0 ||
+        config.led_beat_pulse < 0 || config.led_beat_pulse > 1 ||
+        config.audio_priority < 1 || config.audio_priority > 99 ||
+        config.analysis_priority < 1 || config.analysis_priority > 99 ||
+        config.led_priority < 1 || config.led_priority > 99 ||
+        config.analysis_cpu < -1 || config.led_cpu < -1 ||
+        config.output_port < 0 || config.output_port > 65535 ||
+        config.output_universe < 0 || config.output_universe > 63999 ||
+        config.output_sync_universe < 0 || config.output_sync_universe > 63999 ||
+        (config.decimation != 1 && config.decimation != 2 && config.decimation != 4 && config.decimation != 8)) {
+        throw std::runtime_error("Error: Option '" + raw_key + "' is out of range: '" + value + "'.");
+    }
+}
+
+// Strip lengths with a painter compiled in (see make_note_painter()); others need a layout.
+static bool painter_compiled(int num_leds) {
+    switch (num_leds) {
+    case 48: case 60: case 144: case 300: case 600: case 1024: case 2048: case 4096:
+        return true;
+    }
+    return false;
+}
+
+// Checks between options, once all are set, so they can be given in any order.
+static void check_combination(const Config &config) {
+    if (config.analysis_bands > 1 && (config.fft_size >> (config.analysis_bands - 1)) < MIN_FFT_SIZE) {
+        throw std::runtime_error("Error: " + std::to_string(config.analysis_bands) + " analysis bands need fft_size " +
+                                 std::to_string(MIN_FFT_SIZE << (config.analysis_bands - 1)) + " or more.");
+    }
+    if (config.output == "spi" && config.led_supply_ma > 0 &&
+        config.led_supply_ma <= static_cast<uint32_t>(config.num_leds) * LED_IDLE_MA) {
+        throw std::runtime_error("Error: led_supply_ma " + std::to_string(config.led_supply_ma) + " does not cover the " +
+                                 std::to_string(config.num_leds * LED_IDLE_MA) + " mA that " +
+                                 std::to_string(config.num_leds) + " dark LEDs draw.");
+    }
+    if (config.layout.empty() && !painter_compiled(config.num_leds)) {
+        throw std::runtime_error("Error: Unsupported LED count " + std::to_string(config.num_leds) +
+                                 " (supported: 48, 60, 144, 300, 600, 1024, 2048, 4096, or any with a layout).");
+    }
+}
+
+/**
+ * @brief Applies every "key = value" line of a config file.
+ * @throws std::runtime_error if the file cannot be read or a line is invalid.
+ */
+void config_load_file(Config &config, const std::string &path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Error: Cannot open config file '" + path + "'.");
+    }
+
+    std::string line;
+    int line_no = 0;
+    while (std::getline(file, line)) {
+        line_no++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+        line = trim(line);
+        if (line.empty()) {
+            continue;
+        }
+
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            throw std::runtime_error("Error: " + path + ":" + std::to_string(line_no) + ": expected 'key = value'.");
+        }
+        try {
+            config_set(config, trim(line.substr(0, eq)), trim(line.substr(eq + 1)));
+        } catch (const std::runtime_error &e) {
+            throw std::runtime_error(path + ":" + std::to_string(line_no) + ": " + e.what());
+        }
+    }
+}
+
+/**
+ * @brief Builds the configuration from defaults, the config file and command-line overrides.
+ *
+ * Command-line options always win over the file, including on reload.
+ * @param args Command-line arguments without the program name.
+ * @throws std::runtime_error on invalid arguments or config file contents.
+ */
+Config config_from_args(const std::vector<std::string> &args) {
+    Config config;
+    std::vector<std::pair<std::string, std::string>> overrides;
+
+    for (size_t i = 0; i < args.size(); i++) {
+        const std::string &arg = args[i];
+        if (arg.compare(0, 2, "--") != 0) {
+            throw std::runtime_error("Error: Unexpected argument '" + arg + "'.");
+        }
+
+        std::string key = arg.substr(2);
+        std::string value;
+        size_t eq = key.find('=');
+        if (eq != std::string::npos) {
+            value = key.substr(eq + 1);
+            key = key.substr(0, eq);
+        } else if (key == "list-devices" || key == "list_devices" || key == "realtime" ||
+                   key == "autotune") {
+            value = "true";
+        } else if (i + 1 < args.size()) {
+            value = args[++i];
+        } else {
+            throw std::runtime_error("Error: Option '" + arg + "' needs a value.");
+        }
+
+        if (key == "config") {
+            config.config_path = value;
+        } else {
+            overrides.push_back(std::make_pair(key, value));
+        }
+    }
+
+    if (!config.config_path.empty()) {
+        config_load_file(config, config.config_path);
+    }
+    for (const auto &kv : overrides) {
+        config_set(config, kv.first, kv.second);
+    }
+    check_combination(config);
+
+    return config;
+}
+
+/**
+ * @brief True if going from a to b changes options that need a restart to apply.
+ */
+bool config_needs_restart(const Config &a, const Config &b) {
+    return a.audio_device != b.audio_device ||
+           a.sample_rate != b.sample_rate ||
+           a.buffer_frames != b.buffer_frames ||
+           a.input != b.input ||
+           a.input_path != b.input_path ||
+           a.input_host != b.input_host ||
+           a.input_port != b.input_port ||
+           a.input_format != b.input_format ||
+           a.input_channels != b.input_channels ||
+           a.jitter_ms != b.jitter_ms ||
+           a.decimation != b.decimation ||
+           a.fft_backend != b.fft_backend ||
+           a.hires_fft_size != b.hires_fft_size ||
+           a.hires_hop_ms != b.hires_hop_ms ||
+           a.hires_threads != b.hires_threads ||
+           a.hires_cpus != b.hires_cpus ||
+           a.num_leds != b.num_leds ||
+           a.layout != b.layout ||
+           a.output != b.output ||
+           a.output_host != b.output_host ||
+           a.output_port != b.output_port ||
+           a.output_universe != b.output_universe ||
+           a.output_sync_universe != b.output_sync_universe ||
+           a.spi_device != b.spi_device ||
+           a.spi_speed != b.spi_speed ||
+           a.led_fps != b.led_fps ||
+           a.led_supply_ma != b.led_supply_ma ||
+           a.shm_feed != b.shm_feed ||
+           a.record_path != b.record_path ||
+           a.spectrum_log_path != b.spectrum_log_path ||
+           a.spectrum_log_bits != b.spectrum_log_bits ||
+           a.autotune != b.autotune ||
+           a.latency_budget_ms != b.latency_budget_ms ||
+           a.cpu_budget != b.cpu_budget ||
+           a.state_dir != b.state_dir ||
+           a.realtime != b.realtime ||
+           a.audio_priority != b.audio_priority ||
+           a.analysis_cpu != b.analysis_cpu ||
+           a.analysis_priority != b.analysis_priority ||
+           a.led_cpu != b.led_cpu ||
+           a.led_priority != b.led_priority;
+}
+
+/**
+ * @brief Copies every option that needs a restart from running into next, so a
+ * reload applies only what can change live and next describes what runs.
+ * Must list the same options as config_needs_restart().
+ */
+void config_keep_restart_options(const Config &running, Config &next) {
+    next.audio_device = running.audio_device;
+    next.sample_rate = running.sample_rate;
+    next.buffer_frames = running.buffer_frames;
+    next.input = running.input;
+    next.input_path = running.input_path;
+    next.input_host = running.input_host;
+    next.input_port = running.input_port;
+    next.input_format = running.input_format;
+    next.input_channels = running.input_channels;
+    next.jitter_ms = running.jitter_ms;
+    next.decimation = running.decimation;
+    next.fft_backend = running.fft_backend;
+    next.hires_fft_size = running.hires_fft_size;
+    next.hires_hop_ms = running.hires_hop_ms;
+    next.hires_threads = running.hires_threads;
+    next.hires_cpus = running.hires_cpus;
+    next.num_leds = running.num_leds;
+    next.layout = running.layout;
+    next.output = running.output;
+    next.output_host = running.output_host;
+    next.output_port = running.output_port;
+    next.output_universe = running.output_universe;
+    next.output_sync_universe = running.output_sync_universe;
+    next.spi_device = running.spi_device;
+    next.spi_speed = running.spi_speed;
+    next.led_fps = running.led_fps;
+    next.led_supply_ma = running.led_supply_ma;
+    next.shm_feed = running.shm_feed;
+    next.record_path = running.record_path;
+    next.spectrum_log_path = running.spectrum_log_path;
+    next.spectrum_log_bits = running.spectrum_log_bits;
+    next.autotune = running.autotune;
+    next.latency_budget_ms = running.latency_budget_ms;
+    next.cpu_budget = running.cpu_budget;
+    next.state_dir = running.state_dir;
+    next.realtime = running.realtime;
+    next.audio_priority = running.audio_priority;
+    next.analysis_cpu = running.analysis_cpu;
+    next.analysis_priority = running.analysis_priority;
+    next.led_cpu = running.led_cpu;
+    next.led_priority = running.led_priority;
+}
+
+/**
+ * @brief Prints the command-line usage and the available options.
+ */
+void config_print_usage(const char *program) {
+    Config d;
+    std::cout << "Usage: " << program << " [--config FILE] [--list-devices] [--autotune] [--realtime] [--OPTION VALUE ...]\n"
+              << "\nOptions (also accepted as 'option = value' in the config file):\n"
+              << "  --audio-device NAME|ID   Input device, by name substring or ID (default input)\n"
+              << "  --sample-rate HZ         Capture sample rate (" << d.sample_rate << ")\n"
+              << "  --buffer-frames N        Samples per capture block (" << d.buffer_frames << ")\n"
+              << "  --input TYPE             device, pipe, udp or rtp (" << d.input << ")\n"
+              << "  --input-path PATH        pipe: file or FIFO, - = stdin (" << d.input_path << ")\n"
+              << "  --input-host ADDR        udp/rtp: local address or multicast group (any)\n"
+              << "  --input-port PORT        udp/rtp: port to listen on (" << d.input_port << ")\n"
+              << "  --input-format FMT       s16, s16be, s24be or f32 (" << d.input_format << ")\n"
+              << "  --input-channels N       Interleaved channels, mixed to mono (" << d.input_channels << ")\n"
+              << "  --jitter-ms MS           Buffered before playout, 0 = none (" << d.jitter_ms << ")\n"
+              << "  --decimation N           Downsample by 1, 2, 4 or 8 before the FFT (" << d.decimation << ")\n"
+              << "  --fft-size N             FFT window, a power of two 256-16384 (" << d.fft_size << ") [live]\n"
+              << "  --analysis-bands N       FFT sizes per analysis, 1-" << MAX_ANALYSIS_BANDS << " (" << d.analysis_bands << ") [live]\n"
+              << "  --min-freq HZ            Lowest analysed frequency (" << d.min_freq << ") [live]\n"
+              << "  --min-magnitude M        Note detection threshold (" << d.min_magnitude << ") [live]\n"
+              << "  --note-release-ms MS     Hold a note this long after it is lost (" << d.note_release_ms << ") [live]\n"
+              << "  --window NAME            rectangular, hann, blackman-harris or kaiser (" << window_name(d.window) << ") [live]\n"
+              << "  --kaiser-beta B          Kaiser window shape (" << d.kaiser_beta << ") [live]\n"
+              << "  --fft-backend NAME       fftw, or q15 for a Q15 integer FFT core (" << d.fft_backend << ")\n"
+              << "  --hires-fft-size N       High-resolution analysis: 65536, 131072 or 262144, 0 = off (" << d.hires_fft_size << ")\n"
+              << "  --hires-hop-ms MS        Time between high-resolution frames (" << d.hires_hop_ms << ")\n"
+              << "  --hires-threads N        FFTW threads for the high-resolution FFT (" << d.hires_threads << ")\n"
+              << "  --hires-cpus LIST        CPUs for the high-resolution FFT, e.g. 2,3 (any)\n"
+              << "  --num-leds N             LEDs on the strip (" << d.num_leds << ")\n"
+              << "  --layout FILE            Matrix, ring and segment layout of the LEDs\n"
+              << "  --output TYPE            spi, e131 or artnet (" << d.output << ")\n"
+              << "  --spi-device PATH        SPI device (" << d.spi_device << ")\n"
+              << "  --spi-speed HZ           SPI clock (" << d.spi_speed << ")\n"
+              << "  --output-host ADDR       Controller IPv4 address (E1.31 multicast / Art-Net broadcast)\n"
+              << "  --output-port PORT       UDP port, 0 = protocol default (" << d.output_port << ")\n"
+              << "  --output-universe U      Universe of the first pixel (" << d.output_universe << ")\n"
+              << "  --output-sync-universe U E1.31 sync universe, 0 = after the last (" << d.output_sync_universe << ")\n"
+              << "  --led-fps FPS            Render rate (" << d.led_fps << ")\n"
+              << "  --led-attack-ms MS       Note fade-in time (" << d.led_attack_ms << ") [live]\n"
+              << "  --led-decay-ms MS        Note fade-out time (" << d.led_decay_ms << ") [live]\n"
+              << "  --led-beat-pulse D       Dim between beats, 0-1 (" << d.led_beat_pulse << ") [live]\n"
+              << "  --colour-mode MODE       notes, or light the current chord or key (" << d.colour_mode << ") [live]\n"
+              << "  --led-supply-ma MA       Supply current budget, 0 = none (" << d.led_supply_ma << ")\n"
+              << "  --shm-feed NAME          Publish frames to POSIX shared memory, e.g. /chromesthat\n"
+              << "  --record-path FILE       Record rendered LED frames for chromesthat_replay\n"
+              << "  --spectrum-log-path FILE Archive every spectrum, note and beat for chromesthat_review\n"
+              << "  --spectrum-log-bits N    Bits per archived spectrum bin: 8 or 16 (" << d.spectrum_log_bits << ")\n"
+              << "  --trace-notes B          Log note-ons, note-offs and chord changes (" << (d.trace_notes ? "true" : "false") << ") [live]\n"
+              << "  --autotune               Measure this machine and choose fft_size, buffer_frames, fft_backend\n"
+              << "  --latency-budget-ms MS   Most latency autotune may choose (" << d.latency_budget_ms << ")\n"
+              << "  --cpu-budget PERCENT     Most CPU autotune may use, of one core (" << d.cpu_budget << ")\n"
+              << "  --state-dir DIR          Keep FFTW wisdom and the autotune result here\n"
+              << "  --realtime               Lock memory, pin threads and use SCHED_FIFO\n"
+              << "  --audio-priority P       Audio callback priority, 1-99 (" << d.audio_priority << ")\n"
+              << "  --analysis-cpu N         Pin analysis to CPU N, -1 = any (" << d.analysis_cpu << ")\n"
+              << "  --analysis-priority P    Analysis priority, 1-99 (" << d.analysis_priority << ")\n"
+              << "  --led-cpu N              Pin LED output to CPU N, -1 = any (" << d.led_cpu << ")\n"
+              << "  --led-priority P         LED output priority, 1-99 (" << d.led_priority << ")\n"
+              << "\nOptions marked [live] are picked up when the config file changes." << std::endl;
+}
@@ -0,0 +1,135 @@
+#ifndef _CONFIG_H_
+#define _CONFIG_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "window.h"
+
+/**
+ * @struct Config
+ * @brief Every runtime tunable, loaded from a config file and command-line overrides.
+ *
+ * File format is one "key = value" per line; '#' starts a comment. The same
+ * keys are accepted on the command line as "--key value" (dashes or underscores).
+ */
+struct Config {
+    // Audio capture (restart required)
+    std::string audio_device;       // Device name (substring match) or ID; empty = default input
+    int sample_rate = 44100;
+    int buffer_frames = 2048;       // Samples per capture block
+
+    // Streamed PCM instead of an audio device (restart required)
+    std::string input = "device";   // device, pipe, udp or rtp
+    std::string input_path = "-";   // pipe: file or FIFO to read; "-" = stdin
+    std::string input_host;         // udp/rtp: local address or multicast group; empty = any
+    int input_port = 5004;          // udp/rtp: port to listen on
+    std::string input_format = "s16"; // s16, s16be, s24be or f32 (little-endian unless "be")
+    int input_channels = 1;         // Interleaved channels, mixed down to mono
+    int jitter_ms = 20;             // Audio buffered before playout; 0 = pass blocks on at once
+
+    // Analysis (hot-reloadable unless noted)
+    int decimation = 1;             // Downsample by 1, 2, 4 or 8 before the FFT (restart required)
+    int fft_size = 2048;            // Longest FFT window
+    int analysis_bands = 1;         // FFT sizes run at once, halving per octave (1 = single FFT)
+    int min_freq = 70;              // Bins below this frequency (Hz) are ignored
+    double min_magnitude = 45;      // Bin magnitude needed to count as a note
+    float note_release_ms = 80;     // A tracked note stays on this long after its peak is lost
+    WindowType window = WINDOW_HANN;
+    double kaiser_beta = 8.6;       // Kaiser window shape; higher = lower sidelobes, wider peaks
+    std::string fft_backend = "fftw"; // fftw (double) or q15 (integer, for CPUs without fast floating point)
+
+    // High-resolution analysis for tuning work, beside the LED path (restart required)
+    int hires_fft_size = 0;         // 65536, 131072 or 262144 points; 0 = off
+    float hires_hop_ms = 250;       // Time between high-resolution frames
+    int hires_threads = 2;          // FFTW threads for the large transform
+    std::vector<int> hires_cpus;    // CPUs for it and its FFTW threads; empty = any
+
+    // LED output (restart required unless noted)
+    int num_leds = 48;
+    std::string layout;             // LED layout file (see led_layout.h); empty = twelve runs along the strip
+    std::string output = "spi";     // spi, e131 or artnet
+    std::string spi_device = "/dev/spidev0.0";
+    uint32_t spi_speed = 2400000;   // Hz
+    std::string output_host;        // Controller address; empty = multicast (E1.31) or broadcast (Art-Net)
+    int output_port = 0;            // 0 = protocol default
+    int output_universe = 1;        // Universe of the first pixel
+    int output_sync_universe = 0;   // E1.31 sync universe; 0 = the one after the last data universe
+    float led_fps = 120;            // Render rate, clamped to the strip's limit
+    float led_attack_ms = 15;       // Note fade-in time constant (hot-reloadable)
+    float led_decay_ms = 250;       // Note fade-out time constant (hot-reloadable)
+    float led_beat_pulse = 0;       // Dim between beats by this much, 0.0 - 1.0 (hot-reloadable)
+    std::string colour_mode = "notes"; // notes, chord or key: what lights each pitch class (hot-reloadable)
+    uint32_t led_supply_ma = 2000;  // Current budget for the strip's supply (0 = no limit)
+
+    // Shared-memory feed of every analysis frame (restart required)
+    std::string shm_feed;           // POSIX shm name, e.g. "/chromesthat"; empty = off
+
+    // Record every rendered LED frame for chromesthat_replay (restart required)
+    std::string record_path;        // Frame log to write; empty = off
+
+    // Archive every analysis frame for chromesthat_review (restart required)
+    std::string spectrum_log_path;  // Spectrum log to write; empty = off
+    int spectrum_log_bits = 8;      // 8 or 16 bits per spectrum bin
+
+    // Logging (hot-reloadable)
+    bool trace_notes = false;       // Log every note-on and note-off, and chord and key changes
+
+    // Startup calibration (restart required)
+    bool autotune = false;          // Measure and choose fft_size, buffer_frames and fft_backend
+    float latency_budget_ms = 60;   // Most estimated capture-to-wire latency autotune may choose
+    float cpu_budget = 50;          // Most CPU autotune may spend, percent of one core
+    std::string state_dir;          // FFTW wisdom and autotune cache; empty = keep neither
+
+    // Real-time mode (restart required)
+    bool realtime = false;          // mlockall, CPU pinning and SCHED_FIFO
+    int audio_priority = 90;        // SCHED_FIFO priority of the RtAudio callback thread
+    int analysis_cpu = -1;          // CPU for the analysis thread, -1 = any
+    int analysis_priority = 80;
+    int led_cpu = -1;               // CPU for the LED render thread, -1 = any
+    int led_priority = 70;
+
+    // Command line only
+    std::string config_path;        // Config file to load and watch; empty = none
+    bool list_devices = false;      // Print the audio devices and exit
+};
+
+/**
+ * @brief Sets one option from its textual key and value.
+ * @throws std::runtime_error for unknown keys or malformed values.
+ */
+void config_set(Config &config, const std::string &key, const std::string &value);
+
+/**
+ * @brief Applies every "key = value" line of a config file.
+ * @throws std::runtime_error if the file cannot be read or a line is invalid.
+ */
+void config_load_file(Config &config, const std::string &path);
+
+/**
+ * @brief Builds the configuration from defaults, the config file and command-line overrides.
+ *
+ * Command-line options always win over the file, including on reload.
+ * @param args Command-line arguments without the program name.
+ * @throws std::runtime_error on invalid arguments or config file contents.
+ */
+Config config_from_args(const std::vector<std::string> &args);
+
+/**
+ * @brief True if going from a to b changes options that need a restart to apply.
+ */
+bool config_needs_restart(const Config &a, const Config &b);
+
+/**
+ * @brief Copies every option that needs a restart from running into next, so a
+ * reload applies only what can change live and next describes what runs.
+ */
+void config_keep_restart_options(const Config &running, Config &next);
+
+/**
+ * @brief Prints the command-line usage and the available options.
+ */
+void config_print_usage(const char *program);
+
+#endif // _CONFIG_H_
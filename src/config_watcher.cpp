@@ -0,0 +1,92 @@
+#include "config_watcher.h"
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <sys/stat.h>
+
+/**
+ * @brief Constructor.
+ * @param args The command-line arguments the current config was built from.
+ * @param current The configuration currently running.
+ * @param on_change Called on the watcher thread after a successful reload.
+ * @param poll_ms How often to check the file's modification time.
+ */
+ConfigWatcher::ConfigWatcher(const std::vector<std::string> &args, const Config &current, Callback on_change, int poll_ms)
+    : args(args), current(current), on_change(on_change), poll_ms(poll_ms), last_mtime(0), stopping(false) {
+    file_mtime(last_mtime);
+}
+
+ConfigWatcher::~ConfigWatcher() {
+    stop();
+}
+
+/**
+ * @brief Starts the watcher thread. Does nothing if there is no config file.
+ */
+void ConfigWatcher::start() {
+    if (current.config_path.empty() || watch_thread.joinable()) {
+        return;
+    }
+    stopping = false;
+    watch_thread = std::thread(&ConfigWatcher::run, this);
+}
+
+/**
+ * @brief Stops the watcher thread and waits for it to exit.
+ */
+void ConfigWatcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex);
+        stopping = true;
+    }
+    stop_cv.notify_all();
+    if (watch_thread.joinable()) {
+        watch_thread.join();
+    }
+}
+
+bool ConfigWatcher::file_mtime(time_t &mtime) const {
+    struct stat st;
+    if (current.config_path.empty() || stat(current.config_path.c_str(), &st) != 0) {
+        return false;
+    }
+    mtime = st.st_mtime;
+    return true;
+}
+
+void ConfigWatcher::run() {
+    std::unique_lock<std::mutex> lock(stop_mutex);
+    while (!stop_cv.wait_for(lock, std::chrono::milliseconds(poll_ms), [this] { return stopping; })) {
+        time_t mtime;
+        if (!file_mtime(mtime) || mtime == last_mtime) {
+            continue;
+        }
+        last_mtime = mtime;
+
+        Config next;
+        try {
+            next = config_from_args(args);
+        } catch (const std::runtime_error &e) {
+            // Keep running on the old settings until the file is fixed.
+            std::cerr << "Config reload failed: " << e.what() << std::endl;
+            continue;
+        }
+
+        if (config_needs_restart(current, next)) {
+            std::cerr << "Config reload: some changed options only take effect after a restart." << std::endl;
+            // Running capture and buffers were sized from these; keep them until then.
+            config_keep_restart_options(current, next);
+        }
+
+        lock.unlock();
+        try {
+            on_change(current, next);
+            current = next;
+            std::cout << "Config reloaded from " << current.config_path << std::endl;
+        } catch (const std::exception &e) {
+            std::cerr << "Config reload failed: " << e.what() << std::endl;
+        }
+        lock.lock();
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef _CONFIG_WATCHER_H_
+#define _CONFIG_WATCHER_H_
+
+#include <condition_variable>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+
+/**
+ * @class ConfigWatcher
+ * @brief Polls the config file from a background thread and reports changes.
+ *
+ * On every modification the file is re-read with the original command-line
+ * overrides applied on top, and the callback runs on the watcher thread with
+ * the new configuration. Expensive rebuilds (FFT plans, tables) therefore
+ * happen here, never on the audio or analysis threads.
+ */
+class ConfigWatcher {
+public:
+    typedef std::function<void(const Config &old_config, const Config &new_config)> Callback;
+
+    /**
+     * @brief Constructor.
+     * @param args The command-line arguments the current config was built from.
+     * @param current The configuration currently running.
+     * @param on_change Called on the watcher thread after a successful reload.
+     * @param poll_ms How often to check the file's modification time.
+     */
+    ConfigWatcher(const std::vector<std::string> &args, const Config &current, Callback on_change, int poll_ms = 1000);
+    ~ConfigWatcher();
+
+    /**
+     * @brief Starts the watcher thread. Does nothing if there is no config file.
+     */
+    void start();
+
+    /**
+     * @brief Stops the watcher thread and waits for it to exit.
+     */
+    void stop();
+
+private:
+    std::vector<std::string> args;
+    Config current;
+    Callback on_change;
+    int poll_ms;
+    time_t last_mtime;
+
+    std::thread watch_thread;
+    std::mutex stop_mutex;
+    std::condition_variable stop_cv;
+    bool stopping;
+
+    void run();
+    bool file_mtime(time_t &mtime) const;
+};
+
+#endif // _CONFIG_WATCHER_H_
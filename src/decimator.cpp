@@ -0,0 +1,101 @@
+#include "decimator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+// Independent partial sums in the dot product. Without them the compiler must
+// keep the float additions in order and cannot use SIMD; 8 fills an AVX
+// register or two NEON registers.
+#define LANES 8
+
+/**
+ * @brief Constructor that designs the filter and preallocates the state.
+ * @param factor Decimation factor: 1 (pass-through), 2, 4 or 8.
+ * @param max_block Largest number of input samples passed to one process() call.
+ * @throws std::runtime_error for unsupported factors.
+ */
+Decimator::Decimator(int factor, int max_block) : m(factor), buffered(0) {
+    if (factor != 1 && factor != 2 && factor != 4 && factor != 8) {
+        throw std::runtime_error("Error: Unsupported decimation factor " + std::to_string(factor) +
+                                 " (supported: 1, 2, 4, 8).");
+    }
+
+    // Windowed-sinc low-pass cut off at the output Nyquist frequency, 0.5 / m.
+    // The Blackman-Harris main lobe spreads the transition over +-4 / length,
+    // +-0.0625 / m at 64 taps per phase: the passband is flat to 0.4375 / m and
+    // everything from 0.5625 / m is over 100 dB down, so aliases only fold into
+    // the top 12.5% of the output band.
+    const int length = m == 1 ? 1 : TAPS_PER_PHASE * m - 1;
+    const double cutoff = 0.5 / m; // In cycles per input sample
+    std::vector<double> h(length);
+    double sum = 0;
+    for (int i = 0; i < length; i++) {
+        double t = i - (length - 1) / 2.0;
+        double sinc = t == 0 ? 2 * cutoff : std::sin(2 * M_PI * cutoff * t) / (M_PI * t);
+        double x = length > 1 ? 2 * M_PI * i / (length - 1) : 0;
+        double window = 0.35875 - 0.48829 * std::cos(x) + 0.14128 * std::cos(2 * x) - 0.01168 * std::cos(3 * x);
+        h[i] = sinc * (length > 1 ? window : 1.0);
+        sum += h[i];
+    }
+
+    // Unity gain at DC, time-reversed, zero-padded at the oldest end.
+    num_taps = (length + LANES - 1) / LANES * LANES;
+    taps.assign(num_taps, 0.0f);
+    for (int i = 0; i < length; i++) {
+        taps[num_taps - 1 - i] = static_cast<float>(h[i] / sum);
+    }
+
+    buffer.assign(num_taps - 1 + max_block, 0.0f);
+    reset();
+}
+
+/**
+ * @brief Forgets the carried-over input (e.g. after a gap in the stream).
+ */
+void Decimator::reset() {
+    std::fill(buffer.begin(), buffer.end(), 0.0f);
+    buffered = num_taps - 1;
+}
+
+/**
+ * @brief Filters and downsamples one block. Never allocates.
+ * @param in Input samples.
+ * @param count Number of input samples, at most max_block.
+ * @param out Output, room for max_output(count) samples.
+ * @return Number of samples written to out.
+ */
+int Decimator::process(const float *in, int count, float *out) {
+    if (m == 1) {
+        std::copy(in, in + count, out);
+        return count;
+    }
+
+    std::copy(in, in + count, buffer.begin() + buffered);
+    buffered += count;
+
+    // buffer[pos .. pos + num_taps) ends at the newest input the output depends on.
+    const float *h = taps.data();
+    int written = 0;
+    int pos = 0;
+    for (; pos + num_taps <= buffered; pos += m) {
+        const float *x = buffer.data() + pos;
+        float acc[LANES] = {};
+        for (int i = 0; i < num_taps; i += LANES) {
+            for (int l = 0; l < LANES; l++) {
+                acc[l] += h[i + l] * x[i + l];
+            }
+        }
+        float y = 0;
+        for (int l = 0; l < LANES; l++) {
+            y += acc[l];
+        }
+        out[written++] = y;
+    }
+
+    // Keep the inputs the next output still needs.
+    std::copy(buffer.begin() + pos, buffer.begin() + buffered, buffer.begin());
+    buffered -= pos;
+    return written;
+}
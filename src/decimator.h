@@ -0,0 +1,61 @@
+#ifndef _DECIMATOR_H_
+#define _DECIMATOR_H_
+
+#include <vector>
+
+/**
+ * @class Decimator
+ * @brief Streaming anti-aliased downsampler for the analysis front end.
+ *
+ * A linear-phase FIR low-pass is evaluated only at every factor-th input
+ * sample (the polyphase saving: no output is computed just to be thrown
+ * away). The last taps - 1 inputs are carried across calls, so blocks of any
+ * size produce the same output as one long block.
+ */
+class Decimator {
+public:
+    // Filter length per output phase; longer gives a steeper transition band.
+    // 64 keeps the band up to 87.5% of the output Nyquist frequency alias-free.
+    static const int TAPS_PER_PHASE = 64;
+
+    /**
+     * @brief Constructor that designs the filter and preallocates the state.
+     * @param factor Decimation factor: 1 (pass-through), 2, 4 or 8.
+     * @param max_block Largest number of input samples passed to one process() call.
+     * @throws std::runtime_error for unsupported factors.
+     */
+    Decimator(int factor, int max_block);
+
+    /**
+     * @brief The decimation factor.
+     */
+    int factor() const { return m; }
+
+    /**
+     * @brief Most outputs one process() call of count inputs can produce.
+     */
+    int max_output(int count) const { return count / m + 1; }
+
+    /**
+     * @brief Filters and downsamples one block. Never allocates.
+     * @param in Input samples.
+     * @param count Number of input samples, at most max_block.
+     * @param out Output, room for max_output(count) samples.
+     * @return Number of samples written to out.
+     */
+    int process(const float *in, int count, float *out);
+
+    /**
+     * @brief Forgets the carried-over input (e.g. after a gap in the stream).
+     */
+    void reset();
+
+private:
+    int m;
+    int num_taps;            // Padded to a multiple of LANES
+    std::vector<float> taps; // Time-reversed, so each output is a straight dot product
+    std::vector<float> buffer;
+    int buffered;            // Valid samples at the start of buffer
+};
+
+#endif // _DECIMATOR_H_
@@ -0,0 +1,158 @@
+#include "frame_log.h"
+
+#include <cstring>
+#include <stdexcept>
+
+static uint8_t *put_varint(uint8_t *out, size_t value) {
+    while (value >= 0x80) {
+        *out++ = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<uint8_t>(value);
+    return out;
+}
+
+static bool get_varint(const uint8_t *&in, const uint8_t *end, size_t &value) {
+    value = 0;
+    for (int shift = 0; in < end && shift < 64; shift += 7) {
+        uint8_t b = *in++;
+        value |= static_cast<size_t>(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Largest payload frame_log_encode_delta() can produce for size bytes.
+ */
+size_t frame_log_max_delta(size_t size) {
+    // Worst case alternates one unchanged and one changed byte: 2 varints + 1 byte per 2 bytes.
+    return (size / 2 + 1) * (2 * 10 + 1) + 20;
+}
+
+/**
+ * @brief Encodes cur as changes against prev.
+ * @param prev Previous frame bytes.
+ * @param cur Current frame bytes.
+ * @param size Bytes per frame.
+ * @param out Output, at least frame_log_max_delta(size) bytes.
+ * @return Bytes written to out.
+ */
+size_t frame_log_encode_delta(const uint8_t *prev, const uint8_t *cur, size_t size, uint8_t *out) {
+    uint8_t *start = out;
+    size_t pos = 0;
+    while (pos < size) {
+        size_t skip = 0;
+        while (pos + skip < size && prev[pos + skip] == cur[pos + skip]) {
+            skip++;
+        }
+        pos += skip;
+
+        // Extend the literal run over short unchanged gaps: a new pair costs at least 2 bytes.
+        size_t count = 0;
+        while (pos + count < size) {
+            if (prev[pos + count] != cur[pos + count]) {
+                count++;
+            } else if (pos + count + 2 < size && (prev[pos + count + 1] != cur[pos + count + 1] ||
+                                                   prev[pos + count + 2] != cur[pos + count + 2])) {
+                count++;
+            } else {
+                break;
+            }
+        }
+
+        out = put_varint(out, skip);
+        out = put_varint(out, count);
+        std::memcpy(out, cur + pos, count);
+        out += count;
+        pos += count;
+    }
+    return static_cast<size_t>(out - start);
+}
+
+/**
+ * @brief Applies a delta payload to a frame in place.
+ * @return False if the payload is malformed.
+ */
+bool frame_log_apply_delta(const uint8_t *delta, size_t delta_size, uint8_t *frame, size_t size) {
+    const uint8_t *in = delta;
+    const uint8_t *end = delta + delta_size;
+    size_t pos = 0;
+    while (in < end) {
+        size_t skip, count;
+        if (!get_varint(in, end, skip) || !get_varint(in, end, count)) {
+            return false;
+        }
+        if (skip > size - pos || count > size - pos - skip || count > static_cast<size_t>(end - in)) {
+            return false;
+        }
+        pos += skip;
+        std::memcpy(frame + pos, in, count);
+        in += count;
+        pos += count;
+    }
+    return true;
+}
+
+/**
+ * @brief Constructor that opens the log and reads its header.
+ * @throws std::runtime_error if the file cannot be read or is not a frame log.
+ */
+FrameLogReader::FrameLogReader(const std::string &path) : have_keyframe(false) {
+    file = fopen(path.c_str(), "rb");
+    if (!file) {
+        throw std::runtime_error("Error: Cannot open frame log '" + path + "'.");
+    }
+    if (fread(&file_header, sizeof(file_header), 1, file) != 1 ||
+        std::memcmp(file_header.magic, FRAME_LOG_MAGIC, sizeof(file_header.magic)) != 0 ||
+        file_header.version != FRAME_LOG_VERSION || file_header.num_leds == 0) {
+        fclose(file);
+        throw std::runtime_error("Error: '" + path + "' is not a frame log.");
+    }
+    pixels.assign(file_header.num_leds, {0, 0, 0});
+}
+
+FrameLogReader::~FrameLogReader() {
+    fclose(file);
+}
+
+/**
+ * @brief Reads the next frame.
+ * @param record Output, the frame's record.
+ * @return The frame's pixels (valid until the next call), or nullptr at the
+ *         end of the log or at a truncated or corrupt record.
+ */
+const Pixel *FrameLogReader::next(FrameLogRecord &record) {
+    const size_t frame_size = pixels.size() * sizeof(Pixel);
+    uint8_t *frame = reinterpret_cast<uint8_t *>(pixels.data());
+
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+        if (record.payload_size > frame_log_max_delta(frame_size)) {
+            return nullptr;
+        }
+        payload.resize(record.payload_size);
+        if (record.payload_size > 0 && fread(payload.data(), record.payload_size, 1, file) != 1) {
+            return nullptr;
+        }
+
+        if (record.type == FRAME_LOG_KEYFRAME) {
+            if (record.payload_size != frame_size) {
+                return nullptr;
+            }
+            std::memcpy(frame, payload.data(), frame_size);
+            have_keyframe = true;
+            return pixels.data();
+        }
+        if (record.type != FRAME_LOG_DELTA ||
+            !frame_log_apply_delta(payload.data(), payload.size(), frame, frame_size)) {
+            return nullptr;
+        }
+        // Deltas before the first keyframe have nothing to apply to.
+        if (have_keyframe) {
+            return pixels.data();
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,105 @@
+#ifndef _FRAME_LOG_H_
+#define _FRAME_LOG_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "led_output.h"
+
+// Binary log of rendered LED frames, written by FrameRecorder and read back
+// by the replay tool. Layout (host byte order, little-endian on every target
+// we build for):
+//
+//   FrameLogHeader
+//   { FrameLogRecord, payload[payload_size] } ...
+//
+// A keyframe payload is the raw RGB bytes. A delta payload describes the
+// change from the previous frame as (skip, count, count new bytes) triples,
+// skip and count being LEB128 varints; a frame identical to the previous one
+// is a single (num_leds * 3, 0) pair. Keyframes are written periodically so a
+// log that was cut short (crash, power loss) still replays up to the cut.
+
+#define FRAME_LOG_MAGIC   "CHRMLOG1"
+#define FRAME_LOG_VERSION 1
+
+enum FrameLogType {
+    FRAME_LOG_KEYFRAME = 0,
+    FRAME_LOG_DELTA = 1
+};
+
+struct FrameLogHeader {
+    char magic[8];              // FRAME_LOG_MAGIC, not NUL-terminated
+    uint32_t version;
+    uint32_t num_leds;
+    int64_t start_unix_ns;      // Wall clock when recording started
+    float frame_rate;           // Render rate at the time of recording
+    uint32_t keyframe_interval; // Frames between keyframes
+};
+
+struct FrameLogRecord {
+    uint64_t time_ns;           // Render time since the start of the recording
+    uint64_t seq;               // Render frame counter
+    uint64_t source_seq;        // Capture block the frame was rendered from
+    uint32_t type;              // FrameLogType
+    uint32_t payload_size;
+};
+
+static_assert(sizeof(FrameLogHeader) == 32 && sizeof(FrameLogRecord) == 32,
+              "Frame log structs must have no padding");
+
+/**
+ * @brief Largest payload frame_log_encode_delta() can produce for size bytes.
+ */
+size_t frame_log_max_delta(size_t size);
+
+/**
+ * @brief Encodes cur as changes against prev.
+ * @param prev Previous frame bytes.
+ * @param cur Current frame bytes.
+ * @param size Bytes per frame.
+ * @param out Output, at least frame_log_max_delta(size) bytes.
+ * @return Bytes written to out.
+ */
+size_t frame_log_encode_delta(const uint8_t *prev, const uint8_t *cur, size_t size, uint8_t *out);
+
+/**
+ * @brief Applies a delta payload to a frame in place.
+ * @return False if the payload is malformed.
+ */
+bool frame_log_apply_delta(const uint8_t *delta, size_t delta_size, uint8_t *frame, size_t size);
+
+/**
+ * @class FrameLogReader
+ * @brief Reads a frame log sequentially, reconstructing every frame.
+ */
+class FrameLogReader {
+public:
+    /**
+     * @brief Constructor that opens the log and reads its header.
+     * @throws std::runtime_error if the file cannot be read or is not a frame log.
+     */
+    explicit FrameLogReader(const std::string &path);
+    ~FrameLogReader();
+
+    const FrameLogHeader &header() const { return file_header; }
+
+    /**
+     * @brief Reads the next frame.
+     * @param record Output, the frame's record.
+     * @return The frame's pixels (valid until the next call), or nullptr at the
+     *         end of the log or at a truncated or corrupt record.
+     */
+    const Pixel *next(FrameLogRecord &record);
+
+private:
+    FILE *file;
+    FrameLogHeader file_header;
+    std::vector<uint8_t> payload;
+    std::vector<Pixel> pixels;
+    bool have_keyframe;
+};
+
+#endif // _FRAME_LOG_H_
@@ -0,0 +1,164 @@
+#include "frame_recorder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "realtime.h"
+
+// Frames in flight between the encode stage and the writer (about 0.5 s at 120 fps).
+#define RECORDER_BUFFERS 64
+
+// A keyframe every this many frames bounds what a damaged log can lose.
+#define KEYFRAME_INTERVAL 600
+
+// How often the writer flushes to the file so a crash loses at most this much.
+#define FLUSH_INTERVAL_MS 1000
+
+// How long the idle writer waits before re-checking for stop().
+#define WRITER_WAIT_MS 100
+
+/**
+ * @brief Constructor that creates the log file and writes its header.
+ * @param path File to write; an existing file is replaced.
+ * @param num_leds Pixels per frame.
+ * @param frame_rate Render rate, stored for information.
+ * @throws std::runtime_error if the file cannot be created.
+ */
+FrameRecorder::FrameRecorder(const std::string &path, uint32_t num_leds, float frame_rate)
+    : num_leds(num_leds),
+      queue(RECORDER_BUFFERS, DROP_NEWEST, [num_leds](PixelFrame &f) {
+          f.pixels.resize(num_leds);
+      }),
+      writer("recorder", [this]() { write_step(); }),
+      started(false), failed(false), previous(num_leds * sizeof(Pixel)),
+      payload(frame_log_max_delta(num_leds * sizeof(Pixel))), frames_written(0) {
+
+    file = fopen(path.c_str(), "wb");
+    if (!file) {
+        throw std::runtime_error("Error: Cannot create frame log '" + path + "'.");
+    }
+
+    FrameLogHeader header;
+    std::memcpy(header.magic, FRAME_LOG_MAGIC, sizeof(header.magic));
+    header.version = FRAME_LOG_VERSION;
+    header.num_leds = num_leds;
+    header.start_unix_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    header.frame_rate = frame_rate;
+    header.keyframe_interval = KEYFRAME_INTERVAL;
+    if (fwrite(&header, sizeof(header), 1, file) != 1) {
+        fclose(file);
+        throw std::runtime_error("Error: Cannot write frame log '" + path + "'.");
+    }
+    last_flush = clock::now();
+}
+
+/**
+ * @brief Destructor that writes out queued frames and closes the file.
+ */
+FrameRecorder::~FrameRecorder() {
+    stop();
+    fclose(file);
+}
+
+/**
+ * @brief Starts the writer thread.
+ */
+void FrameRecorder::start(std::function<void()> init) {
+    writer.start(init);
+}
+
+/**
+ * @brief Stops the writer thread after it has written every queued frame.
+ */
+void FrameRecorder::stop() {
+    writer.stop();
+    PixelFrame *frame;
+    while ((frame = queue.try_receive()) != nullptr) {
+        write_frame(*frame);
+        queue.release(frame);
+    }
+    fflush(file);
+}
+
+/**
+ * @brief Queues a frame for writing. Never blocks; single producer thread only.
+ */
+void FrameRecorder::record(const PixelFrame &frame) {
+    PixelFrame *copy = queue.acquire();
+    if (!copy) {
+        return;
+    }
+    copy->seq = frame.seq;
+    copy->source_seq = frame.source_seq;
+    copy->time = frame.time;
+    std::copy(frame.pixels.begin(), frame.pixels.begin() + num_leds, copy->pixels.begin());
+    queue.send(copy);
+}
+
+/**
+ * @brief Touches every pooled buffer so it is resident before streaming starts.
+ */
+void FrameRecorder::prefault() {
+    queue.for_each([](PixelFrame &f) {
+        realtime_prefault(f.pixels.data(), f.pixels.size() * sizeof(Pixel));
+    });
+    realtime_prefault(previous.data(), previous.size());
+    realtime_prefault(payload.data(), payload.size());
+}
+
+void FrameRecorder::write_step() {
+    PixelFrame *frame = queue.receive(WRITER_WAIT_MS);
+    if (frame) {
+        write_frame(*frame);
+        queue.release(frame);
+    }
+
+    clock::time_point now = clock::now();
+    if (now - last_flush >= std::chrono::milliseconds(FLUSH_INTERVAL_MS)) {
+        fflush(file);
+        last_flush = now;
+    }
+}
+
+void FrameRecorder::write_frame(const PixelFrame &frame) {
+    if (failed) {
+        return;
+    }
+    if (!started) {
+        start_time = frame.time;
+        started = true;
+    }
+
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(frame.pixels.data());
+    const size_t size = previous.size();
+
+    FrameLogRecord record;
+    record.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(frame.time - start_time).count();
+    record.seq = frame.seq;
+    record.source_seq = frame.source_seq;
+
+    const uint8_t *data;
+    if (frames_written % KEYFRAME_INTERVAL == 0) {
+        record.type = FRAME_LOG_KEYFRAME;
+        record.payload_size = static_cast<uint32_t>(size);
+        data = bytes;
+    } else {
+        record.type = FRAME_LOG_DELTA;
+        record.payload_size = static_cast<uint32_t>(
+            frame_log_encode_delta(previous.data(), bytes, size, payload.data()));
+        data = payload.data();
+    }
+
+    if (fwrite(&record, sizeof(record), 1, file) != 1 ||
+        (record.payload_size > 0 && fwrite(data, record.payload_size, 1, file) != 1)) {
+        // Disk full or similar: stop recording, but keep the show running.
+        std::cerr << "Frame recorder: write failed, recording stopped." << std::endl;
+        failed = true;
+        return;
+    }
+    std::memcpy(previous.data(), bytes, size);
+    frames_written++;
+}
@@ -0,0 +1,85 @@
+#ifndef _FRAME_RECORDER_H_
+#define _FRAME_RECORDER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "frame_log.h"
+#include "frames.h"
+#include "stage.h"
+
+/**
+ * @class FrameRecorder
+ * @brief Appends every rendered LED frame to a frame log (see frame_log.h).
+ *
+ * record() only copies the pixels into a pooled buffer and queues it, so the
+ * calling stage pays one memcpy per frame. Delta encoding and file writes
+ * happen on the recorder's own thread. If that thread falls behind, frames
+ * are dropped (and counted) rather than delaying the caller.
+ */
+class FrameRecorder {
+public:
+    /**
+     * @brief Constructor that creates the log file and writes its header.
+     * @param path File to write; an existing file is replaced.
+     * @param num_leds Pixels per frame.
+     * @param frame_rate Render rate, stored for information.
+     * @throws std::runtime_error if the file cannot be created.
+     */
+    FrameRecorder(const std::string &path, uint32_t num_leds, float frame_rate);
+
+    /**
+     * @brief Destructor that writes out queued frames and closes the file.
+     */
+    ~FrameRecorder();
+
+    /**
+     * @brief Starts the writer thread.
+     */
+    void start(std::function<void()> init = std::function<void()>());
+
+    /**
+     * @brief Stops the writer thread after it has written every queued frame.
+     */
+    void stop();
+
+    /**
+     * @brief Queues a frame for writing. Never blocks; single producer thread only.
+     */
+    void record(const PixelFrame &frame);
+
+    /**
+     * @brief Frames dropped because the writer thread fell behind.
+     */
+    uint64_t dropped_count() const { return queue.dropped_count(); }
+
+    /**
+     * @brief Touches every pooled buffer so it is resident before streaming starts.
+     */
+    void prefault();
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    FILE *file;
+    uint32_t num_leds;
+    StageLink<PixelFrame> queue;
+    StageThread writer;
+
+    // Writer thread state
+    clock::time_point start_time;
+    bool started;
+    bool failed;                     // A write failed; nothing more is recorded
+    std::vector<uint8_t> previous;   // Last frame written, for deltas
+    std::vector<uint8_t> payload;    // Encoded delta scratch
+    uint64_t frames_written;
+    clock::time_point last_flush;
+
+    void write_step();
+    void write_frame(const PixelFrame &frame);
+};
+
+#endif // _FRAME_RECORDER_H_
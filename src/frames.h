@@ -0,0 +1,69 @@
+#ifndef _FRAMES_H_
+#define _FRAMES_H_
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "analyzer.h"
+#include "led_output.h"
+#include "notes.h"
+#include "partial_tracker.h"
+
+// Buffers passed by pointer between pipeline stages. Every vector is sized once
+// when its pool is created and never reallocated afterwards.
+
+// Capture -> FFT: one block of mono samples as delivered by the audio callback.
+struct AudioBlock {
+    uint64_t seq;           // Capture block counter
+    double stream_time;     // RtAudio stream time of the first sample (s)
+    unsigned int frames;    // Valid samples
+    std::vector<float> samples;
+};
+
+// FFT -> features: bin magnitudes of one analysis window.
+struct SpectrumFrame {
+    uint64_t seq;           // Newest capture block included
+    double stream_time;
+    std::shared_ptr<Analyzer> analyzer; // Analyzer that produced it (owns the bin tables)
+    uint64_t analyzer_generation;       // Changes whenever the analyzer is replaced
+    int num_bins;
+    int peak_bin;           // Strongest bin, 0 if below threshold
+    std::vector<double> magnitudes;
+};
+
+// Features -> colour mapping: per pitch class results and rhythm.
+struct NoteFrame {
+    uint64_t seq;
+    double stream_time;
+    std::chrono::steady_clock::time_point time; // When the frame was published
+    float levels[NUM_NOTES];
+    double magnitudes[NUM_NOTES];
+    float onset_strength;   // 0.0 - 1.0
+    bool onset;             // An onset was detected in this frame
+    float bpm;
+    float beat_phase;       // 0.0 on the beat - 1.0, at time
+    float beat_confidence;  // 0.0 - 1.0
+    int num_events;         // Note-ons and note-offs since the previous frame
+    NoteEvent events[MAX_NOTE_EVENTS];
+    int chord;              // HarmonyEstimator chord index, HARMONY_NO_CHORD if none
+    int key;                // HarmonyEstimator key index
+    float chord_confidence; // 0.0 - 1.0
+};
+
+// Colour mapping -> encode: one rendered LED frame.
+struct PixelFrame {
+    uint64_t seq;           // Render frame counter
+    uint64_t source_seq;    // Capture block the frame was rendered from
+    std::chrono::steady_clock::time_point time; // When the frame is due on the LEDs
+    std::vector<Pixel> pixels;
+};
+
+// Encode -> output: one frame in the output's wire format (SPI bytes or UDP packets).
+struct WireFrame {
+    uint64_t seq;
+    std::vector<uint8_t> bytes;
+};
+
+#endif // _FRAMES_H_
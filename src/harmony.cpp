@@ -0,0 +1,222 @@
+#include "harmony.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Weight of the third and fifth relative to the root in the chord templates.
+#define CHORD_THIRD_WEIGHT 0.8f
+#define CHORD_FIFTH_WEIGHT 0.9f
+// "No chord" wins unless a triad matches the chord history at least this well.
+#define NO_CHORD_SCORE 0.65f
+// Score, in matched-seconds, another state must gain before the estimate changes.
+#define CHORD_SWITCH_COST 0.08f
+#define KEY_SWITCH_COST 1.5f
+// Longest gap between frames the histories treat as continuous (s).
+#define MAX_FRAME_GAP 0.5
+// Levels for lighting by harmony: the root or tonic is full brightness.
+#define CHORD_TONE_LEVEL 0.6f
+#define SCALE_TONE_LEVEL 0.3f
+
+// Krumhansl-Kessler key profiles, from the tonic up.
+static const float major_profile[NUM_NOTES] = {6.35f, 2.23f, 3.48f, 2.33f, 4.38f, 4.09f,
+                                               2.52f, 5.19f, 2.39f, 3.66f, 2.29f, 2.88f};
+static const float minor_profile[NUM_NOTES] = {6.33f, 2.68f, 3.52f, 5.38f, 2.60f, 3.53f,
+                                               2.54f, 4.75f, 3.98f, 2.69f, 3.34f, 3.17f};
+static const int major_scale[7] = {0, 2, 4, 5, 7, 9, 11};
+static const int minor_scale[7] = {0, 2, 3, 5, 7, 8, 10};
+
+// Scales a row to unit length.
+static void normalise(float *row) {
+    float norm = 0;
+    for (int i = 0; i < NUM_NOTES; i++) {
+        norm += row[i] * row[i];
+    }
+    norm = std::sqrt(norm);
+    for (int i = 0; i < NUM_NOTES; i++) {
+        row[i] /= norm;
+    }
+}
+
+// Dense matrix-vector product: scores[r] = templates[r] . v. The fixed inner
+// length lets the compiler unroll and vectorise it.
+template <int ROWS>
+static void score_templates(const float *templates, const float *v, float *scores) {
+    for (int r = 0; r < ROWS; r++) {
+        const float *row = templates + r * NUM_NOTES;
+        float sum = 0;
+        for (int i = 0; i < NUM_NOTES; i++) {
+            sum += row[i] * v[i];
+        }
+        scores[r] = sum;
+    }
+}
+
+// One online Viterbi step with a uniform switching cost: each state either
+// stays or takes over the best path so far, then collects its emission.
+// Returns the best state. Scores are re-based so they stay bounded.
+template <int STATES>
+static int viterbi_step(std::array<float, STATES> &path, const float *emission, float switch_cost) {
+    const float best_prev = *std::max_element(path.begin(), path.end());
+    int best = 0;
+    for (int s = 0; s < STATES; s++) {
+        path[s] = std::max(path[s], best_prev - switch_cost) + emission[s];
+        if (path[s] > path[best]) {
+            best = s;
+        }
+    }
+    const float top = path[best];
+    for (int s = 0; s < STATES; s++) {
+        path[s] = std::max(path[s] - top, -4 * switch_cost);
+    }
+    return best;
+}
+
+/**
+ * @brief Constructor that builds the templates.
+ * @param chord_ms Time constant of the chord chroma history.
+ * @param key_ms Time constant of the key chroma history.
+ */
+HarmonyEstimator::HarmonyEstimator(float chord_ms, float key_ms)
+    : chord_tau(chord_ms / 1000.0f), key_tau(key_ms / 1000.0f) {
+
+    for (int root = 0; root < NUM_NOTES; root++) {
+        for (int minor = 0; minor < 2; minor++) {
+            float *chord = &chord_templates[(root * 2 + minor) * NUM_NOTES];
+            std::fill(chord, chord + NUM_NOTES, 0.0f);
+            chord[root] = 1.0f;
+            chord[(root + (minor ? 3 : 4)) % NUM_NOTES] = CHORD_THIRD_WEIGHT;
+            chord[(root + 7) % NUM_NOTES] = CHORD_FIFTH_WEIGHT;
+            normalise(chord);
+
+            // Key profiles are compared by correlation, so their mean is removed.
+            float *key = &key_templates[(root * 2 + minor) * NUM_NOTES];
+            const float *profile = minor ? minor_profile : major_profile;
+            float mean = 0;
+            for (int i = 0; i < NUM_NOTES; i++) {
+                mean += profile[i] / NUM_NOTES;
+            }
+            for (int i = 0; i < NUM_NOTES; i++) {
+                key[(root + i) % NUM_NOTES] = profile[i] - mean;
+            }
+            normalise(key);
+        }
+    }
+    reset();
+}
+
+/**
+ * @brief Forgets all state.
+ */
+void HarmonyEstimator::reset() {
+    chord_chroma.fill(0.0f);
+    key_chroma.fill(0.0f);
+    chord_path.fill(0.0f);
+    key_path.fill(0.0f);
+    current_chord = HARMONY_NO_CHORD;
+    current_key = 0;
+    chord_match = 0;
+    last_time = 0;
+    started = false;
+}
+
+/**
+ * @brief Feeds one frame. Never allocates.
+ * @param note_magnitudes Strongest bin magnitude per pitch class.
+ * @param stream_time Stream time of the frame (s), for the time constants.
+ */
+void HarmonyEstimator::update(const double note_magnitudes[NUM_NOTES], double stream_time) {
+    double dt = started ? stream_time - last_time : 0.0;
+    dt = std::max(0.0, std::min(MAX_FRAME_GAP, dt));
+    last_time = stream_time;
+    started = true;
+    if (dt <= 0) {
+        return;
+    }
+
+    // Unit-length chroma of this frame, or silence.
+    alignas(16) float chroma[NUM_NOTES];
+    float norm = 0;
+    for (int i = 0; i < NUM_NOTES; i++) {
+        chroma[i] = static_cast<float>(note_magnitudes[i]);
+        norm += chroma[i] * chroma[i];
+    }
+    const float scale = norm > 0 ? 1.0f / std::sqrt(norm) : 0.0f;
+
+    const float chord_keep = std::exp(static_cast<float>(-dt) / chord_tau);
+    const float key_keep = std::exp(static_cast<float>(-dt) / key_tau);
+    float key_mean = 0;
+    for (int i = 0; i < NUM_NOTES; i++) {
+        const float c = chroma[i] * scale;
+        chord_chroma[i] = chord_keep * chord_chroma[i] + (1 - chord_keep) * c;
+        key_chroma[i] = key_keep * key_chroma[i] + (1 - key_keep) * c;
+        key_mean += key_chroma[i] / NUM_NOTES;
+    }
+
+    // Chords: the history against each triad, plus "no chord". Frames are unit
+    // length, so a steady chord scores its cosine and one fading into silence
+    // scores less and less.
+    float emission[NUM_CHORDS + 1];
+    score_templates<NUM_CHORDS>(chord_templates.data(), chord_chroma.data(), emission);
+    emission[HARMONY_NO_CHORD] = NO_CHORD_SCORE;
+    float weighted[NUM_CHORDS + 1];
+    for (int c = 0; c <= NUM_CHORDS; c++) {
+        weighted[c] = emission[c] * static_cast<float>(dt);
+    }
+    current_chord = viterbi_step<NUM_CHORDS + 1>(chord_path, weighted, CHORD_SWITCH_COST);
+    chord_match = current_chord < NUM_CHORDS ? emission[current_chord] : 0.0f;
+
+    // Keys: correlation of the long history with each profile. Silence leaves the key alone.
+    alignas(16) float centred[NUM_NOTES];
+    float key_norm = 0;
+    for (int i = 0; i < NUM_NOTES; i++) {
+        centred[i] = key_chroma[i] - key_mean;
+        key_norm += centred[i] * centred[i];
+    }
+    if (key_norm > 0 && norm > 0) {
+        float key_emission[NUM_KEYS];
+        score_templates<NUM_KEYS>(key_templates.data(), centred, key_emission);
+        const float key_scale = static_cast<float>(dt) / std::sqrt(key_norm);
+        for (int k = 0; k < NUM_KEYS; k++) {
+            key_emission[k] *= key_scale;
+        }
+        current_key = viterbi_step<NUM_KEYS>(key_path, key_emission, KEY_SWITCH_COST);
+    }
+}
+
+/**
+ * @brief Writes a level per pitch class for lighting by chord: root 1.0, other tones less, rest 0.
+ */
+void HarmonyEstimator::chord_levels(float levels[NUM_NOTES]) const {
+    std::fill(levels, levels + NUM_NOTES, 0.0f);
+    if (current_chord >= NUM_CHORDS) {
+        return;
+    }
+    const int root = current_chord / 2;
+    const bool minor = current_chord & 1;
+    levels[(root + (minor ? 3 : 4)) % NUM_NOTES] = CHORD_TONE_LEVEL;
+    levels[(root + 7) % NUM_NOTES] = CHORD_TONE_LEVEL;
+    levels[root] = 1.0f;
+}
+
+/**
+ * @brief Writes a level per pitch class for lighting by key: tonic 1.0, other scale tones less, rest 0.
+ */
+void HarmonyEstimator::key_levels(float levels[NUM_NOTES]) const {
+    std::fill(levels, levels + NUM_NOTES, 0.0f);
+    const int tonic = current_key / 2;
+    const int *scale = current_key & 1 ? minor_scale : major_scale;
+    for (int i = 0; i < 7; i++) {
+        levels[(tonic + scale[i]) % NUM_NOTES] = SCALE_TONE_LEVEL;
+    }
+    levels[tonic] = 1.0f;
+}
+
+/**
+ * @brief Name of a chord or key index, e.g. "F#m"; "-" for HARMONY_NO_CHORD.
+ */
+const char *harmony_name(int index) {
+    static const char *const names[NUM_CHORDS + 1] = {
+        "C", "Cm", "C#", "C#m", "D", "Dm", "D#", "D#m", "E", "Em", "F", "Fm",
+        "F#", "F#m", "G", "Gm", "G#", "G#m", "A", "Am", "A#", "A#m", "B", "Bm", "-"};
+    return index >= 0 && index <= NUM_CHORDS ? names[index] : "-";
+}
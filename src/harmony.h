@@ -0,0 +1,102 @@
+#ifndef _HARMONY_H_
+#define _HARMONY_H_
+
+#include <array>
+#include <cstdint>
+
+#include "notes.h"
+
+// 12 major and 12 minor triads; chord HARMONY_NO_CHORD means none.
+#define NUM_CHORDS 24
+#define HARMONY_NO_CHORD NUM_CHORDS
+// 12 major and 12 minor keys.
+#define NUM_KEYS 24
+
+/**
+ * @class HarmonyEstimator
+ * @brief Chord and key recognition from a running chroma vector.
+ *
+ * Each frame the per-pitch-class magnitudes from detect_notes() are
+ * normalised and folded into two exponentially weighted chroma histories: a
+ * short one for chords and a long one for the key. Each history is scored
+ * against its templates (triads, and Krumhansl-Kessler key profiles) in one
+ * dense dot-product pass over a template matrix, and the scores drive an
+ * online Viterbi step over the chords (plus "no chord") or keys. Changing
+ * state costs a fixed penalty, so the estimate only moves when another state
+ * has been clearly better for a while. The Viterbi state is one score per
+ * candidate; nothing grows with time.
+ */
+class HarmonyEstimator {
+public:
+    /**
+     * @brief Constructor that builds the templates.
+     * @param chord_ms Time constant of the chord chroma history.
+     * @param key_ms Time constant of the key chroma history.
+     */
+    HarmonyEstimator(float chord_ms = 250, float key_ms = 8000);
+
+    /**
+     * @brief Feeds one frame. Never allocates.
+     * @param note_magnitudes Strongest bin magnitude per pitch class.
+     * @param stream_time Stream time of the frame (s), for the time constants.
+     */
+    void update(const double note_magnitudes[NUM_NOTES], double stream_time);
+
+    /**
+     * @brief Forgets all state.
+     */
+    void reset();
+
+    /**
+     * @brief Current chord: root * 2 + (minor ? 1 : 0), or HARMONY_NO_CHORD.
+     */
+    int chord() const { return current_chord; }
+
+    /**
+     * @brief Current key: tonic * 2 + (minor ? 1 : 0).
+     */
+    int key() const { return current_key; }
+
+    /**
+     * @brief How well the chord history matches the chord, 0.0 - 1.0.
+     */
+    float chord_confidence() const { return chord_match; }
+
+    /**
+     * @brief Writes a level per pitch class for lighting by chord: root 1.0, other tones less, rest 0.
+     */
+    void chord_levels(float levels[NUM_NOTES]) const;
+
+    /**
+     * @brief Writes a level per pitch class for lighting by key: tonic 1.0, other scale tones less, rest 0.
+     */
+    void key_levels(float levels[NUM_NOTES]) const;
+
+private:
+    float chord_tau;
+    float key_tau;
+    double last_time;
+    bool started;
+
+    alignas(16) std::array<float, NUM_NOTES> chord_chroma;  // Exponentially weighted unit-length frames
+    alignas(16) std::array<float, NUM_NOTES> key_chroma;
+
+    // Unit-length templates, one row each
+    alignas(16) std::array<float, NUM_CHORDS * NUM_NOTES> chord_templates;
+    alignas(16) std::array<float, NUM_KEYS * NUM_NOTES> key_templates;
+
+    // Online Viterbi: best path score ending in each state
+    std::array<float, NUM_CHORDS + 1> chord_path;
+    std::array<float, NUM_KEYS> key_path;
+
+    int current_chord;
+    int current_key;
+    float chord_match;
+};
+
+/**
+ * @brief Name of a chord or key index, e.g. "F#m"; "-" for HARMONY_NO_CHORD.
+ */
+const char *harmony_name(int index);
+
+#endif // _HARMONY_H_
@@ -0,0 +1,147 @@
+#include "hires_analyzer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#include "notes.h"
+
+/**
+ * @brief Prepares FFTW for multi-threaded plans. Call once, before any other FFTW function.
+ * @return False if FFTW's thread support could not be initialised, or was not built in.
+ */
+bool hires_init_threads() {
+#ifdef CHROMESTHAT_FFTW_THREADS
+    return fftw_init_threads() != 0;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Constructor that allocates the buffers and builds the multi-threaded plan.
+ * @param fft_size Transform size, a power of two from HIRES_MIN_FFT_SIZE to HIRES_MAX_FFT_SIZE.
+ * @param sample_rate Rate of the analysed samples in Hz.
+ * @param min_freq Peaks below this frequency are ignored.
+ * @param min_magnitude Peaks must exceed this magnitude.
+ * @param window_type Analysis window.
+ * @param kaiser_beta Shape of the Kaiser window.
+ * @param threads Threads FFTW may use for the transform (one in builds without FFTW threads).
+ * @throws std::runtime_error on an unsupported size or if FFTW fails.
+ */
+HiresAnalyzer::HiresAnalyzer(int fft_size, double sample_rate, int min_freq, double min_magnitude,
+                             WindowType window_type, double kaiser_beta, int threads)
+    : size(fft_size), bins(fft_size / 2 + 1), bin_hz(sample_rate / fft_size), min_magnitude(min_magnitude) {
+
+    if (fft_size < HIRES_MIN_FFT_SIZE || fft_size > HIRES_MAX_FFT_SIZE || (fft_size & (fft_size - 1)) != 0) {
+        throw std::runtime_error("Error: Unsupported high-resolution FFT size " + std::to_string(fft_size) +
+                                 " (supported: 65536, 131072, 262144).");
+    }
+
+    fft_in = (double*) fftw_malloc(sizeof(double) * size);
+    fft_out = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * bins);
+    window = (double*) fftw_malloc(sizeof(double) * size);
+    magnitudes = (double*) fftw_malloc(sizeof(double) * bins);
+    if (!fft_in || !fft_out || !window || !magnitudes) {
+        fftw_free(fft_in);
+        fftw_free(fft_out);
+        fftw_free(window);
+        fftw_free(magnitudes);
+        throw std::runtime_error("Error: fftw_malloc for the high-resolution analysis failed.");
+    }
+    window_fill(window_type, kaiser_beta, window, size);
+
+    // Only this plan is multi-threaded; plans made afterwards stay single-threaded.
+#ifdef CHROMESTHAT_FFTW_THREADS
+    fftw_plan_with_nthreads(threads);
+#else
+    (void)threads;
+#endif
+    plan = fftw_plan_dft_r2c_1d(size, fft_in, fft_out, FFTW_MEASURE);
+#ifdef CHROMESTHAT_FFTW_THREADS
+    fftw_plan_with_nthreads(1);
+#endif
+    if (!plan) {
+        fftw_free(fft_in);
+        fftw_free(fft_out);
+        fftw_free(window);
+        fftw_free(magnitudes);
+        throw std::runtime_error("Error: fftw_plan_dft_r2c_1d failed for the high-resolution analysis.");
+    }
+
+    min_index = std::max(2, static_cast<int>(min_freq / bin_hz));
+}
+
+HiresAnalyzer::~HiresAnalyzer() {
+    fftw_destroy_plan(plan);
+    fftw_free(fft_in);
+    fftw_free(fft_out);
+    fftw_free(window);
+    fftw_free(magnitudes);
+}
+
+/**
+ * @brief Windows the newest fft_size() samples of the ring into the FFT input.
+ * @return False if not enough samples were written yet or the writer overwrote them mid-copy.
+ */
+bool HiresAnalyzer::load_samples(const CaptureRing &ring) {
+    const uint64_t end = ring.written();
+    if (end < static_cast<uint64_t>(size)) {
+        return false;
+    }
+    const uint64_t from = end - size;
+    const float *samples = ring.span(from);
+    for (int i = 0; i < size; i++) {
+        fft_in[i] = window[i] * samples[i];
+    }
+
+    // The writer may have lapped the oldest samples while they were copied.
+    return ring.holds(from);
+}
+
+/**
+ * @brief Runs the transform and finds the strongest peaks.
+ * @param peaks Output, strongest first.
+ * @param max_peaks Capacity of peaks.
+ * @return Number of peaks written.
+ */
+int HiresAnalyzer::analyse(HiresPeak *peaks, int max_peaks) {
+    fftw_execute(plan);
+    for (int i = 0; i < bins; i++) {
+        magnitudes[i] = std::sqrt(fft_out[i][0] * fft_out[i][0] + fft_out[i][1] * fft_out[i][1]);
+    }
+
+    // Local maxima above the threshold, kept sorted strongest first.
+    int count = 0;
+    for (int i = min_index; i + 1 < bins; i++) {
+        const double m = magnitudes[i];
+        if (m <= min_magnitude || m < magnitudes[i - 1] || m <= magnitudes[i + 1]) {
+            continue;
+        }
+        if (count == max_peaks && m <= peaks[count - 1].magnitude) {
+            continue;
+        }
+
+        // Parabolic interpolation on log magnitude.
+        const double a = std::log(magnitudes[i - 1] + 1e-9);
+        const double b = std::log(m);
+        const double c = std::log(magnitudes[i + 1] + 1e-9);
+        const double denom = a - 2 * b + c;
+        const double delta = denom < 0 ? std::max(-0.5, std::min(0.5, 0.5 * (a - c) / denom)) : 0.0;
+
+        HiresPeak peak;
+        peak.frequency = (i + delta) * bin_hz;
+        peak.magnitude = m;
+        peak.midi = freq_to_midi(peak.frequency);
+        peak.cents = 1200.0 * std::log2(peak.frequency /
+                                        (A4_FREQUENCY * std::pow(2.0, (peak.midi - A4_MIDI_NUMBER) / 12.0)));
+
+        int slot = count < max_peaks ? count++ : max_peaks - 1;
+        for (; slot > 0 && peaks[slot - 1].magnitude < m; slot--) {
+            peaks[slot] = peaks[slot - 1];
+        }
+        peaks[slot] = peak;
+    }
+    return count;
+}
@@ -0,0 +1,87 @@
+#ifndef _HIRES_ANALYZER_H_
+#define _HIRES_ANALYZER_H_
+
+#include <fftw3.h>
+
+#include "capture_ring.h"
+#include "window.h"
+
+// Supported high-resolution transform sizes (powers of two in between).
+#define HIRES_MIN_FFT_SIZE 65536
+#define HIRES_MAX_FFT_SIZE 262144
+// Peaks reported per high-resolution frame, strongest first.
+#define HIRES_MAX_PEAKS 4
+
+/**
+ * @brief Prepares FFTW for multi-threaded plans. Call once, before any other FFTW function.
+ * @return False if FFTW's thread support could not be initialised, or was not built in.
+ */
+bool hires_init_threads();
+
+/**
+ * @brief A spectral peak measured to a fraction of a cent.
+ */
+struct HiresPeak {
+    double frequency;   // Hz, refined by parabolic interpolation
+    double magnitude;
+    int midi;           // Nearest MIDI note
+    double cents;       // Deviation from the equal-tempered pitch of midi
+};
+
+/**
+ * @class HiresAnalyzer
+ * @brief One very long FFT (64k-256k points) run with FFTW's threads, for tuning work.
+ *
+ * At 262144 points and 44.1 kHz the bins are 0.17 Hz apart; interpolating
+ * the peak gets well under a cent across the musical range. The plan is
+ * multi-threaded, so the transform runs on the calling thread's CPU set
+ * (FFTW's workers inherit its affinity). The window is applied while copying
+ * out of the CaptureRing the FFT stage writes, as in FixedAnalyzer::load_samples().
+ */
+class HiresAnalyzer {
+public:
+    /**
+     * @brief Constructor that allocates the buffers and builds the multi-threaded plan.
+     * @param fft_size Transform size, a power of two from HIRES_MIN_FFT_SIZE to HIRES_MAX_FFT_SIZE.
+     * @param sample_rate Rate of the analysed samples in Hz.
+     * @param min_freq Peaks below this frequency are ignored.
+     * @param min_magnitude Peaks must exceed this magnitude.
+     * @param window_type Analysis window.
+     * @param kaiser_beta Shape of the Kaiser window.
+     * @param threads Threads FFTW may use for the transform (one in builds without FFTW threads).
+     * @throws std::runtime_error on an unsupported size or if FFTW fails.
+     */
+    HiresAnalyzer(int fft_size, double sample_rate, int min_freq, double min_magnitude, WindowType window_type,
+                  double kaiser_beta, int threads);
+    ~HiresAnalyzer();
+
+    int fft_size() const { return size; }
+
+    /**
+     * @brief Windows the newest fft_size() samples of the ring into the FFT input.
+     * @return False if not enough samples were written yet or the writer overwrote them mid-copy.
+     */
+    bool load_samples(const CaptureRing &ring);
+
+    /**
+     * @brief Runs the transform and finds the strongest peaks.
+     * @param peaks Output, strongest first.
+     * @param max_peaks Capacity of peaks.
+     * @return Number of peaks written.
+     */
+    int analyse(HiresPeak *peaks, int max_peaks);
+
+private:
+    int size;
+    int bins;
+    double bin_hz;
+    int min_index;
+    double min_magnitude;
+    double *fft_in;
+    fftw_complex *fft_out;
+    double *window;
+    double *magnitudes;
+    fftw_plan plan;
+};
+
+#endif // _HIRES_ANALYZER_H_
@@ -0,0 +1,177 @@
+#include "led_layout.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+// More LEDs than any supported output can drive; catches typos like "matrix 320 320".
+#define MAX_LAYOUT_LEDS 65536
+
+enum NoteAxis {
+    AXIS_DEFAULT,
+    AXIS_ALONG,     // Position in wiring order
+    AXIS_X,
+    AXIS_Y,
+    AXIS_ANGLE
+};
+
+// Pitch class of a position in [0, 1) along the element's note axis.
+static uint8_t band_note(double position) {
+    int note = static_cast<int>(std::floor(position * NUM_NOTES));
+    return static_cast<uint8_t>(std::min(NUM_NOTES - 1, std::max(0, note)));
+}
+
+static int parse_count(const std::string &word, const std::string &where) {
+    char *end;
+    long value = std::strtol(word.c_str(), &end, 10);
+    if (word.empty() || *end != '\0' || value < 1 || value > MAX_LAYOUT_LEDS) {
+        throw std::runtime_error("Error: " + where + ": invalid LED count '" + word + "'.");
+    }
+    return static_cast<int>(value);
+}
+
+/**
+ * @brief Parses a layout description.
+ * @param in Layout text.
+ * @param name Used in error messages.
+ * @throws std::runtime_error on a syntax error.
+ */
+LedLayout parse_led_layout(std::istream &in, const std::string &name) {
+    LedLayout layout;
+    std::string line;
+    int line_no = 0;
+
+    while (std::getline(in, line)) {
+        line_no++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+        std::istringstream words(line);
+        std::string type;
+        if (!(words >> type)) {
+            continue;
+        }
+        const std::string where = name + ":" + std::to_string(line_no);
+
+        // Sizes and options, in any order.
+        std::vector<int> counts;
+        std::string word;
+        bool reverse = false, serpentine = false, vertical = false, ccw = false;
+        double start_deg = 0;
+        NoteAxis axis = AXIS_DEFAULT;
+        while (words >> word) {
+            if (!word.empty() && std::isdigit(static_cast<unsigned char>(word[0]))) {
+                counts.push_back(parse_count(word, where));
+            } else if (word == "reverse") {
+                reverse = true;
+            } else if (word == "serpentine") {
+                serpentine = true;
+            } else if (word == "vertical") {
+                vertical = true;
+            } else if (word == "ccw") {
+                ccw = true;
+            } else if (word.compare(0, 6, "start=") == 0) {
+                char *end;
+                start_deg = std::strtod(word.c_str() + 6, &end);
+                if (*end != '\0') {
+                    throw std::runtime_error("Error: " + where + ": invalid angle in '" + word + "'.");
+                }
+            } else if (word == "notes=along") {
+                axis = AXIS_ALONG;
+            } else if (word == "notes=x") {
+                axis = AXIS_X;
+            } else if (word == "notes=y") {
+                axis = AXIS_Y;
+            } else if (word == "notes=angle") {
+                axis = AXIS_ANGLE;
+            } else {
+                throw std::runtime_error("Error: " + where + ": unknown option '" + word + "' for " + type + ".");
+            }
+        }
+
+        const size_t wanted = type == "matrix" ? 2 : 1;
+        if (counts.size() != wanted) {
+            throw std::runtime_error("Error: " + where + ": " + type + " needs " +
+                                     (wanted == 2 ? "a width and a height." : "an LED count."));
+        }
+
+        if (type == "strip") {
+            if (axis != AXIS_DEFAULT && axis != AXIS_ALONG) {
+                throw std::runtime_error("Error: " + where + ": a strip only supports notes=along.");
+            }
+            const int n = counts[0];
+            for (int i = 0; i < n; i++) {
+                int pos = reverse ? n - 1 - i : i;
+                layout.led_note.push_back(band_note((pos + 0.5) / n));
+            }
+        } else if (type == "matrix") {
+            if (axis != AXIS_DEFAULT && axis != AXIS_X && axis != AXIS_Y) {
+                throw std::runtime_error("Error: " + where + ": a matrix supports notes=x or notes=y.");
+            }
+            const int w = counts[0], h = counts[1];
+            if (static_cast<long>(w) * h > MAX_LAYOUT_LEDS) {
+                throw std::runtime_error("Error: " + where + ": matrix is too large.");
+            }
+            // Wiring runs along the major axis; serpentine flips every other run.
+            const int runs = vertical ? w : h;
+            const int run_len = vertical ? h : w;
+            for (int r = 0; r < runs; r++) {
+                for (int k = 0; k < run_len; k++) {
+                    int along = serpentine && (r & 1) ? run_len - 1 - k : k;
+                    int col = vertical ? r : along;
+                    int row = vertical ? along : r;
+                    double pos = axis == AXIS_Y ? (row + 0.5) / h : (col + 0.5) / w;
+                    layout.led_note.push_back(band_note(pos));
+                }
+            }
+        } else if (type == "ring") {
+            if (axis != AXIS_DEFAULT && axis != AXIS_ANGLE && axis != AXIS_ALONG) {
+                throw std::runtime_error("Error: " + where + ": a ring supports notes=angle or notes=along.");
+            }
+            const int n = counts[0];
+            for (int i = 0; i < n; i++) {
+                // Angle clockwise from the top.
+                double turn = static_cast<double>(i) / n;
+                double deg = start_deg + (ccw ? -360.0 : 360.0) * turn;
+                // Half an LED on, in the wiring direction, as for notes=along.
+                double wheel = deg / 360.0 + (ccw ? -0.5 : 0.5) / n;
+                wheel -= std::floor(wheel);
+                layout.led_note.push_back(band_note(axis == AXIS_ALONG ? turn + 0.5 / n : wheel));
+            }
+        } else if (type == "gap") {
+            for (int i = 0; i < counts[0]; i++) {
+                layout.led_note.push_back(NUM_NOTES);
+            }
+        } else {
+            throw std::runtime_error("Error: " + where + ": unknown element '" + type +
+                                     "' (expected strip, matrix, ring or gap).");
+        }
+
+        if (layout.size() > MAX_LAYOUT_LEDS) {
+            throw std::runtime_error("Error: " + where + ": layout has more than " +
+                                     std::to_string(MAX_LAYOUT_LEDS) + " LEDs.");
+        }
+    }
+
+    if (layout.size() == 0) {
+        throw std::runtime_error("Error: " + name + ": layout has no LEDs.");
+    }
+    return layout;
+}
+
+/**
+ * @brief Loads a layout file.
+ * @throws std::runtime_error if the file cannot be read or is invalid.
+ */
+LedLayout load_led_layout(const std::string &path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Error: Cannot open layout file '" + path + "'.");
+    }
+    return parse_led_layout(file, path);
+}
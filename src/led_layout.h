@@ -0,0 +1,51 @@
+#ifndef _LED_LAYOUT_H_
+#define _LED_LAYOUT_H_
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "notes.h"
+
+/**
+ * @brief Physical arrangement of an LED installation and the pitch class of every LED.
+ *
+ * A layout file lists the installation's elements in wiring order, one per line:
+ *
+ *     strip N [reverse] [notes=along]
+ *     matrix W H [serpentine] [vertical] [notes=x|y]
+ *     ring N [start=DEGREES] [ccw] [notes=angle|along]
+ *     gap N
+ *
+ * A strip is a straight run. A matrix is wired row by row, or column by column
+ * if vertical, and serpentine wiring reverses every other row or column. A ring's
+ * first LED sits at start degrees clockwise from the top. A gap is LEDs that stay
+ * dark, e.g. the wiring between two segments of a truss.
+ *
+ * Every element is divided into twelve equal bands, one per pitch class. By
+ * default a strip is divided along its length, a matrix across x (note columns)
+ * and a ring by angle (a colour wheel). notes= picks another axis. Anything
+ * after # is a comment.
+ */
+struct LedLayout {
+    std::vector<uint8_t> led_note;  // Pitch class of each LED in wiring order, NUM_NOTES if it stays dark
+
+    uint32_t size() const { return static_cast<uint32_t>(led_note.size()); }
+};
+
+/**
+ * @brief Parses a layout description.
+ * @param in Layout text.
+ * @param name Used in error messages.
+ * @throws std::runtime_error on a syntax error.
+ */
+LedLayout parse_led_layout(std::istream &in, const std::string &name);
+
+/**
+ * @brief Loads a layout file.
+ * @throws std::runtime_error if the file cannot be read or is invalid.
+ */
+LedLayout load_led_layout(const std::string &path);
+
+#endif // _LED_LAYOUT_H_
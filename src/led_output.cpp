@@ -0,0 +1,60 @@
+#include "led_output.h"
+
+#include "config.h"
+#include "led_strip.h"
+#include "net_output.h"
+
+/**
+ * @brief Constructor.
+ * @param num The number of LEDs driven.
+ */
+LedOutput::LedOutput(uint32_t num) : num_leds(num), pixels(num, {0, 0, 0}) {
+}
+
+/**
+ * @brief Sets the color of a single pixel in the local buffer.
+ * @param index The index of the pixel.
+ * @param r Red component (0-255).
+ * @param g Green component (0-255).
+ * @param b Blue component (0-255).
+ */
+void LedOutput::set_pixel(uint32_t index, uint8_t r, uint8_t g, uint8_t b) {
+    if (index < num_leds) {
+        pixels[index] = {r, g, b};
+    }
+}
+
+/**
+ * @brief Sets all pixels to black (off) in the local buffer.
+ */
+void LedOutput::clear() {
+    for (uint32_t i = 0; i < num_leds; ++i) {
+        pixels[i] = {0, 0, 0};
+    }
+}
+
+/**
+ * @brief Encodes and sends the local pixel buffer.
+ */
+void LedOutput::show() {
+    show_buffer.resize(encoded_size());
+    encode(pixels.data(), show_buffer.data());
+    write_encoded(show_buffer.data(), show_buffer.size());
+}
+
+/**
+ * @brief Creates the output selected by config.output ("spi", "e131" or "artnet").
+ * @param config Output settings and the number of LEDs.
+ * @throws std::runtime_error if the output cannot be opened.
+ */
+std::unique_ptr<LedOutput> make_led_output(const Config &config) {
+    if (config.output == "spi") {
+        return std::unique_ptr<LedOutput>(new Pi5NeoCpp(config.num_leds, config.spi_device,
+                                                        config.led_supply_ma, config.spi_speed));
+    }
+    return std::unique_ptr<LedOutput>(new NetOutput(config.num_leds,
+                                                    config.output == "artnet" ? NET_ARTNET : NET_E131,
+                                                    config.output_host, config.output_port,
+                                                    static_cast<uint16_t>(config.output_universe),
+                                                    static_cast<uint16_t>(config.output_sync_universe)));
+}
@@ -0,0 +1,107 @@
+#ifndef _LED_OUTPUT_H_
+#define _LED_OUTPUT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct Config;
+
+// Represents a single RGB pixel
+struct Pixel {
+    uint8_t r, g, b;
+};
+
+/**
+ * @class LedOutput
+ * @brief Where rendered frames go: a local strip or a network of pixel controllers.
+ *
+ * Output is split in two so the pipeline can run them on separate stages:
+ * encode() turns pixels into the wire format in a caller-owned buffer, and
+ * write_encoded() sends such a buffer. show() does both for the local
+ * pixel buffer, for use outside the pipeline (start-up, shutdown).
+ */
+class LedOutput {
+public:
+    /**
+     * @brief Constructor.
+     * @param num The number of LEDs driven.
+     */
+    explicit LedOutput(uint32_t num);
+    virtual ~LedOutput() {}
+
+    /**
+     * @brief The number of LEDs driven.
+     */
+    uint32_t size() const { return num_leds; }
+
+    /**
+     * @brief Sets the color of a single pixel in the local buffer.
+     * @param index The index of the pixel.
+     * @param r Red component (0-255).
+     * @param g Green component (0-255).
+     * @param b Blue component (0-255).
+     */
+    void set_pixel(uint32_t index, uint8_t r, uint8_t g, uint8_t b);
+
+    /**
+     * @brief Direct access to the local pixel buffer for bulk writes.
+     * @return Pointer to size() pixels.
+     */
+    Pixel *buffer() { return pixels.data(); }
+
+    /**
+     * @brief Sets all pixels to black (off) in the local buffer.
+     */
+    void clear();
+
+    /**
+     * @brief Encodes and sends the local pixel buffer.
+     */
+    void show();
+
+    /**
+     * @brief Number of bytes encode() produces for one frame.
+     */
+    virtual size_t encoded_size() const = 0;
+
+    /**
+     * @brief Encodes a frame into the wire format without sending it.
+     *
+     * Only one thread may encode at a time.
+     * @param src size() pixels.
+     * @param out encoded_size() bytes.
+     */
+    virtual void encode(const Pixel *src, uint8_t *out) = 0;
+
+    /**
+     * @brief Sends a frame previously produced by encode().
+     * @param data Encoded bytes.
+     * @param size Number of bytes, normally encoded_size().
+     * @throws std::runtime_error if the frame could not be sent.
+     */
+    virtual void write_encoded(const uint8_t *data, size_t size) = 0;
+
+    /**
+     * @brief Highest refresh rate the output can sustain.
+     * @return Frames per second.
+     */
+    virtual float max_frame_rate() const = 0;
+
+protected:
+    uint32_t num_leds;
+
+private:
+    std::vector<Pixel> pixels;
+    std::vector<uint8_t> show_buffer; // Sized on first show()
+};
+
+/**
+ * @brief Creates the output selected by config.output ("spi", "e131" or "artnet").
+ * @param config Output settings and the number of LEDs.
+ * @throws std::runtime_error if the output cannot be opened.
+ */
+std::unique_ptr<LedOutput> make_led_output(const Config &config);
+
+#endif // _LED_OUTPUT_H_
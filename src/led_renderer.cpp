@@ -0,0 +1,191 @@
+#include "led_renderer.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Below this tempo confidence the beat pulse is switched off instead of guessing.
+#define MIN_BEAT_CONFIDENCE 0.2f
+// How fast the pulse falls off after each beat (per beat).
+#define BEAT_PULSE_SHARPNESS 5.0f
+
+// Colour wheel ordered by the circle of fifths, indexed by pitch class.
+static const uint8_t notes_RGB[NUM_NOTES][3] = {
+    {0,   0,   255}, // C
+    {0,   128, 255}, // G
+    {0,   255, 255}, // D
+    {0,   255, 128}, // A
+    {0,   255, 0},   // E
+    {128, 255, 0},   // B
+    {255, 255, 0},   // Gb
+    {255, 128, 0},   // Db
+    {255, 0,   0},   // Ab
+    {255, 0,   128}, // Eb
+    {255, 0,   255}, // Bb
+    {128, 0,   255}  // F
+};
+
+/**
+ * @brief Constructor. The frame rate is clamped to what the strip can sustain.
+ * @param num The number of LEDs in the strip.
+ * @param frame_rate Requested render rate in frames per second.
+ * @param max_frame_rate Highest rate the output can sustain.
+ * @param attack_ms Envelope rise time constant in milliseconds.
+ * @param decay_ms Envelope fall time constant in milliseconds.
+ * @param notes Link from the feature stage.
+ * @param frames Link to the encode stage.
+ * @param layout Physical layout of the LEDs, or nullptr for twelve runs along the strip.
+ * @throws std::runtime_error if num is not one of the compiled strip lengths
+ *         (without a layout) or does not match the layout.
+ */
+LedRenderer::LedRenderer(uint32_t num, float frame_rate, float max_frame_rate, float attack_ms, float decay_ms,
+                         StageLink<NoteFrame> &notes, StageLink<PixelFrame> &frames, const LedLayout *layout)
+    : painter(make_note_painter(num, layout)), input(notes), output(frames),
+      beat_pulse(0), frame_seq(0), source_seq(0), running(false) {
+
+    fps = std::min(frame_rate, max_frame_rate);
+    set_envelope(attack_ms, decay_ms);
+
+    for (int i = 0; i < NUM_NOTES; i++) {
+        prev_target[i] = 0;
+        target[i] = 0;
+        level[i] = 0;
+    }
+    target_time = clock::now();
+    analysis_period = 0.05f;
+    beat_phase = 0;
+    beat_bpm = 0;
+    beat_confidence = 0;
+}
+
+/**
+ * @brief Destructor that stops the render thread.
+ */
+LedRenderer::~LedRenderer() {
+    stop();
+}
+
+/**
+ * @brief Starts the render thread.
+ */
+void LedRenderer::start() {
+    if (running) {
+        return;
+    }
+    running = true;
+    render_thread = std::thread(&LedRenderer::run, this);
+}
+
+/**
+ * @brief Stops the render thread and waits for it to exit.
+ */
+void LedRenderer::stop() {
+    running = false;
+    if (render_thread.joinable()) {
+        render_thread.join();
+    }
+}
+
+/**
+ * @brief Changes the envelope time constants. Safe to call while rendering.
+ * @param attack_ms Envelope rise time constant in milliseconds.
+ * @param decay_ms Envelope fall time constant in milliseconds.
+ */
+void LedRenderer::set_envelope(float attack_ms, float decay_ms) {
+    // Per-frame coefficients of a one-pole filter with the given time constants.
+    float dt = 1.0f / fps;
+    attack_coeff = 1.0f - std::exp(-dt / (attack_ms / 1000.0f));
+    decay_coeff  = 1.0f - std::exp(-dt / (decay_ms / 1000.0f));
+}
+
+void LedRenderer::update_targets(const NoteFrame &notes) {
+    // Track the analysis rate so interpolation spans one analysis period.
+    float since_last = std::chrono::duration<float>(notes.time - target_time).count();
+    analysis_period += 0.1f * (since_last - analysis_period);
+
+    for (int i = 0; i < NUM_NOTES; i++) {
+        prev_target[i] = target[i];
+        target[i] = std::min(1.0f, std::max(0.0f, notes.levels[i]));
+    }
+    beat_phase = notes.beat_phase;
+    beat_bpm = notes.bpm;
+    beat_confidence = notes.beat_confidence;
+    target_time = notes.time;
+
+    // A new note shows at once instead of being interpolated in over an analysis period.
+    for (int i = 0; i < notes.num_events; i++) {
+        if (notes.events[i].type == NOTE_ON) {
+            int note_idx = notes.events[i].midi % NUM_NOTES;
+            prev_target[note_idx] = target[note_idx];
+        }
+    }
+    source_seq = notes.seq;
+}
+
+void LedRenderer::run() {
+    if (thread_init) {
+        thread_init();
+    }
+
+    const clock::duration period = std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<float>(1.0f / fps));
+    clock::time_point next_frame = clock::now();
+
+    while (running) {
+        NoteFrame *notes = input.try_receive();
+        if (notes) {
+            update_targets(*notes);
+            input.release(notes);
+        }
+
+        // If the encoder still holds every buffer this frame is skipped, the envelopes keep time.
+        PixelFrame *frame = output.acquire();
+        if (frame) {
+            render_frame(next_frame, *frame);
+            output.send(frame);
+        }
+
+        next_frame += period;
+        clock::time_point now = clock::now();
+        if (now > next_frame + period) {
+            // We fell more than a frame behind; drop frames instead of bursting.
+            next_frame = now;
+        }
+        std::this_thread::sleep_until(next_frame);
+    }
+}
+
+void LedRenderer::render_frame(clock::time_point now, PixelFrame &frame) {
+    float elapsed = std::chrono::duration<float>(now - target_time).count();
+    float t = analysis_period > 0 ? std::min(1.0f, std::max(0.0f, elapsed / analysis_period)) : 1.0f;
+
+    const float attack = attack_coeff;
+    const float decay = decay_coeff;
+
+    // Extrapolate the beat phase to this frame and pulse on each beat.
+    float brightness = 1.0f;
+    const float pulse = beat_pulse;
+    if (pulse > 0 && beat_confidence >= MIN_BEAT_CONFIDENCE) {
+        float beats = beat_phase + elapsed * beat_bpm / 60.0f;
+        float phase = beats - std::floor(beats);
+        brightness = 1.0f - pulse + pulse * std::exp(-BEAT_PULSE_SHARPNESS * phase);
+    }
+
+    Pixel colours[NUM_NOTES + 1];
+    for (int note_idx = 0; note_idx < NUM_NOTES; note_idx++) {
+        // Interpolate between the last two analysis updates, then apply the envelope.
+        float goal = prev_target[note_idx] + (target[note_idx] - prev_target[note_idx]) * t;
+        float coeff = goal > level[note_idx] ? attack : decay;
+        level[note_idx] += (goal - level[note_idx]) * coeff;
+
+        float shown = level[note_idx] * brightness;
+        colours[note_idx].r = static_cast<uint8_t>(notes_RGB[note_idx][0] * shown);
+        colours[note_idx].g = static_cast<uint8_t>(notes_RGB[note_idx][1] * shown);
+        colours[note_idx].b = static_cast<uint8_t>(notes_RGB[note_idx][2] * shown);
+    }
+    colours[NUM_NOTES] = {0, 0, 0};
+
+    frame.seq = frame_seq++;
+    frame.source_seq = source_seq;
+    frame.time = now;
+    painter->paint(colours, frame.pixels.data());
+}
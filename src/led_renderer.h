@@ -0,0 +1,118 @@
+#ifndef _LED_RENDERER_H_
+#define _LED_RENDERER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+
+#include "frames.h"
+#include "led_output.h"
+#include "note_painter.h"
+#include "notes.h"
+#include "stage.h"
+
+/**
+ * @class LedRenderer
+ * @brief Colour mapping stage: renders LED frames from its own thread at a fixed frame rate.
+ *
+ * The feature stage publishes a target level (0.0 - 1.0) per pitch class.
+ * Every render frame the renderer takes the newest note frame, interpolates
+ * between the last two updates and runs each note through an attack/decay
+ * envelope, so the strip fades smoothly even when analysis runs at a much
+ * lower rate. The beat phase from the rhythm tracker is extrapolated per frame
+ * to pulse the brightness on each beat. Finished frames go to the encode stage.
+ */
+class LedRenderer {
+private:
+    typedef std::chrono::steady_clock clock;
+
+    std::unique_ptr<NotePainter> painter;
+    StageLink<NoteFrame> &input;
+    StageLink<PixelFrame> &output;
+    float fps;
+    std::atomic<float> attack_coeff; // One-pole coefficient per frame when a note rises
+    std::atomic<float> decay_coeff;  // One-pole coefficient per frame when a note falls
+    std::atomic<float> beat_pulse;   // Depth of the brightness pulse on each beat, 0.0 - 1.0
+
+    // Render thread state.
+    float prev_target[NUM_NOTES];
+    float target[NUM_NOTES];
+    clock::time_point target_time;
+    float analysis_period; // Smoothed time between analysis updates (s)
+    float level[NUM_NOTES];
+    float beat_phase;      // At target_time
+    float beat_bpm;
+    float beat_confidence;
+    uint64_t frame_seq;
+    uint64_t source_seq;
+
+    std::thread render_thread;
+    std::atomic<bool> running;
+    std::function<void()> thread_init;
+
+    void run();
+    void update_targets(const NoteFrame &notes);
+    void render_frame(clock::time_point now, PixelFrame &frame);
+
+public:
+    /**
+     * @brief Constructor. The frame rate is clamped to what the strip can sustain.
+     * @param num The number of LEDs in the strip.
+     * @param frame_rate Requested render rate in frames per second.
+     * @param max_frame_rate Highest rate the output can sustain.
+     * @param attack_ms Envelope rise time constant in milliseconds.
+     * @param decay_ms Envelope fall time constant in milliseconds.
+     * @param notes Link from the feature stage.
+     * @param frames Link to the encode stage.
+     * @param layout Physical layout of the LEDs, or nullptr for twelve runs along the strip.
+     * @throws std::runtime_error if num is not one of the compiled strip lengths
+     *         (without a layout) or does not match the layout.
+     */
+    LedRenderer(uint32_t num, float frame_rate, float max_frame_rate, float attack_ms, float decay_ms,
+                StageLink<NoteFrame> &notes, StageLink<PixelFrame> &frames, const LedLayout *layout = nullptr);
+
+    /**
+     * @brief Destructor that stops the render thread.
+     */
+    ~LedRenderer();
+
+    /**
+     * @brief Sets a function the render thread runs once before its first frame.
+     *
+     * Used to apply CPU affinity and scheduling from inside the thread.
+     */
+    void set_thread_init(std::function<void()> init) { thread_init = init; }
+
+    /**
+     * @brief Starts the render thread.
+     */
+    void start();
+
+    /**
+     * @brief Stops the render thread and waits for it to exit.
+     */
+    void stop();
+
+    /**
+     * @brief Changes the envelope time constants. Safe to call while rendering.
+     * @param attack_ms Envelope rise time constant in milliseconds.
+     * @param decay_ms Envelope fall time constant in milliseconds.
+     */
+    void set_envelope(float attack_ms, float decay_ms);
+
+    /**
+     * @brief Sets how much the strip dims between beats. Safe to call while rendering.
+     * @param depth 0.0 (off) - 1.0 (dark between beats, full brightness on the beat).
+     */
+    void set_beat_pulse(float depth) { beat_pulse = depth; }
+
+    /**
+     * @brief The frame rate actually used after clamping.
+     */
+    float frame_rate() const { return fps; }
+};
+
+#endif // _LED_RENDERER_H_
@@ -1,13 +1,88 @@
 #include  "led_strip.h"
 
+#include <cstring>
+
+// constexpr exp/log so the output tables below are built by the compiler.
+static constexpr double ce_exp(double x) {
+    // exp(x) = exp(x / 2^k)^(2^k), Taylor series on the reduced argument.
+    int k = 0;
+    while (x > 0.5 || x < -0.5) {
+        x /= 2;
+        k++;
+    }
+    double sum = 1, term = 1;
+    for (int n = 1; n < 20; n++) {
+        term *= x / n;
+        sum += term;
+    }
+    while (k-- > 0) {
+        sum *= sum;
+    }
+    return sum;
+}
+
+static constexpr double ce_log(double x) {
+    // ln(x) = k ln(2) + 2 atanh((m - 1) / (m + 1)), with m in [0.5, 2].
+    int k = 0;
+    while (x > 2) {
+        x /= 2;
+        k++;
+    }
+    while (x < 0.5) {
+        x *= 2;
+        k--;
+    }
+    double y = (x - 1) / (x + 1);
+    double sum = 0, term = y;
+    for (int n = 1; n < 40; n += 2) {
+        sum += term / n;
+        term *= y * y;
+    }
+    return 2 * sum + k * 0.6931471805599453;
+}
+
+struct GammaTable {
+    uint8_t value[256];
+};
+
+static constexpr GammaTable make_gamma_table(double gamma, int brightness) {
+    GammaTable table = {};
+    for (int i = 1; i < 256; i++) {
+        double linear = ce_exp(gamma * ce_log(i / 255.0));
+        table.value[i] = static_cast<uint8_t>(linear * brightness + 0.5);
+    }
+    return table;
+}
+
+// Each WS2812 data bit is sent as one SPI byte: '1' -> 0b110, '0' -> 0b100.
+struct SpiEncodeTable {
+    uint8_t bytes[256][8];
+};
+
+static constexpr SpiEncodeTable make_spi_encode_table() {
+    SpiEncodeTable table = {};
+    for (int c = 0; c < 256; c++) {
+        for (int i = 0; i < 8; i++) {
+            table.bytes[c][i] = ((c >> (7 - i)) & 1) ? 0b110 : 0b100;
+        }
+    }
+    return table;
+}
+
+static constexpr GammaTable gamma_lut = make_gamma_table(LED_GAMMA, LED_BRIGHTNESS);
+static constexpr SpiEncodeTable spi_lut = make_spi_encode_table();
+
 
 /**
  * @brief Constructor that opens and configures the SPI device.
  * @param num The number of LEDs in the strip.
  * @param device The SPI device path (e.g., "/dev/spidev0.0").
+ * @param max_current Supply current budget in mA. Frames estimated to draw more
+ *                    are dimmed uniformly. 0 disables the limiter.
+ * @param speed SPI clock in Hz.
  */
-Pi5NeoCpp::Pi5NeoCpp(uint32_t num, const std::string& device) : num_leds(num) {
-    pixels.resize(num_leds, {0, 0, 0});
+Pi5NeoCpp::Pi5NeoCpp(uint32_t num, const std::string& device, uint32_t max_current, uint32_t speed)
+    : LedOutput(num), spi_speed(speed), max_current_ma(max_current), frame_current_ma(0) {
 
     // Open the SPI device
     if ((spi_fd = open(device.c_str(), O_WRONLY)) < 0) {
@@ -17,11 +92,10 @@ Pi5NeoCpp::Pi5NeoCpp(uint32_t num, const std::string& device) : num_leds(num) {
     // Configure SPI settings
     uint8_t mode = SPI_MODE_0;
     uint8_t bits = 8;
-    uint32_t speed = 2400000; // 2.4 MHz
 
     if (ioctl(spi_fd, SPI_IOC_WR_MODE, &mode) == -1 ||
         ioctl(spi_fd, SPI_IOC_WR_BITS_PER_WORD, &bits) == -1 ||
-        ioctl(spi_fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) == -1) {
+        ioctl(spi_fd, SPI_IOC_WR_MAX_SPEED_HZ, &spi_speed) == -1) {
         close(spi_fd);
         throw std::runtime_error("Error: Cannot configure SPI device.");
     }
@@ -43,106 +117,61 @@ Pi5NeoCpp::~Pi5NeoCpp() {
 }
 
 /**
- * @brief Sets the color of a single pixel in the local buffer.
- * @param index The index of the pixel.
- * @param r Red component (0-255).
- * @param g Green component (0-255).
- * @param b Blue component (0-255).
+ * @brief Encodes a frame into SPI bytes without sending it.
+ * @param src num_leds pixels.
+ * @param out encoded_size() bytes.
  */
-void Pi5NeoCpp::set_pixel(uint32_t index, uint8_t r, uint8_t g, uint8_t b) {
+void Pi5NeoCpp::encode(const Pixel *src, uint8_t *out) {
+    // Estimate the frame's draw in one pass over the corrected channel values.
+    uint32_t duty_sum = 0;
+    for (uint32_t i = 0; i < num_leds; i++) {
+        const Pixel &p = src[i];
+        duty_sum += gamma_lut.value[p.r] + gamma_lut.value[p.g] + gamma_lut.value[p.b];
+    }
+    const uint32_t idle_ma = num_leds * LED_IDLE_MA;
+    uint32_t active_ma = static_cast<uint32_t>((static_cast<uint64_t>(duty_sum) * LED_MA_PER_CHANNEL) / 255);
 
-    float intensity = 0.5;
-    r = r*intensity;
-    g = g*intensity;
-    b = b*intensity;
-    if (index < num_leds) {
-        pixels[index] = {r, g, b};
+    // Q8 scale applied to every channel when the frame is over budget.
+    uint32_t scale = 256;
+    if (max_current_ma > 0 && idle_ma + active_ma > max_current_ma) {
+        // A dark strip that alone exceeds the budget has nothing to dim; keep it dark.
+        uint32_t available_ma = max_current_ma > idle_ma ? max_current_ma - idle_ma : 0;
+        scale = active_ma > 0 ? static_cast<uint32_t>((static_cast<uint64_t>(available_ma) * 256) / active_ma) : 0;
+        active_ma = (active_ma * scale) >> 8;
+    }
+    frame_current_ma = idle_ma + active_ma;
+
+    // Encode: 24 data bits per pixel, one SPI byte each, GRB order.
+    for (uint32_t i = 0; i < num_leds; i++) {
+        const Pixel &p = src[i];
+        uint8_t colors[3] = {p.g, p.r, p.b};
+        for (uint8_t c : colors) {
+            uint8_t v = static_cast<uint8_t>((gamma_lut.value[c] * scale) >> 8);
+            std::memcpy(out, spi_lut.bytes[v], 8);
+            out += 8;
+        }
     }
 }
 
 /**
- * @brief Sets all pixels to black (off) in the local buffer.
+ * @brief Sends a frame previously produced by encode().
+ * @param data Encoded bytes.
+ * @param size Number of bytes, normally encoded_size().
  */
-void Pi5NeoCpp::clear() {
-    for (uint32_t i = 0; i < num_leds; ++i) {
-        pixels[i] = {0, 0, 0};
+void Pi5NeoCpp::write_encoded(const uint8_t *data, size_t size) {
+    if (write(spi_fd, data, size) != (ssize_t)size) {
+        throw std::runtime_error("Error: Failed to write to SPI device.");
     }
 }
 
 /**
- * @brief Sends the pixel data to the LED strip.
+ * @brief Highest refresh rate the strip can sustain over the SPI link.
+ * @return Frames per second, including the latch (reset) time between frames.
  */
-void Pi5NeoCpp::show() {
-    // Each 24-bit color pixel requires 24 * 3 = 72 SPI bits = 9 SPI bytes.
-    std::vector<uint8_t> spi_buffer;
-    spi_buffer.reserve(num_leds * 9);
-
-    for (const auto& pixel : pixels) {
-        // WS2812B expects data in GRB order
-        uint32_t color = (static_cast<uint32_t>(pixel.g) << 16) |
-                            (static_cast<uint32_t>(pixel.r) << 8)  |
-                            (static_cast<uint32_t>(pixel.b));
-
-        // Convert the 24-bit color into 72 SPI bits (9 bytes)
-        for (int i = 23; i >= 0; --i) {
-            uint8_t current_bit = (color >> i) & 1;
-            uint8_t byte = 0;
-            // This logic packs 3 SPI bits into the most significant bits of a byte
-            if (current_bit) { // If color bit is 1
-                byte |= (1 << 7) | (1 << 6); // 110xxxxx
-            } else { // If color bit is 0
-                byte |= (1 << 7);            // 100xxxxx
-            }
-            // Each 3-bit pattern needs to be sent as a full byte.
-            // To do this efficiently, we can send 3 bytes for each color byte.
-        }
-            // A simpler, byte-oriented way:
-        uint8_t color_bytes[3] = {pixel.g, pixel.r, pixel.b};
-        for(int j = 0; j < 3; ++j) { // For each color component (G, R, B)
-            for(int i = 7; i >= 0; --i) { // For each bit in the component
-                if((color_bytes[j] >> i) & 1) {
-                    spi_buffer.push_back(0b110); // Send '1'
-                } else {
-                    spi_buffer.push_back(0b100); // Send '0'
-                }
-            }
-        }
-    }
-    
-    // This logic is slightly off. Let's correct it based on how spidev works.
-    // We need to send a stream of bytes. Let's send 3 bytes for each color byte (8 bits).
-    spi_buffer.clear();
-    spi_buffer.reserve(num_leds * 24 * 3 / 8); // simplified logic below
-    
-    // Final Correct Logic: Map each data bit to 3 SPI bits, packed into bytes.
-    // Total bits = num_leds * 24 * 3 = num_leds * 72
-    // Total bytes = num_leds * 9
-    spi_buffer.resize(num_leds * 9);
-    int buffer_idx = 0;
-
-    for (const auto& pixel : pixels) {
-        uint32_t color = (static_cast<uint32_t>(pixel.g) << 16) | (static_cast<uint32_t>(pixel.r) << 8) | pixel.b;
-        for (int i = 23; i >= 0; --i) {
-            uint8_t pattern = ((color >> i) & 1) ? 0b110 : 0b100;
-            // This pattern needs to be spread across bytes in the buffer
-            // This is complex. The most robust way is a lookup table or direct byte generation. Let's use direct bytes.
-        }
-    }
-    // Let's use the simplest, most readable byte-generation logic.
-    spi_buffer.clear();
-    const uint8_t spi_pattern[2] = {0b100, 0b110}; // SPI patterns for 0 and 1
-    for (const auto& p : pixels) {
-        uint8_t colors[3] = {p.g, p.r, p.b}; // GRB order
-        for(uint8_t c : colors) {
-            for(int i = 7; i >= 0; --i) {
-                spi_buffer.push_back(spi_pattern[(c >> i) & 1]);
-            }
-        }
-    }
-
-
-    // The write operation
-    if (write(spi_fd, spi_buffer.data(), spi_buffer.size()) != (ssize_t)spi_buffer.size()) {
-        throw std::runtime_error("Error: Failed to write to SPI device.");
-    }
+float Pi5NeoCpp::max_frame_rate() const {
+    // show() sends one SPI byte per WS2812 data bit (24 per pixel).
+    const float frame_bits = static_cast<float>(num_leds) * 24 * 8;
+    // WS2812B latches after >280us of low line; keep a little margin.
+    const float reset_s = 300e-6f;
+    return 1.0f / (frame_bits / spi_speed + reset_s);
 }
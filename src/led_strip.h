@@ -1,6 +1,7 @@
 #ifndef _LED_STRIP_H_
 #define _LED_STRIP_H_
 
+#include <atomic>
 #include <iostream>
 #include <vector>
 #include <cstdint>
@@ -11,20 +12,35 @@
 #include <linux/spi/spidev.h>
 #include <stdexcept>
 
-// Represents a single RGB pixel
-struct Pixel {
-    uint8_t r, g, b;
-};
+#include "led_output.h"
+
+// Output curve applied to every colour channel on its way to the SPI bus.
+// Override at build time, e.g. -DLED_GAMMA=2.8 -DLED_BRIGHTNESS=255.
+#ifndef LED_GAMMA
+#define LED_GAMMA 2.2
+#endif
+#ifndef LED_BRIGHTNESS
+#define LED_BRIGHTNESS 128 // Global brightness (0-255)
+#endif
+
+// Current model used by the power limiter (typical WS2812B figures).
+#ifndef LED_MA_PER_CHANNEL
+#define LED_MA_PER_CHANNEL 20 // mA drawn by one channel at full duty
+#endif
+#ifndef LED_IDLE_MA
+#define LED_IDLE_MA 1 // mA drawn by one dark pixel
+#endif
 
 /**
  * @class Pi5NeoCpp
  * @brief Controls a strip of WS2812 LEDs on a Raspberry Pi 5 using the SPI bus.
  */
-class Pi5NeoCpp {
+class Pi5NeoCpp : public LedOutput {
 private:
     int spi_fd; // File descriptor for the SPI device
-    uint32_t num_leds;
-    std::vector<Pixel> pixels;
+    uint32_t spi_speed; // SPI clock in Hz
+    uint32_t max_current_ma; // Supply budget, 0 disables the limiter
+    std::atomic<uint32_t> frame_current_ma; // Estimated draw of the last frame encoded
 
     // WS2812 uses a 1-wire protocol that can be emulated with SPI.
     // A WS2812 '1' bit is a long high pulse, '0' is a short high pulse.
@@ -40,8 +56,11 @@ public:
      * @brief Constructor that opens and configures the SPI device.
      * @param num The number of LEDs in the strip.
      * @param device The SPI device path (e.g., "/dev/spidev0.0").
+     * @param max_current Supply current budget in mA. Frames estimated to draw more
+     *                    are dimmed uniformly. 0 disables the limiter.
+     * @param speed SPI clock in Hz.
      */
-    Pi5NeoCpp(uint32_t num, const std::string& device);
+    Pi5NeoCpp(uint32_t num, const std::string& device, uint32_t max_current = 0, uint32_t speed = 2400000);
 
     /**
      * @brief Destructor that cleans up by clearing LEDs and closing the device.
@@ -49,22 +68,38 @@ public:
     ~Pi5NeoCpp();
 
     /**
-     * @brief Sets the color of a single pixel in the local buffer.
-     * @param index The index of the pixel.
-     * @param r Red component (0-255).
-     * @param g Green component (0-255).
-     * @param b Blue component (0-255).
+     * @brief Number of SPI bytes encode() produces for one frame.
+     */
+    size_t encoded_size() const override { return static_cast<size_t>(num_leds) * 24; }
+
+    /**
+     * @brief Encodes a frame into SPI bytes without sending it.
+     *
+     * Applies the gamma/brightness table and the current limiter. Only one
+     * thread may encode at a time.
+     * @param src num_leds pixels.
+     * @param out encoded_size() bytes.
      */
-    void set_pixel(uint32_t index, uint8_t r, uint8_t g, uint8_t b);
+    void encode(const Pixel *src, uint8_t *out) override;
 
     /**
-     * @brief Sets all pixels to black (off) in the local buffer.
+     * @brief Sends a frame previously produced by encode().
+     * @param data Encoded bytes.
+     * @param size Number of bytes, normally encoded_size().
      */
-    void clear();
+    void write_encoded(const uint8_t *data, size_t size) override;
+
+    /**
+     * @brief Estimated current draw of the last frame sent, after limiting.
+     * @return Current in mA.
+     */
+    uint32_t frame_current() const { return frame_current_ma; }
+
     /**
-     * @brief Sends the pixel data to the LED strip.
+     * @brief Highest refresh rate the strip can sustain over the SPI link.
+     * @return Frames per second, including the latch (reset) time between frames.
      */
-    void show();
+    float max_frame_rate() const override;
 };
 
 #endif // _LED_STRIP_H_
\ No newline at end of file
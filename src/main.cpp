@@ -1,5 +1,4 @@
 #include "RtAudio.h"
-#include <fftw3.h>
 #include <iostream>
 #include <vector>
 #include <cstdlib> // For std::exit
@@ -9,30 +8,28 @@
 #include <fstream>      // For std::ofstream
 #include <memory>
 #include <cmath>
-
-#include "led_strip.h"
+#include <thread>
+
+#include "analyzer.h"
+#include "analyzer_bank.h"
+#include "async_log.h"
+#include "autotune.h"
+#include "config.h"
+#include "config_watcher.h"
+#include "hires_analyzer.h"
+#include "led_layout.h"
+#include "led_output.h"
+#include "pcm_input.h"
+#include "pipeline.h"
+#include "realtime.h"
 
 
 // Global RtAudio object and flag to keep running
-const int FRAMES_PER_BUF = 2048;
-const int SAMPLE_RATE = 44100;
 RtAudio adc;
-bool keepRunning = true;
-volatile int new_data = 0;
-std::mutex buffer_mutex;
-std::vector<float> audio_buffer(FRAMES_PER_BUF);
-
-/* FFT */
-double *fft_in;
-fftw_complex *fft_out;
-fftw_plan plan;
-int N_out = FRAMES_PER_BUF / 2 + 1;
-std::unique_ptr<double[]> fft_magnitude;
-
-#define MIN_MAGNITUDE 45
-
-/* LED STRIP */
-const int num_leds = 48;
+volatile bool keepRunning = true;
+unsigned int streamBufferFrames = 0; // Block size the stream was opened with
+bool streamSint16 = false;           // Stream opened as RTAUDIO_SINT16 instead of RTAUDIO_FLOAT32
+std::vector<std::shared_ptr<Analyzer>> retiredAnalyzers; // Swapped out; freed on the config watcher thread
 
 // Ctrl+C signal handler
 void signalHandler(int signum) {
@@ -46,24 +43,30 @@ void signalHandler(int signum) {
 // ! For complex processing (like FFT), signal another thread or add data to a queue.
 int audioCallback(void *outputBuffer, void *inputBuffer, unsigned int nBufferFrames,
                   double streamTime, RtAudioStreamStatus status, void *userData) {
-    if (status) {
-        std::cerr << "Stream overflow detected!" << std::endl;
+    Pipeline *pipeline = static_cast<Pipeline*>(userData);
+
+    // No printing here: console I/O can block this thread and turn one overflow
+    // into many. Problems are counted and reported from a normal thread.
+    if (status & RTAUDIO_INPUT_OVERFLOW) {
+        pipeline->events().record(RT_EVENT_INPUT_OVERFLOW, nBufferFrames, streamTime);
+    }
+    if (status & RTAUDIO_OUTPUT_UNDERFLOW) {
+        pipeline->events().record(RT_EVENT_OUTPUT_UNDERFLOW, nBufferFrames, streamTime);
+    }
+    if (nBufferFrames < streamBufferFrames) {
+        pipeline->events().record(RT_EVENT_SHORT_BUFFER, nBufferFrames, streamTime);
     }
 
     // Cast the input buffer to the data type you expect
     // Common formats: float (RTAUDIO_FLOAT32), short (RTAUDIO_SINT16)
     // Make sure this matches the format you open the stream with.
-    float *input = static_cast<float*>(inputBuffer);
-
-    // --- Your audio processing would go here ---
-    // std::cout << "Received " << nBufferFrames << " frames. First sample: " << input[0] << std::endl;
-
-    // Copy the data to a shared buffer
-    buffer_mutex.lock();
-    std::copy(&input[0], &input[nBufferFrames], audio_buffer.begin());
-    buffer_mutex.unlock();
-
-    new_data = 1;
+    // The Q15 backend opens the stream as RTAUDIO_SINT16 so no float conversion is done by RtAudio.
+    if (streamSint16) {
+        pipeline->push_audio(static_cast<int16_t*>(inputBuffer), nBufferFrames, streamTime);
+    } else {
+        // Hand the block to the pipeline's FFT stage (lock-free, never blocks)
+        pipeline->push_audio(static_cast<float*>(inputBuffer), nBufferFrames, streamTime);
+    }
 
     if (!keepRunning) {
         return 1; // Signal RtAudio to stop the stream from the callback
@@ -71,97 +74,13 @@ int audioCallback(void *outputBuffer, void *inputBuffer, unsigned int nBufferFra
     return 0; // Continue streaming
 }
 
-int fft_init(){
-    /* Allocate memory for FFTW arrays */
-    fft_magnitude = std::make_unique<double[]>(N_out);
-
-    // For a real input, the input array is of type double
-    fft_in = (double*) fftw_malloc(sizeof(double) * FRAMES_PER_BUF);
-    if (!fft_in) {
-        std::cerr << "Error: fftw_malloc for input array failed." << std::endl;
-        return 1;
-    }
-
-    // For a real-to-complex transform (DFT_R2C), the output array size is N/2 + 1 complex numbers
-    // fftw_complex is typically double[2] (real, imag)
-    fft_out = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * N_out);
-    if (!fft_out) {
-        std::cerr << "Error: fftw_malloc for output array failed." << std::endl;
-        fftw_free(fft_in); // Free previously allocated memory
-        return 1;
-    }
-
-   /* Create an FFTW Plan */
-    // A plan is a precomputed set of steps FFTW will take to compute the transform.
-    // For a 1D real-to-complex transform:
-    // - N: The logical size of the real input array.
-    // - in: Pointer to the input array.
-    // - out: Pointer to the output array.
-    // - FFTW_ESTIMATE: A flag indicating how much effort to spend on finding an optimal plan.
-    //                  FFTW_MEASURE is slower to plan but often faster to execute.
-    //                  FFTW_PATIENT or FFTW_EXHAUSTIVE are even more so.
-    plan = fftw_plan_dft_r2c_1d(FRAMES_PER_BUF, fft_in, fft_out, FFTW_MEASURE);
-    if (!plan) {
-        std::cerr << "Error: fftw_plan_dft_r2c_1d failed." << std::endl;
-        fftw_free(fft_in);
-        fftw_free(fft_out);
-        return 1;
-    }
-
-    return 1;
-}
-
-int fft_calculate_magnitudes(){
-
-    /* Populate input array with data from file */
-    buffer_mutex.lock();
-    for(int i = 0; i < FRAMES_PER_BUF; i++){
-        fft_in[i] = audio_buffer[i];
-    }
-    buffer_mutex.unlock();
-
-    /* Execute the FFT Plan */
-    fftw_execute(plan);
-
-    /* Calculate magnitudes */
-
-    int max_mag = 0;
-    int max_idx = 0;
-
-    int min_freq = 70;
-    int min_index = (min_freq * FRAMES_PER_BUF) / SAMPLE_RATE;
-    
-    for (int i = min_index; i < N_out; ++i) {
-        double real_part = fft_out[i][0];
-        double imag_part = fft_out[i][1];
-        fft_magnitude[i] = std::sqrt(real_part * real_part + imag_part * imag_part);
-
-        if(fft_magnitude[i] > max_mag){
-            max_mag = fft_magnitude[i];
-            max_idx = i;
-        }
-    }
-
-    if(max_mag < MIN_MAGNITUDE){
-        return 0;
-    }
-
-    return max_idx;
-}
-
-unsigned int selectAudioDevice(){
-    
-    unsigned int num_devs = adc.getDeviceCount();
-    if (num_devs < 1) {
-        std::cerr << "No audio devices found!" << std::endl;
-        return 0;
-    }
+void listAudioDevices(){
 
     // Get the list of device IDs
     std::vector< unsigned int > ids = adc.getDeviceIds();
     if ( ids.size() == 0 ) {
         std::cout << "No devices found." << std::endl;
-        return 0;
+        return;
     }
 
     std::cout << "Available audio devices:\n";
@@ -174,171 +93,112 @@ unsigned int selectAudioDevice(){
         std::cout << " - Input Channels: " << info.inputChannels;
         std::cout << " - Output Channels: " << info.outputChannels << std::endl;
     }
+}
 
-    // Select Input device
-    unsigned int in_dev;
-    std::cout << "\nEnter the Device ID for your microphone: ";
-    std::cin >> in_dev;
+// Resolves the configured device: empty selects the default input, a number is
+// a Device ID as printed by --list-devices, anything else matches part of the name.
+// Returns 0 if no suitable device is found.
+unsigned int selectAudioDevice(const std::string &name){
 
-    if (in_dev >= num_devs) {
-        std::cerr << "Invalid device ID." << std::endl;
+    std::vector< unsigned int > ids = adc.getDeviceIds();
+    if ( ids.size() == 0 ) {
+        std::cerr << "No audio devices found!" << std::endl;
         return 0;
     }
 
-    return ids[in_dev];
-}
-
-int magnitude_to_leds(Pi5NeoCpp &pixels){
-
-    // Find frequency at index with max magnitude
-
-
-    return 1;
-
-}
-
-const uint8_t notes_RGB[12][3] = {
-    {0,   0,   255}, // C
-    {0,   128, 255}, // G
-    {0,   255, 255}, // D
-    {0,   255, 128}, // A
-    {0,   255, 0},   // E
-    {128, 255, 0},   // B
-    {255, 255, 0},   // Gb
-    {255, 128, 0},   // Db
-    {255, 0,   0},   // Ab
-    {255, 0,   128}, // Eb
-    {255, 0,   255}, // Bb
-    {128, 0,   255}  // F
-};
-
-int freq_to_leds(Pi5NeoCpp &pixels, float frequency){
-
-    if(frequency == 0.0){
-        return 1;
+    if (name.empty()) {
+        return adc.getDefaultInputDevice();
     }
 
-    // A vector of note names in an octave.
-    const std::vector<std::string> noteNames = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
-    
-    // The reference frequency for the A4 note.
-    const double A4_FREQUENCY = 440.0;
-    
-    // A4 is MIDI note number 69.
-    const int A4_MIDI_NUMBER = 69;
-
-    // Calculate the number of semitones away from A4.
-    // The formula is derived from: freq = A4 * 2^(semitones/12)
-    double semitones_from_a4 = 12.0 * log2(frequency / A4_FREQUENCY);
-
-    // Calculate the closest MIDI note number.
-    int midi_note = static_cast<int>(round(semitones_from_a4)) + A4_MIDI_NUMBER;
-
-    // Determine the octave and the index of the note within the octave.
-    // In the MIDI standard, middle C (C4) is note 60. Octave number changes at C.
-    int octave = (midi_note / 12) - 1;
-    int note_index = midi_note % 12;
-
-    std::string note = noteNames[note_index] + std::to_string(octave);
-    std::cout << "Note Detected: " << note << "(freq=" << frequency << ")" << std::endl;
-
-    for (int i = 0; i < num_leds; ++i) {
-        pixels.set_pixel(i, notes_RGB[note_index][0], notes_RGB[note_index][1], notes_RGB[note_index][2]);
+    if (name.find_first_not_of("0123456789") == std::string::npos) {
+        unsigned int in_dev = std::stoul(name);
+        if (in_dev >= ids.size()) {
+            std::cerr << "Invalid device ID " << in_dev << "." << std::endl;
+            return 0;
+        }
+        return ids[in_dev];
     }
-    pixels.show();
-    return 1;
-
-}
-
-int fft_idx_to_note(int fft_idx){
-
-    /* Calculate frequency */
-    float freq = (fft_idx * SAMPLE_RATE) / FRAMES_PER_BUF;
 
-    // A vector of note names in an octave.
-    const std::vector<std::string> noteNames = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
-    
-    // The reference frequency for the A4 note.
-    const double A4_FREQUENCY = 440.0;
-    
-    // A4 is MIDI note number 69.
-    const int A4_MIDI_NUMBER = 69;
-
-    // Calculate the number of semitones away from A4.
-    // The formula is derived from: freq = A4 * 2^(semitones/12)
-    double semitones_from_a4 = 12.0 * log2(freq / A4_FREQUENCY);
-
-    // Calculate the closest MIDI note number.
-    int midi_note = static_cast<int>(round(semitones_from_a4)) + A4_MIDI_NUMBER;
-
-    // Determine the octave and the index of the note within the octave.
-    // In the MIDI standard, middle C (C4) is note 60. Octave number changes at C.
-    int octave = (midi_note / 12) - 1;
-    int note_index = midi_note % 12;
-
-    return note_index;
+    for (unsigned int id : ids) {
+        RtAudio::DeviceInfo info = adc.getDeviceInfo(id);
+        if (info.inputChannels > 0 && info.name.find(name) != std::string::npos) {
+            return id;
+        }
+    }
 
+    std::cerr << "No input device matching '" << name << "'. Use --list-devices to see them." << std::endl;
+    return 0;
 }
 
-int detect_notes(Pi5NeoCpp &pixels){
-
-    bool   notes_detected[12] = {false};
-    double notes_magnitude[12] = {0};
-
-    for(int i = 0; i < 12; i++){
-        notes_detected[i]  = 0;
-        notes_magnitude[i] = 0;
+// Builds the analyzer the config asks for: one FFT, or a bank of sizes.
+std::shared_ptr<Analyzer> createAnalyzer(const Config &config){
+    double rate = static_cast<double>(config.sample_rate) / config.decimation;
+    FftBackend backend = config.fft_backend == "q15" ? FFT_BACKEND_Q15 : FFT_BACKEND_FFTW;
+    if (config.analysis_bands > 1) {
+        return std::make_shared<AnalyzerBank>(config.fft_size, config.analysis_bands, rate, config.min_freq,
+                                              config.min_magnitude, config.window, config.kaiser_beta, backend);
     }
+    return make_analyzer(config.fft_size, rate, config.min_freq, config.min_magnitude,
+                         config.window, config.kaiser_beta, backend);
+}
 
-    pixels.clear();
-
-    int min_freq = 70; // 70Hz
-    int min_index = (min_freq * FRAMES_PER_BUF) / SAMPLE_RATE;
-
-    // Find what notes are present
-    for(int i = min_index; i < N_out; i++){
-        if(fft_magnitude[i] > MIN_MAGNITUDE){
-            int note_idx = fft_idx_to_note(i);
-            notes_detected[note_idx] = true;
-            notes_magnitude[note_idx] = fft_magnitude[i];
+// Frees the retired analyzers the analysis stages have let go of, waiting up
+// to wait_ms for the rest. Returns true once none are left. Holding them here
+// until then means their FFTW plans are always destroyed on this thread,
+// never on an analysis thread while this one is planning.
+bool reapAnalyzers(int wait_ms){
+    for (int i = 0; ; i++) {
+        retiredAnalyzers.erase(std::remove_if(retiredAnalyzers.begin(), retiredAnalyzers.end(),
+                                              [](const std::shared_ptr<Analyzer> &a) { return a.use_count() == 1; }),
+                               retiredAnalyzers.end());
+        if (retiredAnalyzers.empty()) {
+            return true;
         }
-    }
-
-    // Turn on LEDs
-    int leds_per_note = 4;
-
-    for(int note_idx = 0; note_idx < 12; note_idx++){
-        if(notes_detected[note_idx]){
-            for(int i = 0; i < leds_per_note; i ++){
-                pixels.set_pixel((note_idx*leds_per_note)+i, notes_RGB[note_idx][0], notes_RGB[note_idx][1], notes_RGB[note_idx][2]);
-            }
+        if (i >= wait_ms) {
+            return false;
         }
+        usleep(1000);
     }
-    pixels.show();
-
-    return 1;
-
 }
 
-int main() {
-
-    signal(SIGINT, signalHandler);
+// Runs on the config watcher thread: builds the new analyzer (FFTW planning
+// included) off the audio and analysis threads, then swaps it in.
+void applyConfig(const Config &old_config, const Config &new_config, Pipeline &pipeline){
+
+    if (new_config.fft_size != old_config.fft_size ||
+        new_config.min_freq != old_config.min_freq ||
+        new_config.min_magnitude != old_config.min_magnitude ||
+        new_config.window != old_config.window ||
+        new_config.kaiser_beta != old_config.kaiser_beta ||
+        new_config.analysis_bands != old_config.analysis_bands) {
+        // The FFTW planner must not run while a plan is destroyed elsewhere
+        if (!reapAnalyzers(2000)) {
+            throw std::runtime_error("Error: The previous analyzer is still in use; the change is not applied.");
+        }
+        std::shared_ptr<Analyzer> next = createAnalyzer(new_config);
+        retiredAnalyzers.push_back(pipeline.set_analyzer(next));
 
-    unsigned int dev_id = selectAudioDevice();
+        // Usually the analysis stages let go of it within a frame or two.
+        reapAnalyzers(2000);
+    }
 
-    // Initialize FFT
-    fft_init();
+    pipeline.renderer().set_envelope(new_config.led_attack_ms, new_config.led_decay_ms);
+    pipeline.renderer().set_beat_pulse(new_config.led_beat_pulse);
+    pipeline.set_trace_notes(new_config.trace_notes);
+    pipeline.set_note_tracking(new_config.note_release_ms, new_config.min_magnitude);
+    pipeline.set_colour_mode(colour_mode_from_name(new_config.colour_mode));
+}
 
-    // Create LED Strip object
-    const std::string device = "/dev/spidev0.0";
-    Pi5NeoCpp pixels(num_leds, device);
+// Opens the RtAudio input stream on the selected device; its callback is the
+// pipeline's capture stage. Returns false if the device cannot capture.
+bool openAudioDevice(unsigned int dev_id, const Config &config, Pipeline &pipeline){
 
     // Initialize audio Capture
     RtAudio::DeviceInfo selectedDeviceInfo;
     selectedDeviceInfo = adc.getDeviceInfo(dev_id);
     if (selectedDeviceInfo.inputChannels == 0) {
         std::cerr << "Selected device has no input channels!" << std::endl;
-        return 1;
+        return false;
     }
 
     RtAudio::StreamParameters parameters;
@@ -346,65 +206,235 @@ int main() {
     parameters.nChannels = 1;        // We'll ask for 1 channel (mono)
     parameters.firstChannel = 0;     // Start with the first channel on the device
 
-    unsigned int bufferFrames = FRAMES_PER_BUF; // Number of frames per buffer (chunk size)
+    unsigned int bufferFrames = config.buffer_frames; // Number of frames per buffer (chunk size)
                                      // Smaller = lower latency, higher CPU
                                      // Larger = higher latency, lower CPU
 
     // User data can be a pointer to anything you want to access in the callback
-    // For example, a struct or class instance holding your processing buffers/state.
-    // For now, we'll pass nullptr.
-    void *userData = nullptr;
-    // std::vector<float> myDataBuffer; // Example if you want to pass a buffer
-    // userData = &myDataBuffer;
+    // The callback is the pipeline's capture stage.
+    void *userData = &pipeline;
+
+    // In realtime mode RtAudio runs its callback thread as SCHED_FIFO
+    RtAudio::StreamOptions options;
+    options.flags = 0;
+    options.numberOfBuffers = 0;
+    options.priority = 0;
+    if (config.realtime) {
+        options.flags |= RTAUDIO_SCHEDULE_REALTIME;
+        options.priority = config.audio_priority;
+    }
 
     // Open the stream
     // Important: Choose a sampleFormat that your device supports.
-    // RTAUDIO_FLOAT32 is often good, but RTAUDIO_SINT16 is also common.
+    // RTAUDIO_FLOAT32 is often good, but RTAUDIO_SINT16 is also common and is
+    // what the Q15 backend wants: it is the codec's native format on most boards.
     // You might need to query device capabilities if you encounter issues.
+    streamSint16 = config.fft_backend == "q15";
     adc.openStream(nullptr,         // Output parameters (nullptr for input-only)
                     &parameters,     // Input parameters
-                    RTAUDIO_FLOAT32, // Sample format (try RTAUDIO_SINT16 if float doesn't work)
-                    SAMPLE_RATE,
+                    streamSint16 ? RTAUDIO_SINT16 : RTAUDIO_FLOAT32, // Sample format
+                    config.sample_rate,
                     &bufferFrames,   // RtAudio might adjust this to a supported size
                     &audioCallback,
-                    userData);       // User data passed to callback
+                    userData,        // User data passed to callback
+                    &options);
+
+    streamBufferFrames = bufferFrames;
+    // The tempo tracker counts time in blocks, so it needs the size actually granted
+    pipeline.set_block_frames(bufferFrames);
 
     std::cout << "Streaming audio from: " << selectedDeviceInfo.name << std::endl;
     std::cout << "Actual buffer size: " << bufferFrames << " frames." << std::endl;
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+
+    std::vector<std::string> args(argv + 1, argv + argc);
+    for (const std::string &arg : args) {
+        if (arg == "--help" || arg == "-h") {
+            config_print_usage(argv[0]);
+            return 0;
+        }
+    }
+
+    Config config;
+    try {
+        config = config_from_args(args);
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        config_print_usage(argv[0]);
+        return 1;
+    }
+
+    if (config.list_devices) {
+        listAudioDevices();
+        return 0;
+    }
+
+    signal(SIGINT, signalHandler);
+    signal(SIGTERM, signalHandler);
+
+    unsigned int dev_id = 0;
+    if (config.input == "device") {
+        dev_id = selectAudioDevice(config.audio_device);
+        if (dev_id == 0) {
+            return 1;
+        }
+    }
+
+    // The painter's note table is built from the layout once, here
+    std::unique_ptr<LedLayout> layout;
+    if (!config.layout.empty()) {
+        try {
+            layout.reset(new LedLayout(load_led_layout(config.layout)));
+        } catch (const std::runtime_error &e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    // Create LED output (SPI strip or network)
+    std::unique_ptr<LedOutput> pixels;
+    try {
+        pixels = make_led_output(config);
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    // FFTW's thread support must be set up before its first call, wisdom included
+#ifdef CHROMESTHAT_FFTW_THREADS
+    if (config.hires_fft_size > 0 && !hires_init_threads()) {
+        std::cerr << "Error: FFTW thread support could not be initialised." << std::endl;
+        return 1;
+    }
+#else
+    if (config.hires_fft_size > 0 && config.hires_threads > 1) {
+        std::cerr << "Warning: Built without FFTW threads; the high-resolution FFT runs on one thread." << std::endl;
+    }
+#endif
+
+    // Plans measured on earlier boots make FFTW_MEASURE planning quick
+    if (!config.state_dir.empty()) {
+        load_fftw_wisdom(fftw_wisdom_path(config));
+    }
+
+    if (config.autotune) {
+        try {
+            std::cout << "Autotune: measuring analysis settings..." << std::endl;
+            TuningResult tuned = autotune(config, *pixels, layout.get());
+            std::cout << "Autotune: fft_size " << tuned.fft_size << ", buffer_frames " << tuned.buffer_frames
+                      << ", " << tuned.fft_backend << " backend: about " << tuned.latency_ms << " ms latency, "
+                      << tuned.cpu_percent << " % CPU" << (tuned.cached ? " (cached)." : ".") << std::endl;
+            if (!tuned.within_budget) {
+                std::cerr << "Autotune: nothing fits the latency and CPU budgets; using the closest." << std::endl;
+            }
+        } catch (const std::runtime_error &e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+
+        // The tuned values win over the config file on reload, as command-line options do
+        args.push_back("--fft-size=" + std::to_string(config.fft_size));
+        args.push_back("--buffer-frames=" + std::to_string(config.buffer_frames));
+        args.push_back("--fft-backend=" + config.fft_backend);
+    }
+
+    // Initialize FFT, specialised for the configured window size, then build the
+    // stage graph; every buffer it needs is allocated here
+    std::shared_ptr<Analyzer> analyzer;
+    std::unique_ptr<Pipeline> stages;
+    try {
+        analyzer = createAnalyzer(config);
+        stages.reset(new Pipeline(config, *pixels, analyzer, layout.get()));
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    Pipeline &pipeline = *stages;
+    // After the pipeline, so the high-resolution plan is remembered too
+    if (!config.state_dir.empty() && !save_fftw_wisdom(fftw_wisdom_path(config))) {
+        std::cerr << "Cannot write FFTW wisdom to " << fftw_wisdom_path(config) << "." << std::endl;
+    }
+    analyzer.reset();
+
+    // Pick up edits to the config file while running
+    ConfigWatcher watcher(args, config, [&pipeline](const Config &old_config, const Config &new_config) {
+        applyConfig(old_config, new_config, pipeline);
+    });
+
+    // Streamed PCM replaces the audio device and feeds the same capture stage
+    std::unique_ptr<PcmInput> pcm;
+    if (config.input != "device") {
+        try {
+            pcm.reset(new PcmInput(config, [&pipeline](const float *samples, unsigned int frames, double time) {
+                pipeline.push_audio(samples, frames, time);
+            }));
+        } catch (const std::runtime_error &e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    if (config.realtime) {
+        // Everything long-lived is allocated by now; lock it in RAM before streaming
+        pipeline.prefault();
+
+        std::string error;
+        if (!realtime_lock_memory(error)) {
+            std::cerr << "Realtime: " << error << std::endl;
+        }
+    }
+
+    if (pcm) {
+        std::cout << "Streaming audio from: " << pcm->description() << std::endl;
+    } else if (!openAudioDevice(dev_id, config, pipeline)) {
+        return 1;
+    }
     std::cout << "Press Ctrl+C to stop." << std::endl;
 
-    adc.startStream();
-    
+    pipeline.start();
+    if (pcm) {
+        // Playout runs at the audio callback's priority in realtime mode
+        std::function<void()> audio_init;
+        if (config.realtime) {
+            const int priority = config.audio_priority;
+            audio_init = [priority]() {
+                std::string error;
+                if (!realtime_configure_thread(pthread_self(), -1, priority, error)) {
+                    std::cerr << "Realtime: PCM playout thread: " << error << std::endl;
+                }
+            };
+        }
+        pcm->start(audio_init);
+    } else {
+        adc.startStream();
+    }
+    watcher.start();
+    std::cout << "Rendering LEDs at " << pipeline.renderer().frame_rate() << " fps." << std::endl;
+
     std::cout << "Listening to audio..." << std::endl;
-    auto start_time = std::chrono::steady_clock::now();
-    int cycles_count = 0;
+    app_log().start();
     while (keepRunning) {
-        
-        if(new_data){
-
-            int max_mag_idx =  fft_calculate_magnitudes();
-            detect_notes(pixels);
-            // if(max_mag_idx > 0){
-            //     new_data = 0;
-            //     cycles_count++;
-
-            //     // Find frequency at index with max magnitude
-            //     float freq = (max_mag_idx * SAMPLE_RATE) / FRAMES_PER_BUF;
-            //     // std::cout << "(Freq, Mag): " << freq << ", " << fft_magnitude[max_mag_idx] << std::endl;
-            //     freq_to_leds(pixels, freq);
-            // }
-            
-        }
 
-        auto current_time = std::chrono::steady_clock::now();
-        auto elapsed_duration = current_time - start_time;
-        long long milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed_duration).count();
-        if(milliseconds > 1000){
-            std::cout << "Cycles per second: " << cycles_count << std::endl;
-            cycles_count = 0;
-            start_time = current_time;
-        }
+        // The stages do the work; this thread just reports once per second
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+
+        Pipeline::Stats stats = pipeline.take_stats();
+        app_log().log(LOG_STATS, stats.fft_frames, stats.worst_fft_us, stats.led_frames, stats.dropped);
 
+        if (pcm) {
+            PcmInput::Stats input = pcm->take_stats();
+            if (input.underruns || input.late || input.lost || input.skipped) {
+                app_log().log(LOG_INPUT_STATS, input.buffered_ms, input.underruns, input.late, input.lost,
+                              input.skipped);
+            }
+            if (pcm->finished()) {
+                app_log().log(LOG_END_OF_INPUT);
+                keepRunning = false;
+            }
+        }
     }
 
     if (adc.isStreamRunning()) {
@@ -415,8 +445,15 @@ int main() {
         adc.closeStream();
     }
 
-    pixels.clear();
-    pixels.show();
+    if (pcm) {
+        pcm->stop();
+    }
+    watcher.stop();
+    pipeline.stop();
+    retiredAnalyzers.clear();
+    app_log().stop();
+    pixels->clear();
+    pixels->show();
     usleep(1000); // Small delay to ensure clear command is sent
 
     std::cout << "Program finished." << std::endl;
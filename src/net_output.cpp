@@ -0,0 +1,311 @@
+#include "net_output.h"
+
+#include <arpa/inet.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <unistd.h>
+
+// Pixels are copied into the DMX data as-is, so they must be packed RGB.
+static_assert(sizeof(Pixel) == 3, "Pixel must be 3 packed bytes");
+
+// E1.31 layout (ANSI E1.31-2016, section 4-6)
+#define E131_HEADER_SIZE       126   // Root + framing + DMP layers, including the start code
+#define E131_SYNC_SIZE         49
+#define E131_SEQUENCE_OFFSET   111
+#define E131_SYNC_SEQ_OFFSET   44
+#define E131_PRIORITY          100
+#define E131_SOURCE_NAME       "Chromesthat"
+
+// Art-Net layout (Art-Net 4, ArtDmx and ArtSync)
+#define ARTNET_HEADER_SIZE     18
+#define ARTNET_SYNC_SIZE       14
+#define ARTNET_SEQUENCE_OFFSET 12
+#define ARTNET_OP_DMX          0x5000
+#define ARTNET_OP_SYNC         0x5200
+#define ARTNET_VERSION         14
+
+static void put_u16(uint8_t *p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v >> 8);
+    p[1] = static_cast<uint8_t>(v);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    put_u16(p, static_cast<uint16_t>(v >> 16));
+    put_u16(p + 2, static_cast<uint16_t>(v));
+}
+
+// E1.31 PDU flags and length: high nibble 0x7, low 12 bits the length from here to the end.
+static void put_flags_length(uint8_t *p, size_t length) {
+    put_u16(p, static_cast<uint16_t>(0x7000 | (length & 0x0fff)));
+}
+
+static void put_e131_root(uint8_t *p, size_t packet_length, uint32_t vector, const uint8_t cid[16]) {
+    static const char acn_id[12] = {'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0};
+    put_u16(p, 0x0010);     // Preamble size
+    put_u16(p + 2, 0x0000); // Post-amble size
+    std::memcpy(p + 4, acn_id, sizeof(acn_id));
+    put_flags_length(p + 16, packet_length - 16);
+    put_u32(p + 18, vector);
+    std::memcpy(p + 22, cid, 16);
+}
+
+static sockaddr_in make_address(const std::string &host, int port) {
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+        throw std::runtime_error("Error: Output host '" + host + "' is not an IPv4 address.");
+    }
+    return addr;
+}
+
+// E1.31 multicast group of a universe: 239.255.<high byte>.<low byte>
+static sockaddr_in e131_multicast(uint16_t universe, int port) {
+    return make_address("239.255." + std::to_string(universe >> 8) + "." + std::to_string(universe & 0xff), port);
+}
+
+/**
+ * @brief Constructor that opens the socket and builds the packet headers.
+ * @param num The number of LEDs driven.
+ * @param protocol E1.31 or Art-Net.
+ * @param host Destination address, empty for the protocol default.
+ * @param port UDP port, 0 for the protocol default.
+ * @param first_universe Universe of the first pixel.
+ * @param sync_universe E1.31 universe the sync packet goes to; 0 uses the
+ *                      one after the last data universe. Unused by Art-Net.
+ * @throws std::runtime_error if the address is invalid or the socket cannot be set up.
+ */
+NetOutput::NetOutput(uint32_t num, NetProtocol protocol, const std::string &host, int port,
+                     uint16_t first_universe, uint16_t sync_universe)
+    : LedOutput(num), protocol(protocol), sequence(0) {
+
+    if ((sock_fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+        throw std::runtime_error("Error: Cannot create UDP socket: " + std::string(strerror(errno)));
+    }
+    int enable = 1;
+    setsockopt(sock_fd, SOL_SOCKET, SO_BROADCAST, &enable, sizeof(enable));
+
+    try {
+        if (protocol == NET_E131) {
+            build_e131(host, port ? port : E131_PORT, first_universe, sync_universe);
+        } else {
+            build_artnet(host, port ? port : ARTNET_PORT, first_universe);
+        }
+    } catch (...) {
+        close(sock_fd);
+        throw;
+    }
+
+    // Slots are cache-line aligned so packets never share a line.
+    slot_size = 0;
+    for (const Packet &packet : packets) {
+        slot_size = std::max(slot_size, packet.length);
+    }
+    slot_size = (slot_size + 63) & ~static_cast<size_t>(63);
+
+    // Message headers are filled once; write_encoded() only points them at the frame.
+    iovecs.resize(packets.size());
+    messages.resize(packets.size());
+    for (size_t i = 0; i < packets.size(); i++) {
+        iovecs[i].iov_base = nullptr;
+        iovecs[i].iov_len = packets[i].length;
+        std::memset(&messages[i], 0, sizeof(mmsghdr));
+        messages[i].msg_hdr.msg_name = &packets[i].dest;
+        messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        messages[i].msg_hdr.msg_iov = &iovecs[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+}
+
+/**
+ * @brief Destructor that blanks the controllers and closes the socket.
+ */
+NetOutput::~NetOutput() {
+    try {
+        clear();
+        show();
+    } catch (const std::exception& e) {
+        // Suppress exceptions during destruction
+    }
+    close(sock_fd);
+}
+
+void NetOutput::build_e131(const std::string &host, int port, uint16_t first_universe, uint16_t sync_universe) {
+    // Component ID: identifies this sender to the receivers for the process lifetime.
+    uint8_t cid[16];
+    std::random_device random;
+    for (uint8_t &b : cid) {
+        b = static_cast<uint8_t>(random());
+    }
+
+    const uint32_t universes = (num_leds + PIXELS_PER_UNIVERSE - 1) / PIXELS_PER_UNIVERSE;
+    if (sync_universe == 0) {
+        sync_universe = static_cast<uint16_t>(first_universe + universes);
+    }
+    if (first_universe < 1 || first_universe + universes - 1 > 63999 || sync_universe > 63999) {
+        throw std::runtime_error("Error: E1.31 universes must be between 1 and 63999.");
+    }
+
+    for (uint32_t u = 0; u < universes; u++) {
+        Packet packet;
+        uint16_t universe = static_cast<uint16_t>(first_universe + u);
+        packet.first_pixel = u * PIXELS_PER_UNIVERSE;
+        packet.pixel_count = std::min<uint32_t>(PIXELS_PER_UNIVERSE, num_leds - packet.first_pixel);
+        const size_t channels = packet.pixel_count * 3;
+        packet.length = E131_HEADER_SIZE + channels;
+        packet.dest = host.empty() ? e131_multicast(universe, port) : make_address(host, port);
+
+        packet.header.assign(E131_HEADER_SIZE, 0);
+        uint8_t *p = packet.header.data();
+        put_e131_root(p, packet.length, 0x00000004, cid); // VECTOR_ROOT_E131_DATA
+        // Framing layer
+        put_flags_length(p + 38, packet.length - 38);
+        put_u32(p + 40, 0x00000002);                      // VECTOR_E131_DATA_PACKET
+        std::strncpy(reinterpret_cast<char *>(p + 44), E131_SOURCE_NAME, 63);
+        p[108] = E131_PRIORITY;
+        put_u16(p + 109, sync_universe);
+        p[112] = 0;                                       // Options
+        put_u16(p + 113, universe);
+        // DMP layer
+        put_flags_length(p + 115, packet.length - 115);
+        p[117] = 0x02;                                    // VECTOR_DMP_SET_PROPERTY
+        p[118] = 0xa1;                                    // Address and data type
+        put_u16(p + 119, 0x0000);                         // First property address
+        put_u16(p + 121, 0x0001);                         // Address increment
+        put_u16(p + 123, static_cast<uint16_t>(channels + 1));
+        p[125] = 0x00;                                    // DMX start code
+        packets.push_back(packet);
+    }
+
+    Packet sync;
+    sync.first_pixel = 0;
+    sync.pixel_count = 0;
+    sync.length = E131_SYNC_SIZE;
+    sync.dest = host.empty() ? e131_multicast(sync_universe, port) : make_address(host, port);
+    sync.header.assign(E131_SYNC_SIZE, 0);
+    uint8_t *p = sync.header.data();
+    put_e131_root(p, sync.length, 0x00000008, cid);       // VECTOR_ROOT_E131_EXTENDED
+    put_flags_length(p + 38, sync.length - 38);
+    put_u32(p + 40, 0x00000001);                          // VECTOR_E131_EXTENDED_SYNCHRONIZATION
+    put_u16(p + 45, sync_universe);
+    packets.push_back(sync);
+
+    sequence_offset = E131_SEQUENCE_OFFSET;
+    sync_sequence_offset = E131_SYNC_SEQ_OFFSET;
+}
+
+void NetOutput::build_artnet(const std::string &host, int port, uint16_t first_universe) {
+    static const char artnet_id[8] = {'A', 'r', 't', '-', 'N', 'e', 't', 0};
+    const sockaddr_in dest = make_address(host.empty() ? "255.255.255.255" : host, port);
+
+    const uint32_t universes = (num_leds + PIXELS_PER_UNIVERSE - 1) / PIXELS_PER_UNIVERSE;
+    if (first_universe + universes - 1 > 0x7fff) {
+        throw std::runtime_error("Error: Art-Net universes must be between 0 and 32767.");
+    }
+
+    for (uint32_t u = 0; u < universes; u++) {
+        Packet packet;
+        uint16_t universe = static_cast<uint16_t>(first_universe + u);
+        packet.first_pixel = u * PIXELS_PER_UNIVERSE;
+        packet.pixel_count = std::min<uint32_t>(PIXELS_PER_UNIVERSE, num_leds - packet.first_pixel);
+        // ArtDmx data length must be even; encode() zeroes the pad byte.
+        const size_t channels = (packet.pixel_count * 3 + 1) & ~static_cast<size_t>(1);
+        packet.length = ARTNET_HEADER_SIZE + channels;
+        packet.dest = dest;
+
+        packet.header.assign(ARTNET_HEADER_SIZE, 0);
+        uint8_t *p = packet.header.data();
+        std::memcpy(p, artnet_id, sizeof(artnet_id));
+        p[8] = ARTNET_OP_DMX & 0xff;                       // OpCode, little-endian
+        p[9] = ARTNET_OP_DMX >> 8;
+        put_u16(p + 10, ARTNET_VERSION);
+        p[13] = 0;                                          // Physical port
+        p[14] = universe & 0xff;                            // SubUni
+        p[15] = (universe >> 8) & 0x7f;                     // Net
+        put_u16(p + 16, static_cast<uint16_t>(channels));
+        packets.push_back(packet);
+    }
+
+    Packet sync;
+    sync.first_pixel = 0;
+    sync.pixel_count = 0;
+    sync.length = ARTNET_SYNC_SIZE;
+    sync.dest = dest;
+    sync.header.assign(ARTNET_SYNC_SIZE, 0);
+    std::memcpy(sync.header.data(), artnet_id, sizeof(artnet_id));
+    sync.header[8] = ARTNET_OP_SYNC & 0xff;
+    sync.header[9] = ARTNET_OP_SYNC >> 8;
+    put_u16(sync.header.data() + 10, ARTNET_VERSION);
+    packets.push_back(sync);
+
+    sequence_offset = ARTNET_SEQUENCE_OFFSET;
+    sync_sequence_offset = 0;
+}
+
+/**
+ * @brief Lays out every universe packet and the sync packet of one frame.
+ * @param src size() pixels.
+ * @param out encoded_size() bytes.
+ */
+void NetOutput::encode(const Pixel *src, uint8_t *out) {
+    // Art-Net reserves sequence 0 for "not sequenced".
+    sequence++;
+    if (protocol == NET_ARTNET && sequence == 0) {
+        sequence = 1;
+    }
+
+    const uint8_t *pixel_bytes = reinterpret_cast<const uint8_t *>(src);
+    const size_t data_packets = packets.size() - 1;
+    for (size_t i = 0; i < data_packets; i++) {
+        const Packet &packet = packets[i];
+        uint8_t *slot = out + i * slot_size;
+        const size_t header_size = packet.header.size();
+        const size_t data_size = packet.pixel_count * 3;
+
+        std::memcpy(slot, packet.header.data(), header_size);
+        slot[sequence_offset] = sequence;
+        std::memcpy(slot + header_size, pixel_bytes + packet.first_pixel * 3, data_size);
+        if (header_size + data_size < packet.length) {
+            slot[header_size + data_size] = 0;
+        }
+    }
+
+    const Packet &sync = packets.back();
+    uint8_t *slot = out + data_packets * slot_size;
+    std::memcpy(slot, sync.header.data(), sync.length);
+    if (sync_sequence_offset) {
+        slot[sync_sequence_offset] = sequence;
+    }
+}
+
+/**
+ * @brief Sends every packet of a frame produced by encode() with one sendmmsg().
+ * @param data Encoded bytes.
+ * @param size Number of bytes, normally encoded_size().
+ * @throws std::runtime_error if the frame could not be sent.
+ */
+void NetOutput::write_encoded(const uint8_t *data, size_t size) {
+    if (size < encoded_size()) {
+        throw std::runtime_error("Error: Network frame is truncated.");
+    }
+    for (size_t i = 0; i < messages.size(); i++) {
+        iovecs[i].iov_base = const_cast<uint8_t *>(data + i * slot_size);
+    }
+
+    // The kernel may accept fewer messages than asked (e.g. a full socket buffer).
+    size_t sent = 0;
+    while (sent < messages.size()) {
+        int n = sendmmsg(sock_fd, &messages[sent], static_cast<unsigned int>(messages.size() - sent), 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Error: Failed to send network frame: " + std::string(strerror(errno)));
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
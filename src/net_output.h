@@ -0,0 +1,93 @@
+#ifndef _NET_OUTPUT_H_
+#define _NET_OUTPUT_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "led_output.h"
+
+#define E131_PORT   5568
+#define ARTNET_PORT 6454
+
+// RGB pixels that fit in one 512-channel DMX universe.
+#define PIXELS_PER_UNIVERSE 170
+
+/**
+ * @brief Wire protocol spoken to the pixel controllers.
+ */
+enum NetProtocol {
+    NET_E131,   // ANSI E1.31 (sACN), multicast or unicast
+    NET_ARTNET  // Art-Net 4 ArtDmx, broadcast or unicast
+};
+
+/**
+ * @class NetOutput
+ * @brief Drives pixel controllers over Ethernet with E1.31 or Art-Net.
+ *
+ * Pixels are packed RGB into consecutive universes of PIXELS_PER_UNIVERSE.
+ * encode() lays out every universe packet plus a trailing sync packet in
+ * fixed-size slots of one buffer, copying prebuilt headers and the pixel
+ * bytes straight through. write_encoded() sends the whole frame with one
+ * sendmmsg() call from preallocated message headers. The sync packet makes
+ * controllers that support it latch all universes at once.
+ */
+class NetOutput : public LedOutput {
+public:
+    /**
+     * @brief Constructor that opens the socket and builds the packet headers.
+     * @param num The number of LEDs driven.
+     * @param protocol E1.31 or Art-Net.
+     * @param host Destination address. Empty selects the protocol default: the
+     *             per-universe multicast groups for E1.31, broadcast for Art-Net.
+     * @param port UDP port, 0 for the protocol default.
+     * @param first_universe Universe of the first pixel.
+     * @param sync_universe E1.31 universe the sync packet goes to; 0 uses the
+     *                      one after the last data universe. Unused by Art-Net.
+     * @throws std::runtime_error if the address is invalid or the socket cannot be set up.
+     */
+    NetOutput(uint32_t num, NetProtocol protocol, const std::string &host, int port,
+              uint16_t first_universe, uint16_t sync_universe = 0);
+
+    /**
+     * @brief Destructor that blanks the controllers and closes the socket.
+     */
+    ~NetOutput();
+
+    size_t encoded_size() const override { return slot_size * packets.size(); }
+    void encode(const Pixel *src, uint8_t *out) override;
+    void write_encoded(const uint8_t *data, size_t size) override;
+
+    /**
+     * @brief Highest frame rate worth sending. The network is not the limit;
+     *        this just stops the renderer from flooding the controllers.
+     */
+    float max_frame_rate() const override { return 1000.0f; }
+
+private:
+    // One data or sync packet of a frame.
+    struct Packet {
+        std::vector<uint8_t> header; // Prebuilt, copied at the start of the slot
+        uint32_t first_pixel;        // Data packets: pixels copied after the header
+        uint32_t pixel_count;
+        size_t length;               // Header plus data
+        sockaddr_in dest;
+    };
+
+    int sock_fd;
+    NetProtocol protocol;
+    size_t slot_size;                // Bytes reserved per packet in the encoded buffer
+    size_t sequence_offset;          // Where each data header holds the sequence number
+    size_t sync_sequence_offset;     // Same in the sync packet (0 if it has none)
+    uint8_t sequence;
+    std::vector<Packet> packets;     // Data universes, then the sync packet
+    std::vector<iovec> iovecs;
+    std::vector<mmsghdr> messages;
+
+    void build_e131(const std::string &host, int port, uint16_t first_universe, uint16_t sync_universe);
+    void build_artnet(const std::string &host, int port, uint16_t first_universe);
+};
+
+#endif // _NET_OUTPUT_H_
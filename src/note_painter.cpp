@@ -0,0 +1,87 @@
+#include "note_painter.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+template <uint32_t NUM_LEDS>
+FixedNotePainter<NUM_LEDS>::FixedNotePainter() {
+    const uint32_t leds_per_note = NUM_LEDS / NUM_NOTES;
+    for (uint32_t i = 0; i < NUM_LEDS; i++) {
+        uint32_t note_idx = leds_per_note > 0 ? i / leds_per_note : NUM_NOTES;
+        led_note[i] = static_cast<uint8_t>(note_idx < NUM_NOTES ? note_idx : NUM_NOTES);
+    }
+}
+
+/**
+ * @brief Constructor taking the pitch class of each LED (NUM_NOTES = dark).
+ */
+template <uint32_t NUM_LEDS>
+FixedNotePainter<NUM_LEDS>::FixedNotePainter(const uint8_t *led_note) {
+    std::copy(led_note, led_note + NUM_LEDS, this->led_note.begin());
+}
+
+template <uint32_t NUM_LEDS>
+void FixedNotePainter<NUM_LEDS>::paint(const Pixel colours[NUM_NOTES + 1], Pixel *out) const {
+    for (uint32_t i = 0; i < NUM_LEDS; i++) {
+        out[i] = colours[led_note[i]];
+    }
+}
+
+// Strip lengths compiled in. Add a line here, in make_note_painter() and in config.cpp to support another.
+template class FixedNotePainter<48>;
+template class FixedNotePainter<60>;
+template class FixedNotePainter<144>;
+template class FixedNotePainter<300>;
+template class FixedNotePainter<600>;
+template class FixedNotePainter<1024>;
+template class FixedNotePainter<2048>;
+template class FixedNotePainter<4096>;
+
+LayoutPainter::LayoutPainter(const LedLayout &layout) : led_note(layout.led_note) {
+}
+
+void LayoutPainter::paint(const Pixel colours[NUM_NOTES + 1], Pixel *out) const {
+    const uint8_t *note = led_note.data();
+    const size_t n = led_note.size();
+    for (size_t i = 0; i < n; i++) {
+        out[i] = colours[note[i]];
+    }
+}
+
+// A layout of a compiled length gets the fixed-length loop with its table.
+template <uint32_t NUM_LEDS>
+static std::unique_ptr<NotePainter> make_fixed(const LedLayout *layout) {
+    if (layout) {
+        return std::unique_ptr<NotePainter>(new FixedNotePainter<NUM_LEDS>(layout->led_note.data()));
+    }
+    return std::unique_ptr<NotePainter>(new FixedNotePainter<NUM_LEDS>());
+}
+
+/**
+ * @brief Creates the painter for a strip of num_leds, specialised for its length if compiled in.
+ * @param layout Physical layout, or nullptr for twelve equal runs along the strip.
+ * @throws std::runtime_error if there is no layout and num_leds is not one of the
+ *         compiled lengths, or the layout does not have num_leds LEDs.
+ */
+std::unique_ptr<NotePainter> make_note_painter(uint32_t num_leds, const LedLayout *layout) {
+    if (layout && layout->size() != num_leds) {
+        throw std::runtime_error("Error: The layout has " + std::to_string(layout->size()) +
+                                 " LEDs but num_leds is " + std::to_string(num_leds) + ".");
+    }
+    switch (num_leds) {
+    case 48:   return make_fixed<48>(layout);
+    case 60:   return make_fixed<60>(layout);
+    case 144:  return make_fixed<144>(layout);
+    case 300:  return make_fixed<300>(layout);
+    case 600:  return make_fixed<600>(layout);
+    case 1024: return make_fixed<1024>(layout);
+    case 2048: return make_fixed<2048>(layout);
+    case 4096: return make_fixed<4096>(layout);
+    }
+    if (layout) {
+        return std::unique_ptr<NotePainter>(new LayoutPainter(*layout));
+    }
+    throw std::runtime_error("Error: Unsupported LED count " + std::to_string(num_leds) +
+                             " (supported: 48, 60, 144, 300, 600, 1024, 2048, 4096, or any with a layout).");
+}
@@ -0,0 +1,84 @@
+#ifndef _NOTE_PAINTER_H_
+#define _NOTE_PAINTER_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "led_layout.h"
+#include "led_output.h"
+#include "notes.h"
+
+/**
+ * @class NotePainter
+ * @brief Runtime interface for filling the pixel buffer from per-note colours.
+ */
+class NotePainter {
+public:
+    virtual ~NotePainter() {}
+
+    /**
+     * @brief Number of LEDs this painter fills.
+     */
+    virtual uint32_t num_leds() const = 0;
+
+    /**
+     * @brief Writes one colour per LED.
+     * @param colours Colour of each pitch class, plus colours[NUM_NOTES] for unassigned LEDs.
+     * @param out Pixel buffer of num_leds() entries.
+     */
+    virtual void paint(const Pixel colours[NUM_NOTES + 1], Pixel *out) const = 0;
+};
+
+/**
+ * @class FixedNotePainter
+ * @brief Note-to-LED mapping specialised for one strip length.
+ *
+ * By default each pitch class owns NUM_LEDS / 12 consecutive LEDs; a layout
+ * can supply any other assignment. Painting is a single fixed-length gather
+ * through the LED-to-note table.
+ */
+template <uint32_t NUM_LEDS>
+class FixedNotePainter : public NotePainter {
+public:
+    FixedNotePainter();
+
+    /**
+     * @brief Constructor taking the pitch class of each LED (NUM_NOTES = dark).
+     */
+    explicit FixedNotePainter(const uint8_t *led_note);
+
+    uint32_t num_leds() const { return NUM_LEDS; }
+    void paint(const Pixel colours[NUM_NOTES + 1], Pixel *out) const;
+
+private:
+    std::array<uint8_t, NUM_LEDS> led_note; // Pitch class of each LED, NUM_NOTES if unassigned
+};
+
+/**
+ * @class LayoutPainter
+ * @brief Note-to-LED mapping from a layout of any length.
+ *
+ * Same single gather as FixedNotePainter, with the length known only at run time.
+ */
+class LayoutPainter : public NotePainter {
+public:
+    explicit LayoutPainter(const LedLayout &layout);
+
+    uint32_t num_leds() const { return static_cast<uint32_t>(led_note.size()); }
+    void paint(const Pixel colours[NUM_NOTES + 1], Pixel *out) const;
+
+private:
+    std::vector<uint8_t> led_note; // Pitch class of each LED, NUM_NOTES if unassigned
+};
+
+/**
+ * @brief Creates the painter for a strip of num_leds, specialised for its length if compiled in.
+ * @param layout Physical layout, or nullptr for twelve equal runs along the strip.
+ * @throws std::runtime_error if there is no layout and num_leds is not one of the
+ *         compiled lengths, or the layout does not have num_leds LEDs.
+ */
+std::unique_ptr<NotePainter> make_note_painter(uint32_t num_leds, const LedLayout *layout = nullptr);
+
+#endif // _NOTE_PAINTER_H_
@@ -0,0 +1,41 @@
+#ifndef _NOTES_H_
+#define _NOTES_H_
+
+#include <cmath>
+
+#define NUM_NOTES 12
+
+// The reference frequency for the A4 note.
+const double A4_FREQUENCY = 440.0;
+
+// A4 is MIDI note number 69.
+const int A4_MIDI_NUMBER = 69;
+
+/**
+ * @brief Closest MIDI note number to a frequency.
+ * @param frequency Frequency in Hz (must be > 0).
+ */
+inline int freq_to_midi(double frequency) {
+    // The formula is derived from: freq = A4 * 2^(semitones/12)
+    double semitones_from_a4 = 12.0 * std::log2(frequency / A4_FREQUENCY);
+    return static_cast<int>(std::round(semitones_from_a4)) + A4_MIDI_NUMBER;
+}
+
+/**
+ * @brief Pitch class (0 = C ... 11 = B) of the note closest to a frequency.
+ * @param frequency Frequency in Hz (must be > 0).
+ */
+inline int freq_to_note_index(double frequency) {
+    return ((freq_to_midi(frequency) % NUM_NOTES) + NUM_NOTES) % NUM_NOTES;
+}
+
+/**
+ * @brief Name of a pitch class, e.g. "C#".
+ * @param note_index Pitch class, 0 = C ... 11 = B.
+ */
+inline const char *note_name(int note_index) {
+    static const char *const names[NUM_NOTES] = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
+    return names[((note_index % NUM_NOTES) + NUM_NOTES) % NUM_NOTES];
+}
+
+#endif // _NOTES_H_
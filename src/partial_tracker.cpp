@@ -0,0 +1,233 @@
+#include "partial_tracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+// A peak continues a note within this ratio of its frequency (half a semitone).
+#define MATCH_RATIO 1.0293022f
+// Highest MIDI note tracked; peaks above it (about 12.5 kHz) are ignored.
+#define MAX_MIDI 127
+
+/**
+ * @brief Constructor.
+ * @param release_ms How long a note may go unseen before it is released.
+ * @param min_magnitude Peaks must exceed this magnitude.
+ */
+PartialTracker::PartialTracker(float release_ms, double min_magnitude)
+    : count(0), num_peaks(0), next_note_id(1), lost(0) {
+    configure(release_ms, min_magnitude);
+}
+
+/**
+ * @brief Changes the release time and threshold. Feature stage thread only.
+ */
+void PartialTracker::configure(float release_ms, double min_magnitude) {
+    release_s = std::max(0.0f, release_ms) / 1000.0;
+    this->min_magnitude = min_magnitude;
+}
+
+// Local maxima above the threshold, strongest MAX_PEAKS kept, sorted by frequency.
+void PartialTracker::find_peaks(const double *magnitudes, int num_bins, const Analyzer &analyzer) {
+    num_peaks = 0;
+    bool sorted = true;
+
+    for (int i = 1; i + 1 < num_bins; i++) {
+        const double m = magnitudes[i];
+        if (m <= min_magnitude || m < magnitudes[i - 1] || m <= magnitudes[i + 1]) {
+            continue;
+        }
+
+        // Parabolic interpolation on log magnitude; the bins need not be evenly spaced.
+        const double a = std::log(magnitudes[i - 1] + 1e-9);
+        const double b = std::log(m);
+        const double c = std::log(magnitudes[i + 1] + 1e-9);
+        const double denom = a - 2 * b + c;
+        double delta = denom < 0 ? 0.5 * (a - c) / denom : 0.0;
+        delta = std::max(-0.5, std::min(0.5, delta));
+        const double f = analyzer.bin_frequency(i);
+        const double f_next = delta >= 0 ? analyzer.bin_frequency(i + 1) : analyzer.bin_frequency(i - 1);
+        const float frequency = static_cast<float>(f + std::fabs(delta) * (f_next - f));
+        if (frequency <= 0) {
+            continue;
+        }
+
+        int slot = num_peaks;
+        if (num_peaks == MAX_PEAKS) {
+            // Full: replace the weakest if this one is stronger.
+            slot = static_cast<int>(std::min_element(peak_magnitude.begin(), peak_magnitude.end()) -
+                                    peak_magnitude.begin());
+            if (peak_magnitude[slot] >= m) {
+                continue;
+            }
+            sorted = false;
+        } else {
+            num_peaks++;
+        }
+        peak_freq[slot] = frequency;
+        peak_magnitude[slot] = static_cast<float>(m);
+    }
+
+    if (!sorted) {
+        for (int i = 1; i < num_peaks; i++) {
+            for (int j = i; j > 0 && peak_freq[j] < peak_freq[j - 1]; j--) {
+                std::swap(peak_freq[j], peak_freq[j - 1]);
+                std::swap(peak_magnitude[j], peak_magnitude[j - 1]);
+            }
+        }
+    }
+}
+
+// Pairs each peak with the nearest unmatched note within MATCH_RATIO, in one pass.
+void PartialTracker::match() {
+    for (int k = 0; k < count; k++) {
+        matched_peak[k] = -1;
+    }
+    int first = 0;
+    for (int p = 0; p < num_peaks; p++) {
+        peak_used[p] = false;
+        const float f = peak_freq[p];
+        while (first < count && freq[first] < f / MATCH_RATIO) {
+            first++;
+        }
+        int best = -1;
+        float best_ratio = MATCH_RATIO;
+        for (int k = first; k < count && freq[k] <= f * MATCH_RATIO; k++) {
+            float ratio = freq[k] > f ? freq[k] / f : f / freq[k];
+            if (matched_peak[k] < 0 && ratio < best_ratio) {
+                best = k;
+                best_ratio = ratio;
+            }
+        }
+        if (best >= 0) {
+            matched_peak[best] = static_cast<int8_t>(p);
+            peak_used[p] = true;
+        }
+    }
+}
+
+int PartialTracker::emit(NoteEvent *events, int n, int max_events, const NoteEvent &event) {
+    if (n < max_events) {
+        events[n++] = event;
+    } else {
+        lost++;
+    }
+    return n;
+}
+
+void PartialTracker::keep(int &n, float f, float mag, double onset, double seen, uint32_t note_id, int8_t note_midi) {
+    next_freq[n] = f;
+    next_peak_mag[n] = mag;
+    next_onset_time[n] = onset;
+    next_last_seen[n] = seen;
+    next_id[n] = note_id;
+    next_midi[n] = note_midi;
+    n++;
+}
+
+/**
+ * @brief Feeds one analysis frame.
+ * @param magnitudes Bin magnitudes from the analyzer.
+ * @param num_bins Number of bins.
+ * @param analyzer Analyzer that produced them, for bin frequencies.
+ * @param stream_time Stream time of the frame (s).
+ * @param events Output, note events of this frame, onsets after releases.
+ * @param max_events Capacity of events; extra events are counted but not returned.
+ * @return Number of events written.
+ */
+int PartialTracker::update(const double *magnitudes, int num_bins, const Analyzer &analyzer, double stream_time,
+                           NoteEvent *events, int max_events) {
+    find_peaks(magnitudes, num_bins, analyzer);
+    match();
+
+    int num_events = 0;
+    int n = 0;
+    uint64_t sounding[2] = {0, 0}; // MIDI notes kept, so two peaks never make the same note twice
+
+    // Continue, hold or release every note.
+    for (int k = 0; k < count; k++) {
+        const int p = matched_peak[k];
+        bool release = false;
+        if (p >= 0) {
+            const int m = freq_to_midi(peak_freq[p]);
+            if (m == midi[k]) {
+                keep(n, peak_freq[p], std::max(peak_mag[k], peak_magnitude[p]), onset_time[k], stream_time,
+                     id[k], midi[k]);
+                sounding[m >> 6] |= 1ull << (m & 63);
+                continue;
+            }
+            // Drifted to another semitone: this note ends and the peak starts a new one.
+            peak_used[p] = false;
+            release = true;
+        } else {
+            release = stream_time - last_seen[k] > release_s;
+        }
+
+        if (release) {
+            NoteEvent off = {NOTE_OFF, midi[k], id[k], freq[k], peak_mag[k], stream_time,
+                             static_cast<float>(last_seen[k] - onset_time[k])};
+            num_events = emit(events, num_events, max_events, off);
+        } else {
+            keep(n, freq[k], peak_mag[k], onset_time[k], last_seen[k], id[k], midi[k]);
+            sounding[midi[k] >> 6] |= 1ull << (midi[k] & 63);
+        }
+    }
+
+    // Unmatched peaks start notes.
+    for (int p = 0; p < num_peaks && n < MAX_PARTIALS; p++) {
+        const int m = freq_to_midi(peak_freq[p]);
+        if (peak_used[p] || m < 0 || m > MAX_MIDI || (sounding[m >> 6] & (1ull << (m & 63)))) {
+            continue;
+        }
+        sounding[m >> 6] |= 1ull << (m & 63);
+        const uint32_t note_id = next_note_id++;
+        keep(n, peak_freq[p], peak_magnitude[p], stream_time, stream_time, note_id, static_cast<int8_t>(m));
+        NoteEvent on = {NOTE_ON, static_cast<int8_t>(m), note_id, peak_freq[p], peak_magnitude[p], stream_time, 0.0f};
+        num_events = emit(events, num_events, max_events, on);
+    }
+
+    // Restore frequency order; the list is nearly sorted, so this is close to linear.
+    for (int i = 1; i < n; i++) {
+        for (int j = i; j > 0 && next_freq[j] < next_freq[j - 1]; j--) {
+            std::swap(next_freq[j], next_freq[j - 1]);
+            std::swap(next_peak_mag[j], next_peak_mag[j - 1]);
+            std::swap(next_onset_time[j], next_onset_time[j - 1]);
+            std::swap(next_last_seen[j], next_last_seen[j - 1]);
+            std::swap(next_id[j], next_id[j - 1]);
+            std::swap(next_midi[j], next_midi[j - 1]);
+        }
+    }
+
+    count = n;
+    std::copy(next_freq.begin(), next_freq.begin() + n, freq.begin());
+    std::copy(next_peak_mag.begin(), next_peak_mag.begin() + n, peak_mag.begin());
+    std::copy(next_onset_time.begin(), next_onset_time.begin() + n, onset_time.begin());
+    std::copy(next_last_seen.begin(), next_last_seen.begin() + n, last_seen.begin());
+    std::copy(next_id.begin(), next_id.begin() + n, id.begin());
+    std::copy(next_midi.begin(), next_midi.begin() + n, midi.begin());
+    return num_events;
+}
+
+/**
+ * @brief Releases every note.
+ * @return Number of NOTE_OFF events written.
+ */
+int PartialTracker::release_all(double stream_time, NoteEvent *events, int max_events) {
+    int num_events = 0;
+    for (int k = 0; k < count; k++) {
+        NoteEvent off = {NOTE_OFF, midi[k], id[k], freq[k], peak_mag[k], stream_time,
+                         static_cast<float>(last_seen[k] - onset_time[k])};
+        num_events = emit(events, num_events, max_events, off);
+    }
+    count = 0;
+    return num_events;
+}
+
+/**
+ * @brief Pitch classes with a sounding note: 1.0 if any, 0.0 otherwise.
+ */
+void PartialTracker::pitch_levels(float levels[NUM_NOTES]) const {
+    std::fill(levels, levels + NUM_NOTES, 0.0f);
+    for (int k = 0; k < count; k++) {
+        levels[midi[k] % NUM_NOTES] = 1.0f;
+    }
+}
@@ -0,0 +1,136 @@
+#ifndef _PARTIAL_TRACKER_H_
+#define _PARTIAL_TRACKER_H_
+
+#include <array>
+#include <cstdint>
+
+#include "analyzer.h"
+#include "notes.h"
+
+// Notes followed at once; further new peaks are ignored until one is released.
+#define MAX_PARTIALS 64
+// Spectral peaks considered per frame (the strongest are kept).
+#define MAX_PEAKS 64
+// Events one NoteFrame can carry.
+#define MAX_NOTE_EVENTS 16
+
+enum NoteEventType {
+    NOTE_ON,
+    NOTE_OFF
+};
+
+/**
+ * @brief A note starting or ending, as seen by the partial tracker.
+ */
+struct NoteEvent {
+    uint8_t type;           // NoteEventType
+    int8_t midi;            // MIDI note number
+    uint32_t id;            // Same for the on and off of one note
+    float frequency;        // Hz, at onset (on) or last seen (off)
+    float magnitude;        // Strongest magnitude so far
+    double stream_time;     // Stream time of the onset (on) or release (off)
+    float duration;         // Seconds from onset to release; 0 for NOTE_ON
+};
+
+/**
+ * @class PartialTracker
+ * @brief Links spectral peaks across frames into notes with onset, sustain and release.
+ *
+ * Each frame the local maxima above the threshold are taken as peaks, with
+ * frequencies refined by parabolic interpolation. Peaks and notes are both
+ * kept sorted by frequency, so matching is one merge-like pass in O(peaks +
+ * notes): a peak continues the note within half a semitone of it. Unmatched
+ * peaks start new notes (NOTE_ON). A note that finds no peak is held for the
+ * release time before it ends (NOTE_OFF), so a sustained note that dips
+ * below the threshold for a frame or two neither flickers nor gets a new
+ * identity. A note whose frequency drifts to another semitone ends and a new
+ * one starts.
+ *
+ * State is a fixed-capacity structure of arrays; update() never allocates.
+ */
+class PartialTracker {
+public:
+    /**
+     * @brief Constructor.
+     * @param release_ms How long a note may go unseen before it is released.
+     * @param min_magnitude Peaks must exceed this magnitude.
+     */
+    PartialTracker(float release_ms, double min_magnitude);
+
+    /**
+     * @brief Changes the release time and threshold. Feature stage thread only.
+     */
+    void configure(float release_ms, double min_magnitude);
+
+    /**
+     * @brief Feeds one analysis frame.
+     * @param magnitudes Bin magnitudes from the analyzer.
+     * @param num_bins Number of bins.
+     * @param analyzer Analyzer that produced them, for bin frequencies.
+     * @param stream_time Stream time of the frame (s).
+     * @param events Output, note events of this frame, onsets after releases.
+     * @param max_events Capacity of events; extra events are counted but not returned.
+     * @return Number of events written.
+     */
+    int update(const double *magnitudes, int num_bins, const Analyzer &analyzer, double stream_time,
+               NoteEvent *events, int max_events);
+
+    /**
+     * @brief Releases every note.
+     * @return Number of NOTE_OFF events written.
+     */
+    int release_all(double stream_time, NoteEvent *events, int max_events);
+
+    /**
+     * @brief Pitch classes with a sounding note: 1.0 if any, 0.0 otherwise.
+     */
+    void pitch_levels(float levels[NUM_NOTES]) const;
+
+    /**
+     * @brief Notes currently sounding.
+     */
+    int active() const { return count; }
+
+    /**
+     * @brief Events that did not fit in an update's output since start.
+     */
+    uint64_t lost_events() const { return lost; }
+
+private:
+    double release_s;
+    double min_magnitude;
+
+    // Notes, sorted by frequency (structure of arrays)
+    int count;
+    std::array<float, MAX_PARTIALS> freq;
+    std::array<float, MAX_PARTIALS> peak_mag;       // Strongest magnitude so far
+    std::array<double, MAX_PARTIALS> onset_time;
+    std::array<double, MAX_PARTIALS> last_seen;
+    std::array<uint32_t, MAX_PARTIALS> id;
+    std::array<int8_t, MAX_PARTIALS> midi;
+    std::array<int8_t, MAX_PARTIALS> matched_peak;  // Peak continuing the note this frame, -1 if none
+
+    // This frame's peaks, sorted by frequency
+    int num_peaks;
+    std::array<float, MAX_PEAKS> peak_freq;
+    std::array<float, MAX_PEAKS> peak_magnitude;
+    std::array<bool, MAX_PEAKS> peak_used;
+
+    // Next frame's notes, built by merging
+    std::array<float, MAX_PARTIALS> next_freq;
+    std::array<float, MAX_PARTIALS> next_peak_mag;
+    std::array<double, MAX_PARTIALS> next_onset_time;
+    std::array<double, MAX_PARTIALS> next_last_seen;
+    std::array<uint32_t, MAX_PARTIALS> next_id;
+    std::array<int8_t, MAX_PARTIALS> next_midi;
+
+    uint32_t next_note_id;
+    uint64_t lost;
+
+    void find_peaks(const double *magnitudes, int num_bins, const Analyzer &analyzer);
+    void match();
+    int emit(NoteEvent *events, int n, int max_events, const NoteEvent &event);
+    void keep(int &n, float f, float mag, double onset, double seen, uint32_t note_id, int8_t note_midi);
+};
+
+#endif // _PARTIAL_TRACKER_H_
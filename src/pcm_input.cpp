@@ -0,0 +1,446 @@
+#include "pcm_input.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+// How long the threads block before re-checking for stop().
+#define RECEIVE_WAIT_MS 100
+#define PLAYOUT_WAIT_MS 100
+
+// Largest UDP payload, and the socket receive buffer that absorbs bursts.
+#define MAX_DATAGRAM 65536
+#define SOCKET_BUFFER_BYTES (1 << 20)
+
+// Clock drift is judged on the lowest fill seen over this long, so bursts of
+// network jitter are not mistaken for a sender running fast.
+#define DRIFT_WINDOW_MS 2000
+
+/**
+ * @brief Parses a PCM format name (s16, s16be, s24be or f32).
+ * @throws std::runtime_error if the name is unknown.
+ */
+PcmFormat pcm_format_from_name(const std::string &name) {
+    if (name == "s16")   return PCM_S16;
+    if (name == "s16be") return PCM_S16BE;
+    if (name == "s24be") return PCM_S24BE;
+    if (name == "f32")   return PCM_F32;
+    throw std::runtime_error("Error: Unknown PCM format '" + name + "' (use s16, s16be, s24be or f32).");
+}
+
+static size_t format_bytes(PcmFormat format) {
+    switch (format) {
+    case PCM_S16:
+    case PCM_S16BE: return 2;
+    case PCM_S24BE: return 3;
+    case PCM_F32:   return 4;
+    }
+    return 2;
+}
+
+/**
+ * @brief Constructor that opens the input the config asks for.
+ * @param config input, input_path, input_host, input_port, input_format,
+ *               input_channels, jitter_ms, sample_rate and buffer_frames.
+ * @param sink Called from the playout thread with every block.
+ * @throws std::runtime_error if the input cannot be opened.
+ */
+PcmInput::PcmInput(const Config &config, PcmSink sink)
+    : format(pcm_format_from_name(config.input_format)), channels(config.input_channels),
+      sample_rate(config.sample_rate), block_frames(static_cast<unsigned int>(config.buffer_frames)),
+      sink(sink), path(config.input_path), is_fifo(false), fd(-1),
+      read_pos(0), write_pos(0), primed(false), running(false), ended(false),
+      rx(MAX_DATAGRAM), rx_pending(0), rtp_synced(false), rtp_last_ts(0), rtp_last_pos(0),
+      block(config.buffer_frames), drift_blocks(0), drift_min_fill(0), underruns(0), late(0), lost(0), skipped(0),
+      receiver("pcm-receive", [this]() { receive_step(); }),
+      playout("pcm-playout", [this]() { playout_step(); }) {
+
+    if (config.input == "pipe")     mode = PCM_PIPE;
+    else if (config.input == "udp") mode = PCM_UDP;
+    else if (config.input == "rtp") mode = PCM_RTP;
+    else throw std::runtime_error("Error: Unknown PCM input '" + config.input + "'.");
+
+    frame_bytes = format_bytes(format) * channels;
+    mono.resize(rx.size() / frame_bytes);
+
+    // Round the jitter depth up to whole blocks.
+    uint64_t jitter = static_cast<uint64_t>(config.jitter_ms * sample_rate / 1000.0 + 0.5);
+    depth = (jitter + block_frames - 1) / block_frames * block_frames;
+    ring.assign(2 * depth + 8 * block_frames + mono.size(), 0.0f);
+
+    if (mode == PCM_PIPE) {
+        open_pipe();
+    } else {
+        open_socket(config.input_host, config.input_port);
+    }
+}
+
+/**
+ * @brief Destructor that stops both threads and closes the input.
+ */
+PcmInput::~PcmInput() {
+    stop();
+    if (fd >= 0 && fd != STDIN_FILENO) {
+        close(fd);
+    }
+}
+
+/**
+ * @brief Starts the receive and playout threads.
+ * @param playout_init Runs on the playout thread first (e.g. realtime setup).
+ */
+void PcmInput::start(std::function<void()> playout_init) {
+    running = true;
+    receiver.start();
+    playout.start(playout_init);
+}
+
+/**
+ * @brief Stops both threads and waits for them to exit.
+ */
+void PcmInput::stop() {
+    running = false;
+    data_ready.notify_all();
+    space_ready.notify_all();
+    receiver.stop();
+    playout.stop();
+}
+
+/**
+ * @brief True once a pipe or file reached its end and everything was played.
+ */
+bool PcmInput::finished() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return ended && (write_pos <= read_pos || write_pos - read_pos < block_frames);
+}
+
+/**
+ * @brief Returns and resets the counters.
+ */
+PcmInput::Stats PcmInput::take_stats() {
+    Stats stats;
+    stats.underruns = underruns.exchange(0);
+    stats.late = late.exchange(0);
+    stats.lost = lost.exchange(0);
+    stats.skipped = skipped.exchange(0);
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.buffered_ms = write_pos > read_pos ? (write_pos - read_pos) * 1000.0 / sample_rate : 0.0;
+    return stats;
+}
+
+void PcmInput::open_pipe() {
+    if (path == "-") {
+        fd = STDIN_FILENO;
+        name = "stdin";
+        return;
+    }
+
+    struct stat st;
+    is_fifo = stat(path.c_str(), &st) == 0 && S_ISFIFO(st.st_mode);
+    // A FIFO is opened non-blocking so startup doesn't wait for the first writer.
+    fd = open(path.c_str(), O_RDONLY | (is_fifo ? O_NONBLOCK : 0));
+    if (fd < 0) {
+        throw std::runtime_error("Error: Cannot open PCM input '" + path + "': " + strerror(errno) + ".");
+    }
+    name = (is_fifo ? "fifo " : "file ") + path;
+}
+
+void PcmInput::open_socket(const std::string &host, int port) {
+    struct in_addr address;
+    address.s_addr = htonl(INADDR_ANY);
+    if (!host.empty() && inet_pton(AF_INET, host.c_str(), &address) != 1) {
+        throw std::runtime_error("Error: Invalid input address '" + host + "' (expected IPv4).");
+    }
+    const bool multicast = IN_MULTICAST(ntohl(address.s_addr));
+
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("Error: Cannot create UDP socket: ") + strerror(errno) + ".");
+    }
+    int one = 1;
+    int buffer_bytes = SOCKET_BUFFER_BYTES;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer_bytes, sizeof(buffer_bytes));
+
+    struct sockaddr_in bind_addr;
+    std::memset(&bind_addr, 0, sizeof(bind_addr));
+    bind_addr.sin_family = AF_INET;
+    bind_addr.sin_port = htons(static_cast<uint16_t>(port));
+    bind_addr.sin_addr.s_addr = multicast ? htonl(INADDR_ANY) : address.s_addr;
+    if (bind(fd, reinterpret_cast<struct sockaddr *>(&bind_addr), sizeof(bind_addr)) < 0) {
+        std::string error = strerror(errno);
+        close(fd);
+        throw std::runtime_error("Error: Cannot listen on UDP port " + std::to_string(port) + ": " + error + ".");
+    }
+
+    if (multicast) {
+        struct ip_mreq group;
+        group.imr_multiaddr = address;
+        group.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &group, sizeof(group)) < 0) {
+            std::string error = strerror(errno);
+            close(fd);
+            throw std::runtime_error("Error: Cannot join multicast group " + host + ": " + error + ".");
+        }
+    }
+
+    char text[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &address, text, sizeof(text));
+    name = std::string(mode == PCM_RTP ? "rtp " : "udp ") + text + ":" + std::to_string(port);
+}
+
+// Converts frames of interleaved input to mono floats in mono[]. Returns frames.
+size_t PcmInput::convert(const uint8_t *data, size_t frames) {
+    const float scale = 1.0f / channels;
+    for (size_t i = 0; i < frames; i++) {
+        float sum = 0.0f;
+        for (int c = 0; c < channels; c++) {
+            switch (format) {
+            case PCM_S16: {
+                int16_t v;
+                std::memcpy(&v, data, 2);
+                sum += v * (1.0f / 32768.0f);
+                data += 2;
+                break;
+            }
+            case PCM_S16BE:
+                sum += static_cast<int16_t>((data[0] << 8) | data[1]) * (1.0f / 32768.0f);
+                data += 2;
+                break;
+            case PCM_S24BE: {
+                // Assemble in the top 24 bits so the sign comes for free.
+                int32_t v = static_cast<int32_t>((static_cast<uint32_t>(data[0]) << 24) |
+                                                 (static_cast<uint32_t>(data[1]) << 16) |
+                                                 (static_cast<uint32_t>(data[2]) << 8));
+                sum += v * (1.0f / 2147483648.0f);
+                data += 3;
+                break;
+            }
+            case PCM_F32: {
+                float v;
+                std::memcpy(&v, data, 4);
+                sum += v;
+                data += 4;
+                break;
+            }
+            }
+        }
+        mono[i] = sum * scale;
+    }
+    return frames;
+}
+
+// Places frames at sample position pos. Pipes wait for room (backpressure);
+// datagrams never wait, they push the oldest audio out instead.
+void PcmInput::write_samples(uint64_t pos, const float *samples, size_t frames, bool wait) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (pos < read_pos) {
+        // Arrived after (part of) its audio was played.
+        late++;
+        uint64_t behind = read_pos - pos;
+        if (behind >= frames) {
+            return;
+        }
+        samples += behind;
+        frames -= behind;
+        pos = read_pos;
+    }
+
+    if (wait) {
+        // Keep a pipe no further ahead than playout needs, so a fast writer
+        // (a file, ffmpeg without -re) is paced instead of skipped.
+        const uint64_t limit = depth + 2 * block_frames;
+        space_ready.wait(lock, [&]() { return !running || pos + frames <= read_pos + limit; });
+        if (!running) {
+            return;
+        }
+    } else if (pos + frames > read_pos + ring.size()) {
+        // The sender is far ahead of playout: drop the oldest audio to get back to the target depth.
+        uint64_t keep = std::min<uint64_t>(ring.size(), depth + block_frames);
+        uint64_t next_read = pos + frames > keep ? pos + frames - keep : 0;
+        skipped += next_read - read_pos;
+        read_pos = next_read;
+    }
+
+    const uint64_t size = ring.size();
+    if (pos > write_pos) {
+        // A gap (lost or not yet arrived): silence unless it is filled in time.
+        lost += pos - write_pos;
+        for (uint64_t p = std::max(write_pos, read_pos); p < pos; p++) {
+            ring[p % size] = 0.0f;
+        }
+    }
+    for (size_t i = 0; i < frames; i++) {
+        ring[(pos + i) % size] = samples[i];
+    }
+    write_pos = std::max(write_pos, pos + frames);
+
+    lock.unlock();
+    data_ready.notify_one();
+}
+
+void PcmInput::receive_step() {
+    if (ended) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(RECEIVE_WAIT_MS));
+        return;
+    }
+
+    struct pollfd p;
+    p.fd = fd;
+    p.events = POLLIN;
+    p.revents = 0;
+    if (poll(&p, 1, RECEIVE_WAIT_MS) <= 0) {
+        return;
+    }
+
+    if (mode == PCM_PIPE) {
+        // Read at most a block so backpressure can always make progress.
+        size_t want = std::min(rx.size(), block_frames * frame_bytes) - rx_pending;
+        ssize_t n = read(fd, rx.data() + rx_pending, want);
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+            return;
+        }
+        if (n <= 0) {
+            if (n == 0 && is_fifo) {
+                // The writer went away; reopen and wait for the next one.
+                close(fd);
+                fd = open(path.c_str(), O_RDONLY | O_NONBLOCK);
+                rx_pending = 0;
+                if (fd >= 0) {
+                    return;
+                }
+            }
+            ended = true;
+            data_ready.notify_one();
+            return;
+        }
+
+        size_t bytes = rx_pending + static_cast<size_t>(n);
+        size_t frames = convert(rx.data(), bytes / frame_bytes);
+        rx_pending = bytes - frames * frame_bytes;
+        std::memmove(rx.data(), rx.data() + frames * frame_bytes, rx_pending);
+
+        uint64_t pos = write_pos;  // Only this thread advances write_pos
+        write_samples(pos, mono.data(), frames, true);
+        return;
+    }
+
+    ssize_t n = recv(fd, rx.data(), rx.size(), 0);
+    if (n <= 0) {
+        return;
+    }
+    const uint8_t *payload = rx.data();
+    size_t size = static_cast<size_t>(n);
+    uint64_t pos = write_pos;
+
+    if (mode == PCM_RTP) {
+        // RFC 3550 fixed header, CSRCs, optional extension and padding.
+        if (size < 12 || (payload[0] >> 6) != 2) {
+            return;
+        }
+        size_t offset = 12 + 4 * (payload[0] & 0x0f);
+        if (payload[0] & 0x10) {
+            if (size < offset + 4) {
+                return;
+            }
+            offset += 4 + 4 * ((payload[offset + 2] << 8) | payload[offset + 3]);
+        }
+        if (payload[0] & 0x20) {
+            size -= std::min<size_t>(size, payload[size - 1]);
+        }
+        if (offset > size) {
+            return;
+        }
+        uint32_t ts = (static_cast<uint32_t>(payload[4]) << 24) | (payload[5] << 16) | (payload[6] << 8) | payload[7];
+
+        // Place the packet relative to the last one; a jump larger than the
+        // buffer (sender restarted) re-anchors the stream at the write position.
+        int64_t delta = static_cast<int32_t>(ts - rtp_last_ts);
+        if (rtp_synced && std::abs(delta) < static_cast<int64_t>(ring.size()) &&
+            static_cast<int64_t>(rtp_last_pos) + delta >= 0) {
+            pos = rtp_last_pos + delta;
+        }
+        rtp_synced = true;
+        rtp_last_ts = ts;
+        rtp_last_pos = pos;
+
+        payload += offset;
+        size -= offset;
+    }
+
+    size_t frames = convert(payload, size / frame_bytes);
+    write_samples(pos, mono.data(), frames, false);
+}
+
+void PcmInput::playout_step() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // Until primed, wait for the full jitter depth plus the block about to play.
+    // At the end of a pipe whatever is left plays without waiting for depth.
+    uint64_t available = write_pos > read_pos ? write_pos - read_pos : 0;
+    if (available < (primed || ended ? block_frames : depth + block_frames)) {
+        if (primed && depth > 0 && !ended) {
+            underruns++;
+        }
+        if (depth > 0) {
+            primed = false;
+        }
+        data_ready.wait_for(lock, std::chrono::milliseconds(PLAYOUT_WAIT_MS));
+        return;
+    }
+    if (!primed) {
+        primed = true;
+        next_block = clock::now();
+        drift_blocks = 0;
+        drift_min_fill = available;
+    }
+
+    if (depth > 0) {
+        drift_min_fill = std::min(drift_min_fill, available);
+        if (++drift_blocks >= sample_rate * DRIFT_WINDOW_MS / 1000.0 / block_frames) {
+            if (drift_min_fill >= depth + 2 * block_frames) {
+                // The buffer never drained to its target: the sender's clock runs
+                // faster than ours. Drop the surplus to hold the latency.
+                uint64_t surplus = (drift_min_fill - depth - block_frames) / block_frames * block_frames;
+                read_pos += surplus;
+                skipped += surplus;
+            }
+            drift_blocks = 0;
+            drift_min_fill = available;
+        }
+    }
+
+    const uint64_t pos = read_pos;
+    const uint64_t size = ring.size();
+    for (unsigned int i = 0; i < block_frames; i++) {
+        block[i] = ring[(pos + i) % size];
+    }
+    read_pos += block_frames;
+    lock.unlock();
+    space_ready.notify_one();
+
+    sink(block.data(), block_frames, static_cast<double>(pos) / sample_rate);
+
+    if (depth > 0) {
+        // Play out at the sample rate; a stall resets the clock instead of bursting.
+        const clock::duration period = std::chrono::duration_cast<clock::duration>(
+            std::chrono::duration<double>(block_frames / sample_rate));
+        next_block += period;
+        clock::time_point now = clock::now();
+        if (now > next_block + period) {
+            next_block = now;
+        }
+        std::this_thread::sleep_until(next_block);
+    }
+}
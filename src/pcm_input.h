@@ -0,0 +1,162 @@
+#ifndef _PCM_INPUT_H_
+#define _PCM_INPUT_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "stage.h"
+
+enum PcmInputMode {
+    PCM_PIPE,   // Byte stream: stdin, a file or a FIFO
+    PCM_UDP,    // One datagram = whole frames of raw PCM, in order
+    PCM_RTP     // RTP packets (RFC 3550); the timestamp places each packet
+};
+
+enum PcmFormat {
+    PCM_S16,    // Signed 16-bit little-endian
+    PCM_S16BE,  // Signed 16-bit big-endian (RTP L16)
+    PCM_S24BE,  // Signed 24-bit big-endian (RTP L24, AES67)
+    PCM_F32     // 32-bit float little-endian
+};
+
+// Receives blocks for the analysis path, like the RtAudio callback does.
+typedef std::function<void(const float *samples, unsigned int frames, double stream_time)> PcmSink;
+
+/**
+ * @class PcmInput
+ * @brief Audio source reading interleaved PCM from a pipe or the network.
+ *
+ * A receive thread converts whatever arrives to mono and writes it into a
+ * jitter buffer at its sample position: the running sample count for pipes
+ * and UDP, the RTP timestamp for RTP, so reordered packets land in place and
+ * lost ones play as silence. A playout thread waits until jitter_ms of audio
+ * is buffered, then hands buffer_frames blocks to the sink at the sample
+ * rate, timestamped with their position in the stream. If the buffer runs
+ * dry it re-fills to the full depth before playing again; if it stays above
+ * depth for seconds (the sender's clock is faster) a block is skipped to
+ * keep latency bounded.
+ *
+ * With jitter_ms = 0 blocks are passed on as soon as they are complete,
+ * which adds no latency and suits paced pipes such as arecord.
+ */
+class PcmInput {
+public:
+    struct Stats {
+        uint64_t underruns;     // Times the buffer ran dry and had to re-fill
+        uint64_t late;          // Packets that arrived after their audio was played
+        uint64_t lost;          // Samples skipped over in the stream, played as silence unless filled in time
+        uint64_t skipped;       // Samples dropped to keep latency bounded
+        double buffered_ms;     // Audio waiting in the jitter buffer now
+    };
+
+    /**
+     * @brief Constructor that opens the input the config asks for.
+     * @param config input, input_path, input_host, input_port, input_format,
+     *               input_channels, jitter_ms, sample_rate and buffer_frames.
+     * @param sink Called from the playout thread with every block.
+     * @throws std::runtime_error if the input cannot be opened.
+     */
+    PcmInput(const Config &config, PcmSink sink);
+
+    /**
+     * @brief Destructor that stops both threads and closes the input.
+     */
+    ~PcmInput();
+
+    /**
+     * @brief Starts the receive and playout threads.
+     * @param playout_init Runs on the playout thread first (e.g. realtime setup).
+     */
+    void start(std::function<void()> playout_init = std::function<void()>());
+
+    /**
+     * @brief Stops both threads and waits for them to exit.
+     */
+    void stop();
+
+    /**
+     * @brief True once a pipe or file reached its end and everything was played.
+     */
+    bool finished() const;
+
+    /**
+     * @brief Returns and resets the counters.
+     */
+    Stats take_stats();
+
+    /**
+     * @brief Human-readable description of the source, e.g. "udp 0.0.0.0:5004".
+     */
+    const std::string &description() const { return name; }
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    PcmInputMode mode;
+    PcmFormat format;
+    int channels;
+    size_t frame_bytes;             // Bytes per interleaved frame
+    double sample_rate;
+    unsigned int block_frames;      // Samples per block handed to the sink
+    uint64_t depth;                 // Samples buffered before playout starts
+    PcmSink sink;
+    std::string name;
+    std::string path;
+    bool is_fifo;
+    int fd;
+
+    // Jitter buffer, indexed by absolute sample position modulo its size
+    mutable std::mutex mutex;
+    std::condition_variable data_ready;
+    std::condition_variable space_ready;
+    std::vector<float> ring;
+    uint64_t read_pos;              // Next sample to play
+    uint64_t write_pos;             // One past the furthest sample received
+    bool primed;                    // Playout is running (buffer reached depth)
+    std::atomic<bool> running;
+    std::atomic<bool> ended;        // The pipe reached end of file
+
+    // Receive thread state
+    std::vector<uint8_t> rx;
+    size_t rx_pending;              // Bytes of an incomplete frame kept from the last read
+    std::vector<float> mono;
+    bool rtp_synced;
+    uint32_t rtp_last_ts;
+    uint64_t rtp_last_pos;
+
+    // Playout thread state
+    std::vector<float> block;
+    clock::time_point next_block;
+    unsigned int drift_blocks;      // Blocks played in the current drift window
+    uint64_t drift_min_fill;        // Lowest fill seen in the window
+
+    std::atomic<uint64_t> underruns;
+    std::atomic<uint64_t> late;
+    std::atomic<uint64_t> lost;
+    std::atomic<uint64_t> skipped;
+
+    StageThread receiver;
+    StageThread playout;
+
+    void open_pipe();
+    void open_socket(const std::string &host, int port);
+    void receive_step();
+    void playout_step();
+    size_t convert(const uint8_t *data, size_t frames);
+    void write_samples(uint64_t pos, const float *samples, size_t frames, bool wait);
+};
+
+/**
+ * @brief Parses a PCM format name (s16, s16be, s24be or f32).
+ * @throws std::runtime_error if the name is unknown.
+ */
+PcmFormat pcm_format_from_name(const std::string &name);
+
+#endif // _PCM_INPUT_H_
@@ -0,0 +1,548 @@
+#include "pipeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "async_log.h"
+#include "realtime.h"
+
+// Buffers in flight per link. Capture needs the most slack: the FFT stage must
+// see every block to keep its history contiguous.
+#define CAPTURE_BUFFERS  8
+#define SPECTRUM_BUFFERS 3
+#define NOTE_BUFFERS     4
+#define PIXEL_BUFFERS    3
+#define WIRE_BUFFERS      3
+
+static_assert(SHM_FEED_MAX_BINS >= MAX_FFT_SIZE / 2 + 1, "Feed frames must hold the largest spectrum");
+
+// How long an idle stage waits on its input before re-checking for stop().
+#define STAGE_WAIT_MS 100
+
+/**
+ * @brief The ColourMode for a colour_mode option value ("notes", "chord" or "key").
+ */
+ColourMode colour_mode_from_name(const std::string &name) {
+    if (name == "chord") return COLOUR_CHORD;
+    if (name == "key")   return COLOUR_KEY;
+    return COLOUR_NOTES;
+}
+
+/**
+ * @brief Constructor that preallocates every buffer of every stage.
+ * @param config Settings the stages are sized from.
+ * @param strip The LED output (SPI strip or network) to encode for and write to.
+ * @param analyzer Initial analyzer used by the FFT stage.
+ * @param layout Physical layout of the LEDs, or nullptr for twelve runs along the strip.
+ */
+Pipeline::Pipeline(const Config &config, LedOutput &strip, std::shared_ptr<Analyzer> analyzer,
+                   const LedLayout *layout)
+    : config(config), strip(strip), analyzer(analyzer), analyzer_generation(2),
+      capture_link(CAPTURE_BUFFERS, DROP_NEWEST, [&config](AudioBlock &b) {
+          b.samples.resize(config.buffer_frames);
+      }),
+      spectrum_link(SPECTRUM_BUFFERS, KEEP_LATEST, [](SpectrumFrame &f) {
+          f.magnitudes.resize(MAX_FFT_SIZE / 2 + 1);
+      }),
+      notes_link(NOTE_BUFFERS, KEEP_LATEST, [](NoteFrame &f) { f.num_events = 0; }),
+      pixel_link(PIXEL_BUFFERS, KEEP_LATEST, [&config](PixelFrame &f) {
+          f.pixels.resize(config.num_leds);
+      }),
+      wire_link(WIRE_BUFFERS, KEEP_LATEST, [&strip](WireFrame &f) {
+          f.bytes.resize(strip.encoded_size());
+      }),
+      led_renderer(config.num_leds, config.led_fps, strip.max_frame_rate(),
+                   config.led_attack_ms, config.led_decay_ms, notes_link, pixel_link, layout),
+      fft_thread("fft", [this]() { fft_step(); }),
+      feature_thread("features", [this]() { feature_step(); }),
+      encode_thread("encode", [this]() { encode_step(); }),
+      output_thread("output", [this]() { output_step(); }),
+      hires_thread("hires", [this]() { hires_step(); }),
+      capture_seq(0), rt_events(std::cerr), decimator(config.decimation, config.buffer_frames),
+      history(std::max<size_t>(MAX_FFT_SIZE, 2 * static_cast<size_t>(config.hires_fft_size)),
+              decimator.max_output(config.buffer_frames)),
+      rhythm(static_cast<double>(config.buffer_frames) / config.sample_rate), feed_generation(0),
+      trace_notes(config.trace_notes), tracker(config.note_release_ms, config.min_magnitude),
+      note_release_ms(config.note_release_ms), note_min_magnitude(config.min_magnitude), pending_events(0),
+      colour_mode(colour_mode_from_name(config.colour_mode)), spectrum_log_generation(0),
+      hires_hop(0), hires_next(0),
+      fft_frames(0), worst_fft_us(0), led_frames(0) {
+    led_renderer.set_beat_pulse(config.led_beat_pulse);
+
+    if (!config.shm_feed.empty()) {
+        feed.reset(new ShmFeedWriter(config.shm_feed));
+        feed_bin_frequency.resize(SHM_FEED_MAX_BINS);
+    }
+    if (!config.spectrum_log_path.empty()) {
+        spectrum_log.reset(new SpectrumRecorder(config.spectrum_log_path, config.spectrum_log_bits,
+                                                MAX_FFT_SIZE / 2 + 1, config.min_magnitude));
+    }
+    if (config.hires_fft_size > 0) {
+        // Planned here, on the main thread: the FFTW planner is not thread-safe.
+        // The threshold scales with the window like the FFT magnitudes do.
+        const double rate = static_cast<double>(config.sample_rate) / config.decimation;
+        hires.reset(new HiresAnalyzer(config.hires_fft_size, rate, config.min_freq,
+                                      config.min_magnitude * config.hires_fft_size / config.fft_size,
+                                      config.window, config.kaiser_beta, config.hires_threads));
+        hires_hop = std::max<uint64_t>(1, static_cast<uint64_t>(config.hires_hop_ms / 1000.0 * rate));
+        hires_next = config.hires_fft_size;
+    }
+    if (!config.record_path.empty()) {
+        recorder.reset(new FrameRecorder(config.record_path, config.num_leds, led_renderer.frame_rate()));
+    }
+}
+
+Pipeline::~Pipeline() {
+    stop();
+}
+
+/**
+ * @brief Starts every stage thread (applying realtime settings if configured).
+ */
+void Pipeline::start() {
+    std::function<void()> analysis_init;
+    std::function<void()> led_init;
+
+    if (config.realtime) {
+        const Config &c = config;
+        analysis_init = [c]() {
+            realtime_prefault_stack();
+            std::string error;
+            if (!realtime_configure_thread(pthread_self(), c.analysis_cpu, c.analysis_priority, error)) {
+                std::cerr << "Realtime: analysis thread: " << error << std::endl;
+            }
+        };
+        led_init = [c]() {
+            realtime_prefault_stack();
+            std::string error;
+            if (!realtime_configure_thread(pthread_self(), c.led_cpu, c.led_priority, error)) {
+                std::cerr << "Realtime: LED thread: " << error << std::endl;
+            }
+        };
+        led_renderer.set_thread_init(led_init);
+    }
+
+    rt_events.start();
+    if (recorder) {
+        // The writer only does file I/O; it stays at normal priority on any CPU.
+        recorder->start();
+    }
+    if (spectrum_log) {
+        spectrum_log->start();
+    }
+    output_thread.start(led_init);
+    encode_thread.start(led_init);
+    led_renderer.start();
+    // The feature stage logs note changes; create its log queue before the loop.
+    feature_thread.start([analysis_init]() {
+        app_log().attach_thread("features");
+        if (analysis_init) {
+            analysis_init();
+        }
+    });
+    fft_thread.start(analysis_init);
+
+    if (hires) {
+        // Normal priority on its own CPUs; FFTW's worker threads inherit the mask.
+        for (int cpu : config.hires_cpus) {
+            if (config.realtime && (cpu == config.analysis_cpu || cpu == config.led_cpu)) {
+                std::cerr << "Warning: hires_cpus includes CPU " << cpu
+                          << ", which the analysis or LED thread is pinned to." << std::endl;
+            }
+        }
+        const std::vector<int> cpus = config.hires_cpus;
+        hires_thread.start([cpus]() {
+            app_log().attach_thread("hires");
+            std::string error;
+            if (!realtime_set_cpus(pthread_self(), cpus, error)) {
+                std::cerr << "High-resolution thread: " << error << std::endl;
+            }
+        });
+    }
+}
+
+/**
+ * @brief Stops every stage thread, downstream first.
+ */
+void Pipeline::stop() {
+    hires_thread.stop();
+    fft_thread.stop();
+    feature_thread.stop();
+    led_renderer.stop();
+    encode_thread.stop();
+    output_thread.stop();
+    if (recorder) {
+        recorder->stop();
+    }
+    if (spectrum_log) {
+        spectrum_log->stop();
+    }
+    rt_events.stop();
+}
+
+/**
+ * @brief Capture stage: queues samples for the FFT stage. Called from the audio callback.
+ */
+void Pipeline::push_audio(const float *input, unsigned int frames, double stream_time) {
+    push_blocks(input, frames, stream_time);
+}
+
+/**
+ * @brief Capture stage for streams opened as RTAUDIO_SINT16; samples are scaled to [-1, 1).
+ */
+void Pipeline::push_audio(const int16_t *input, unsigned int frames, double stream_time) {
+    push_blocks(input, frames, stream_time);
+}
+
+static inline float to_sample(float s) { return s; }
+static inline float to_sample(int16_t s) { return s * (1.0f / 32768.0f); }
+
+// Shared by both capture formats; the conversion happens during the block copy.
+template <typename T>
+void Pipeline::push_blocks(const T *input, unsigned int frames, double stream_time) {
+    const unsigned int capacity = static_cast<unsigned int>(config.buffer_frames);
+
+    // RtAudio may deliver more than we asked for; split into pool-sized blocks.
+    for (unsigned int offset = 0; offset < frames; offset += capacity) {
+        AudioBlock *block = capture_link.acquire();
+        if (!block) {
+            rt_events.record(RT_EVENT_CAPTURE_OVERRUN, frames - offset,
+                             stream_time + static_cast<double>(offset) / config.sample_rate);
+            return;
+        }
+        block->seq = capture_seq++;
+        block->stream_time = stream_time + static_cast<double>(offset) / config.sample_rate;
+        block->frames = std::min(capacity, frames - offset);
+        float *samples = block->samples.data();
+        for (unsigned int i = 0; i < block->frames; i++) {
+            samples[i] = to_sample(input[offset + i]);
+        }
+        capture_link.send(block);
+    }
+}
+
+/**
+ * @brief Replaces the analyzer used by the FFT stage. Safe to call while running,
+ * from one thread at a time.
+ * @return The previous analyzer.
+ */
+std::shared_ptr<Analyzer> Pipeline::set_analyzer(std::shared_ptr<Analyzer> next) {
+    // Odd during the swap, so the FFT stage never pairs an analyzer with the wrong generation.
+    analyzer_generation++;
+    std::shared_ptr<Analyzer> previous = std::atomic_exchange(&analyzer, next);
+    analyzer_generation++;
+    return previous;
+}
+
+/**
+ * @brief Sets the block size the audio device actually delivers, which it may
+ * choose differently from buffer_frames. Call before start().
+ */
+void Pipeline::set_block_frames(unsigned int frames) {
+    // One spectrum per pool block; push_blocks() splits larger deliveries.
+    const unsigned int capacity = static_cast<unsigned int>(config.buffer_frames);
+    const unsigned int blocks = (frames + capacity - 1) / capacity;
+    rhythm = RhythmTracker(static_cast<double>(frames) / blocks / config.sample_rate);
+}
+
+/**
+ * @brief Touches every pooled buffer so it is resident before streaming starts.
+ */
+void Pipeline::prefault() {
+    if (feed) {
+        feed->prefault();
+        realtime_prefault(feed_bin_frequency.data(), feed_bin_frequency.size() * sizeof(float));
+    }
+    if (recorder) {
+        recorder->prefault();
+    }
+    if (spectrum_log) {
+        spectrum_log->prefault();
+    }
+    history.prefault();
+    capture_link.for_each([](AudioBlock &b) {
+        realtime_prefault(b.samples.data(), b.samples.size() * sizeof(float));
+    });
+    spectrum_link.for_each([](SpectrumFrame &f) {
+        realtime_prefault(f.magnitudes.data(), f.magnitudes.size() * sizeof(double));
+    });
+    pixel_link.for_each([](PixelFrame &f) {
+        realtime_prefault(f.pixels.data(), f.pixels.size() * sizeof(Pixel));
+    });
+    wire_link.for_each([](WireFrame &f) {
+        realtime_prefault(f.bytes.data(), f.bytes.size());
+    });
+}
+
+/**
+ * @brief Returns and resets the per-interval counters.
+ */
+Pipeline::Stats Pipeline::take_stats() {
+    Stats stats;
+    stats.fft_frames = fft_frames.exchange(0);
+    stats.worst_fft_us = worst_fft_us.exchange(0);
+    stats.led_frames = led_frames.exchange(0);
+    stats.dropped = capture_link.dropped_count() + spectrum_link.dropped_count() +
+                    notes_link.dropped_count() + pixel_link.dropped_count() + wire_link.dropped_count() +
+                    (recorder ? recorder->dropped_count() : 0) +
+                    (spectrum_log ? spectrum_log->dropped_count() : 0);
+    return stats;
+}
+
+void Pipeline::fft_step() {
+    AudioBlock *block = capture_link.receive(STAGE_WAIT_MS);
+    if (!block) {
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Decimate every pending block into the history (the filter needs them all);
+    // only the newest window is analysed.
+    uint64_t seq = 0;
+    double stream_time = 0;
+    do {
+        history.commit(decimator.process(block->samples.data(), static_cast<int>(block->frames),
+                                         history.write_pointer()));
+        seq = block->seq;
+        stream_time = block->stream_time;
+        capture_link.release(block);
+    } while ((block = capture_link.try_receive()) != nullptr);
+
+    SpectrumFrame *frame = spectrum_link.acquire();
+    if (!frame) {
+        return;
+    }
+
+    // Retried only if set_analyzer() runs meanwhile (see there).
+    uint64_t generation;
+    std::shared_ptr<Analyzer> current;
+    do {
+        generation = analyzer_generation.load();
+        current = std::atomic_load(&analyzer);
+    } while ((generation & 1) || analyzer_generation.load() != generation);
+    size_t n = current->fft_size();
+
+    // The analyzer windows the newest n samples straight out of the history ring
+    current->load_samples(history.newest(n));
+    frame->peak_bin = current->calculate_magnitudes(frame->magnitudes.data());
+    frame->num_bins = current->num_bins();
+    frame->seq = seq;
+    frame->stream_time = stream_time;
+    frame->analyzer = current;
+    frame->analyzer_generation = generation;
+    spectrum_link.send(frame);
+
+    uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    fft_frames++;
+    uint64_t worst = worst_fft_us;
+    while (us > worst && !worst_fft_us.compare_exchange_weak(worst, us)) {
+    }
+}
+
+void Pipeline::feature_step() {
+    SpectrumFrame *spectrum = spectrum_link.receive(STAGE_WAIT_MS);
+    if (!spectrum) {
+        return;
+    }
+
+    // Rhythm follows every spectrum, even if the renderer is not keeping up.
+    rhythm.update(spectrum->magnitudes.data(), spectrum->analyzer->first_live_bin(),
+                  spectrum->num_bins, spectrum->seq);
+
+    float levels[NUM_NOTES];
+    double note_magnitudes[NUM_NOTES];
+    spectrum->analyzer->detect_notes(spectrum->magnitudes.data(), levels, note_magnitudes);
+
+    // Tracked notes stay lit through frames where they dip below the threshold.
+    tracker.configure(note_release_ms.load(std::memory_order_relaxed),
+                      note_min_magnitude.load(std::memory_order_relaxed));
+    NoteEvent *events = pending + pending_events;
+    int num_events = tracker.update(spectrum->magnitudes.data(), spectrum->num_bins, *spectrum->analyzer,
+                                    spectrum->stream_time, events, MAX_NOTE_EVENTS - pending_events);
+    pending_events += num_events;
+    float held[NUM_NOTES];
+    tracker.pitch_levels(held);
+    for (int i = 0; i < NUM_NOTES; i++) {
+        levels[i] = std::max(levels[i], held[i]);
+    }
+
+    // Chord and key follow the detected notes, whatever lights the LEDs.
+    const int last_chord = harmony.chord();
+    const int last_key = harmony.key();
+    harmony.update(note_magnitudes, spectrum->stream_time);
+    const int mode = colour_mode.load(std::memory_order_relaxed);
+    if (mode == COLOUR_CHORD) {
+        harmony.chord_levels(levels);
+    } else if (mode == COLOUR_KEY) {
+        harmony.key_levels(levels);
+    }
+
+    if (trace_notes.load(std::memory_order_relaxed)) {
+        if (harmony.chord() != last_chord || harmony.key() != last_key) {
+            app_log().log(LOG_HARMONY, harmony_name(harmony.chord()), harmony_name(harmony.key()));
+        }
+        for (int i = 0; i < num_events; i++) {
+            const NoteEvent &e = events[i];
+            if (e.type == NOTE_ON) {
+                app_log().log(LOG_NOTE_ON, note_name(e.midi), e.midi / NUM_NOTES - 1, e.id, e.frequency);
+            } else {
+                app_log().log(LOG_NOTE_OFF, note_name(e.midi), e.midi / NUM_NOTES - 1, e.id, e.duration);
+            }
+        }
+    }
+
+    if (feed) {
+        publish_feed(*spectrum, levels, note_magnitudes);
+    }
+    if (spectrum_log) {
+        record_spectrum(*spectrum, events, num_events);
+    }
+
+    NoteFrame *notes = notes_link.acquire();
+    if (notes) {
+        std::copy(levels, levels + NUM_NOTES, notes->levels);
+        std::copy(note_magnitudes, note_magnitudes + NUM_NOTES, notes->magnitudes);
+        notes->onset_strength = rhythm.onset_strength();
+        notes->onset = rhythm.is_onset();
+        notes->bpm = rhythm.bpm();
+        notes->beat_phase = rhythm.beat_phase();
+        notes->beat_confidence = rhythm.confidence();
+        // Events wait for the next frame if this one could not be sent.
+        std::copy(pending, pending + pending_events, notes->events);
+        notes->num_events = pending_events;
+        pending_events = 0;
+        notes->chord = harmony.chord();
+        notes->key = harmony.key();
+        notes->chord_confidence = harmony.chord_confidence();
+        notes->seq = spectrum->seq;
+        notes->stream_time = spectrum->stream_time;
+        notes->time = std::chrono::steady_clock::now();
+        notes_link.send(notes);
+    }
+
+    // Don't keep a swapped-out analyzer alive from the pool.
+    spectrum->analyzer.reset();
+    spectrum_link.release(spectrum);
+}
+
+// Writes the frame straight into the shared-memory feed for other processes.
+void Pipeline::publish_feed(const SpectrumFrame &spectrum, const float levels[NUM_NOTES],
+                            const double note_magnitudes[NUM_NOTES]) {
+    if (spectrum.analyzer_generation != feed_generation) {
+        // New analyzer: readers need its bin frequencies before its first frame.
+        for (int i = 0; i < spectrum.num_bins; i++) {
+            feed_bin_frequency[i] = static_cast<float>(spectrum.analyzer->bin_frequency(i));
+        }
+        feed->set_layout(feed_bin_frequency.data(), spectrum.num_bins);
+        feed_generation = spectrum.analyzer_generation;
+    }
+
+    ShmFeedFrame *frame = feed->begin_frame();
+    frame->capture_seq = spectrum.seq;
+    frame->stream_time = spectrum.stream_time;
+    for (int i = 0; i < NUM_NOTES; i++) {
+        frame->levels[i] = levels[i];
+        frame->chroma[i] = static_cast<float>(note_magnitudes[i]);
+    }
+    frame->onset_strength = rhythm.onset_strength();
+    frame->bpm = rhythm.bpm();
+    frame->beat_phase = rhythm.beat_phase();
+    frame->onset = rhythm.is_onset() ? 1 : 0;
+    frame->peak_bin = spectrum.peak_bin;
+    frame->num_bins = static_cast<uint32_t>(spectrum.num_bins);
+    for (int i = 0; i < spectrum.num_bins; i++) {
+        frame->magnitudes[i] = static_cast<float>(spectrum.magnitudes[i]);
+    }
+    feed->end_frame(frame);
+}
+
+void Pipeline::hires_step() {
+    const uint64_t written = history.written();
+    if (written < hires_next) {
+        // Sleep until roughly when the next frame is due, re-checking for stop().
+        const double rate = static_cast<double>(config.sample_rate) / config.decimation;
+        const double wait_ms = (hires_next - written) * 1000.0 / rate;
+        std::this_thread::sleep_for(std::chrono::milliseconds(
+            std::max(1, std::min(STAGE_WAIT_MS, static_cast<int>(wait_ms)))));
+        return;
+    }
+    // If the stage fell behind, analyse the newest window and skip the rest,
+    // keeping a full hop to the next one.
+    hires_next = std::max(hires_next + hires_hop, written + hires_hop);
+
+    if (!hires->load_samples(history)) {
+        return;
+    }
+    HiresPeak peaks[HIRES_MAX_PEAKS];
+    int count = hires->analyse(peaks, HIRES_MAX_PEAKS);
+    for (int i = 0; i < count; i++) {
+        app_log().log(LOG_HIRES_PEAK, note_name(peaks[i].midi), peaks[i].midi / NUM_NOTES - 1,
+                      peaks[i].frequency, peaks[i].cents, peaks[i].magnitude);
+    }
+}
+
+// Queues the frame for the spectrum log's writer thread.
+void Pipeline::record_spectrum(const SpectrumFrame &spectrum, const NoteEvent *events, int num_events) {
+    SpectrumRecord *record = spectrum_log->begin_record();
+    if (!record) {
+        return;
+    }
+    record->new_layout = spectrum.analyzer_generation != spectrum_log_generation;
+    if (record->new_layout) {
+        for (int i = 0; i < spectrum.num_bins; i++) {
+            record->bin_frequency[i] = static_cast<float>(spectrum.analyzer->bin_frequency(i));
+        }
+        spectrum_log_generation = spectrum.analyzer_generation;
+    }
+    record->seq = spectrum.seq;
+    record->stream_time = spectrum.stream_time;
+    record->num_bins = spectrum.num_bins;
+    for (int i = 0; i < spectrum.num_bins; i++) {
+        record->magnitudes[i] = static_cast<float>(spectrum.magnitudes[i]);
+    }
+    record->bpm = rhythm.bpm();
+    record->beat_phase = rhythm.beat_phase();
+    record->onset = rhythm.is_onset();
+    record->chord = harmony.chord();
+    record->key = harmony.key();
+    record->num_events = num_events;
+    std::copy(events, events + num_events, record->events);
+    spectrum_log->end_record(record);
+}
+
+void Pipeline::encode_step() {
+    PixelFrame *pixels = pixel_link.receive(STAGE_WAIT_MS);
+    if (!pixels) {
+        return;
+    }
+
+    WireFrame *wire = wire_link.acquire();
+    if (wire) {
+        strip.encode(pixels->pixels.data(), wire->bytes.data());
+        wire->seq = pixels->seq;
+        wire_link.send(wire);
+        if (recorder) {
+            recorder->record(*pixels);
+        }
+    }
+    pixel_link.release(pixels);
+}
+
+void Pipeline::output_step() {
+    WireFrame *wire = wire_link.receive(STAGE_WAIT_MS);
+    if (!wire) {
+        return;
+    }
+
+    try {
+        strip.write_encoded(wire->bytes.data(), wire->bytes.size());
+        led_frames++;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+    }
+    wire_link.release(wire);
+}
@@ -0,0 +1,219 @@
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "analyzer.h"
+#include "capture_ring.h"
+#include "config.h"
+#include "decimator.h"
+#include "frame_recorder.h"
+#include "frames.h"
+#include "harmony.h"
+#include "hires_analyzer.h"
+#include "led_renderer.h"
+#include "partial_tracker.h"
+#include "led_output.h"
+#include "rhythm.h"
+#include "rt_events.h"
+#include "shm_feed.h"
+#include "spectrum_recorder.h"
+#include "stage.h"
+
+// What the feature stage lights each pitch class by.
+enum ColourMode {
+    COLOUR_NOTES,   // Detected and tracked notes
+    COLOUR_CHORD,   // Tones of the current chord
+    COLOUR_KEY      // Scale of the current key
+};
+
+/**
+ * @brief The ColourMode for a colour_mode option value ("notes", "chord" or "key").
+ */
+ColourMode colour_mode_from_name(const std::string &name);
+
+/**
+ * @class Pipeline
+ * @brief The processing graph from captured audio to bytes on the wire.
+ *
+ *   capture (audio callback) -> decimation + FFT -> features (notes, rhythm)
+ *   -> colour mapping (LedRenderer) -> encode -> output
+ *
+ * The FFT stage decimates straight into a mirrored CaptureRing and the
+ * analyzer windows its input straight out of it. With hires_fft_size set, a
+ * separate high-resolution stage reads the same ring at its own hop, on its
+ * own CPUs, so the large transform never delays the LED path.
+ *
+ * Every stage runs on its own thread and hands pooled buffers to the next one
+ * through a bounded lock-free StageLink, so a slow stage only makes its
+ * consumers skip frames instead of stalling the others.
+ */
+class Pipeline {
+public:
+    /**
+     * @brief Per-second counters reported by the main loop.
+     */
+    struct Stats {
+        uint64_t fft_frames;     // Spectra computed since the last call
+        uint64_t worst_fft_us;   // Slowest FFT step since the last call
+        uint64_t led_frames;     // Frames sent to the LEDs since the last call
+        uint64_t dropped;        // Buffers dropped on any link since start
+    };
+
+    /**
+     * @brief Constructor that preallocates every buffer of every stage.
+     * @param config Settings the stages are sized from.
+     * @param strip The LED output (SPI strip or network) to encode for and write to.
+     * @param analyzer Initial analyzer used by the FFT stage.
+     * @param layout Physical layout of the LEDs, or nullptr for twelve runs along the strip.
+     */
+    Pipeline(const Config &config, LedOutput &strip, std::shared_ptr<Analyzer> analyzer,
+             const LedLayout *layout = nullptr);
+    ~Pipeline();
+
+    /**
+     * @brief Starts every stage thread (applying realtime settings if configured).
+     */
+    void start();
+
+    /**
+     * @brief Stops every stage thread, downstream first.
+     */
+    void stop();
+
+    /**
+     * @brief Capture stage: queues samples for the FFT stage. Called from the audio callback.
+     *
+     * Never blocks or allocates; if the FFT stage is behind the block is dropped.
+     */
+    void push_audio(const float *input, unsigned int frames, double stream_time);
+
+    /**
+     * @brief Capture stage for streams opened as RTAUDIO_SINT16; samples are scaled to [-1, 1).
+     */
+    void push_audio(const int16_t *input, unsigned int frames, double stream_time);
+
+    /**
+     * @brief Replaces the analyzer used by the FFT stage. Safe to call while running,
+     * from one thread at a time.
+     * @return The previous analyzer.
+     */
+    std::shared_ptr<Analyzer> set_analyzer(std::shared_ptr<Analyzer> next);
+
+    /**
+     * @brief Sets the block size the audio device actually delivers, which it may
+     * choose differently from buffer_frames. Call before start().
+     */
+    void set_block_frames(unsigned int frames);
+
+    /**
+     * @brief Turns logging of note changes on or off. Safe to call while running.
+     */
+    void set_trace_notes(bool on) { trace_notes = on; }
+
+    /**
+     * @brief Changes the note tracker's release time and threshold. Safe to call while running.
+     */
+    void set_note_tracking(float release_ms, double min_magnitude) {
+        note_release_ms = release_ms;
+        note_min_magnitude = min_magnitude;
+    }
+
+    /**
+     * @brief Chooses what lights each pitch class. Safe to call while running.
+     */
+    void set_colour_mode(ColourMode mode) { colour_mode = mode; }
+
+    /**
+     * @brief Touches every pooled buffer so it is resident before streaming starts.
+     */
+    void prefault();
+
+    /**
+     * @brief Returns and resets the per-interval counters.
+     */
+    Stats take_stats();
+
+    /**
+     * @brief The colour mapping stage.
+     */
+    LedRenderer &renderer() { return led_renderer; }
+
+    /**
+     * @brief Diagnostics from the capture side; record() is safe in the audio callback.
+     */
+    RtEventLog &events() { return rt_events; }
+
+private:
+    Config config;
+    LedOutput &strip;
+    std::shared_ptr<Analyzer> analyzer;
+    std::atomic<uint64_t> analyzer_generation; // Even; odd while set_analyzer() swaps
+
+    StageLink<AudioBlock> capture_link;
+    StageLink<SpectrumFrame> spectrum_link;
+    StageLink<NoteFrame> notes_link;
+    StageLink<PixelFrame> pixel_link;
+    StageLink<WireFrame> wire_link;
+
+    LedRenderer led_renderer;
+    StageThread fft_thread;
+    StageThread feature_thread;
+    StageThread encode_thread;
+    StageThread output_thread;
+    StageThread hires_thread;
+
+    // Capture state (audio callback thread)
+    uint64_t capture_seq;
+    RtEventLog rt_events;
+
+    // FFT stage state
+    Decimator decimator;
+    CaptureRing history;          // Decimated samples; with hires on, twice its window so
+                                  // the high-resolution stage's copy is not lapped
+
+    // Feature stage state
+    RhythmTracker rhythm;
+    std::unique_ptr<ShmFeedWriter> feed;     // Null unless shm_feed is set
+    std::vector<float> feed_bin_frequency;
+    uint64_t feed_generation;                // Analyzer generation whose layout the feed has
+    std::atomic<bool> trace_notes;           // Log note events (trace_notes option)
+    PartialTracker tracker;
+    std::atomic<float> note_release_ms;      // Applied to the tracker every frame
+    std::atomic<double> note_min_magnitude;
+    int pending_events;                      // Events not yet handed to the renderer
+    NoteEvent pending[MAX_NOTE_EVENTS];
+    HarmonyEstimator harmony;
+    std::atomic<int> colour_mode;            // ColourMode
+    std::unique_ptr<SpectrumRecorder> spectrum_log; // Null unless spectrum_log_path is set
+    uint64_t spectrum_log_generation;        // Analyzer generation whose layout the log has
+
+    // High-resolution stage state; null unless hires_fft_size is set
+    std::unique_ptr<HiresAnalyzer> hires;
+    uint64_t hires_hop;                      // Samples between high-resolution frames
+    uint64_t hires_next;                     // Ring position of the next frame
+
+    // Encode stage state
+    std::unique_ptr<FrameRecorder> recorder; // Null unless record_path is set
+
+    std::atomic<uint64_t> fft_frames;
+    std::atomic<uint64_t> worst_fft_us;
+    std::atomic<uint64_t> led_frames;
+
+    template <typename T>
+    void push_blocks(const T *input, unsigned int frames, double stream_time);
+    void fft_step();
+    void feature_step();
+    void publish_feed(const SpectrumFrame &spectrum, const float levels[NUM_NOTES],
+                      const double note_magnitudes[NUM_NOTES]);
+    void hires_step();
+    void record_spectrum(const SpectrumFrame &spectrum, const NoteEvent *events, int num_events);
+    void encode_step();
+    void output_step();
+};
+
+#endif // _PIPELINE_H_
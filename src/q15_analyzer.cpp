@@ -0,0 +1,100 @@
+#include "q15_analyzer.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Full scale of a Q15 sample; FFT outputs divided by this match the float path.
+#define Q15_ONE 32768.0
+
+/**
+ * @brief Constructor that builds the FFT tables, the integer window and the bin tables.
+ * @param sample_rate Rate of the analysed samples in Hz (after decimation).
+ * @param min_freq Bins below this frequency (Hz) are ignored.
+ * @param min_magnitude Bins must exceed this magnitude to count as a note.
+ * @param window_type Analysis window applied to every frame.
+ * @param kaiser_beta Shape of the Kaiser window (ignored for the others).
+ */
+template <int FFT_SIZE>
+Q15Analyzer<FFT_SIZE>::Q15Analyzer(double sample_rate, int min_freq, double min_magnitude,
+                                   WindowType window_type, double kaiser_beta)
+    : fft(FFT_SIZE), fft_in(FFT_SIZE), fft_out(2 * BINS), window(FFT_SIZE),
+      bin_hz(sample_rate / FFT_SIZE), min_magnitude(min_magnitude) {
+
+    // Give the window as many bits as fit: sample (16 bits) times window must stay in 31.
+    std::vector<double> w(FFT_SIZE);
+    window_fill(window_type, kaiser_beta, w.data(), FFT_SIZE);
+    double peak = *std::max_element(w.begin(), w.end());
+    window_shift = 0;
+    while (window_shift < 15 && peak * (1 << (window_shift + 1)) < 65535.0) {
+        window_shift++;
+    }
+    for (int i = 0; i < FFT_SIZE; i++) {
+        window[i] = static_cast<int32_t>(std::lround(w[i] * (1 << window_shift)));
+    }
+
+    min_index = std::max(1, static_cast<int>(min_freq * FFT_SIZE / sample_rate));
+    double threshold = min_magnitude * Q15_ONE;
+    min_power = static_cast<int64_t>(std::min(threshold * threshold, 4.0e18));
+
+    for (int i = 0; i < BINS; i++) {
+        double freq = i * bin_hz;
+        bin_note[i] = i > 0 ? static_cast<int8_t>(freq_to_note_index(freq)) : 0;
+    }
+}
+
+template <int FFT_SIZE>
+void Q15Analyzer<FFT_SIZE>::load_samples(const float *samples) {
+    // Quantise to Q15 and window in one pass.
+    const int shift = window_shift;
+    const int32_t round = shift > 0 ? 1 << (shift - 1) : 0;
+    for (int i = 0; i < FFT_SIZE; i++) {
+        int32_t q = static_cast<int32_t>(samples[i] * static_cast<float>(Q15_ONE));
+        q = std::max(-32768, std::min(32767, q));
+        fft_in[i] = (q * window[i] + round) >> shift;
+    }
+}
+
+template <int FFT_SIZE>
+int Q15Analyzer<FFT_SIZE>::calculate_magnitudes(double *magnitudes) {
+
+    fft.forward(fft_in.data(), fft_out.data());
+
+    int64_t max_power = 0;
+    int max_idx = 0;
+    const float scale = static_cast<float>(1.0 / Q15_ONE);
+
+    std::fill(magnitudes, magnitudes + min_index, 0.0);
+    for (int i = min_index; i < BINS; ++i) {
+        const int64_t re = fft_out[2 * i];
+        const int64_t im = fft_out[2 * i + 1];
+        const int64_t power = re * re + im * im;
+        magnitudes[i] = std::sqrt(static_cast<float>(power)) * scale;
+
+        if (power > max_power) {
+            max_power = power;
+            max_idx = i;
+        }
+    }
+
+    if (max_power < min_power) {
+        return 0;
+    }
+
+    return max_idx;
+}
+
+template <int FFT_SIZE>
+int Q15Analyzer<FFT_SIZE>::detect_notes(const double *magnitudes, float levels[NUM_NOTES],
+                                        double note_magnitudes[NUM_NOTES]) const {
+    return detect_pitch_classes(magnitudes, min_index, BINS, bin_note.data(), min_magnitude,
+                                levels, note_magnitudes);
+}
+
+// Same sizes as FixedAnalyzer; make_analyzer() picks between the two.
+template class Q15Analyzer<256>;
+template class Q15Analyzer<512>;
+template class Q15Analyzer<1024>;
+template class Q15Analyzer<2048>;
+template class Q15Analyzer<4096>;
+template class Q15Analyzer<8192>;
+template class Q15Analyzer<16384>;
@@ -0,0 +1,62 @@
+#ifndef _Q15_ANALYZER_H_
+#define _Q15_ANALYZER_H_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "analyzer.h"
+#include "q15_fft.h"
+
+/**
+ * @class Q15Analyzer
+ * @brief FixedAnalyzer with a Q15 integer FFT core, for CPUs where double FFTW is the bottleneck.
+ *
+ * Samples enter fixed point once, in load_samples(): Q15 samples times an
+ * integer window go into a Q15Fft. Squared magnitudes, the peak search and
+ * the threshold test are 64-bit integer math. Only the final magnitudes are
+ * converted (one single-precision square root per bin), so the output is in
+ * the same units as FixedAnalyzer's and min_magnitude means the same on
+ * either backend.
+ *
+ * Only the transform is integer: capture, decimation and the history ring
+ * stay float, and note mapping runs on the double magnitudes like FixedAnalyzer's.
+ */
+template <int FFT_SIZE>
+class Q15Analyzer : public Analyzer {
+public:
+    static const int BINS = FFT_SIZE / 2 + 1;
+
+    /**
+     * @brief Constructor that builds the FFT tables, the integer window and the bin tables.
+     * @param sample_rate Rate of the analysed samples in Hz (after decimation).
+     * @param min_freq Bins below this frequency (Hz) are ignored.
+     * @param min_magnitude Bins must exceed this magnitude to count as a note.
+     * @param window_type Analysis window applied to every frame.
+     * @param kaiser_beta Shape of the Kaiser window (ignored for the others).
+     */
+    Q15Analyzer(double sample_rate, int min_freq, double min_magnitude, WindowType window_type, double kaiser_beta);
+
+    int fft_size() const { return FFT_SIZE; }
+    int num_bins() const { return BINS; }
+    double bin_frequency(int bin) const { return bin * bin_hz; }
+    void load_samples(const float *samples);
+    int calculate_magnitudes(double *magnitudes);
+    int detect_notes(const double *magnitudes, float levels[NUM_NOTES], double note_magnitudes[NUM_NOTES]) const;
+
+private:
+    Q15Fft fft;
+    std::vector<int32_t> fft_in;
+    std::vector<int32_t> fft_out;   // Interleaved re, im
+    std::vector<int32_t> window;    // Unit-mean window scaled by 2^window_shift
+    int window_shift;
+
+    double bin_hz;
+    int min_index;
+    double min_magnitude;
+    int64_t min_power;              // min_magnitude squared, in FFT output units
+
+    std::array<int8_t, BINS> bin_note; // Pitch class of each bin
+};
+
+#endif // _Q15_ANALYZER_H_
@@ -0,0 +1,125 @@
+#include "q15_fft.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+// Q31 multiply with rounding: (a * b) / 2^31.
+static inline int32_t mul_q31(int32_t a, int32_t b) {
+    return static_cast<int32_t>((static_cast<int64_t>(a) * b + (INT64_C(1) << 30)) >> 31);
+}
+
+static int32_t to_q31(double x) {
+    double scaled = std::round(x * 2147483648.0);
+    if (scaled > 2147483647.0) {
+        return INT32_MAX;
+    }
+    if (scaled < -2147483648.0) {
+        return INT32_MIN;
+    }
+    return static_cast<int32_t>(scaled);
+}
+
+/**
+ * @brief Constructor that builds the twiddle and bit-reversal tables.
+ * @param size Transform length; a power of two, 4 to 65536.
+ * @throws std::runtime_error if size is not supported.
+ */
+Q15Fft::Q15Fft(int size) : n(size), half(size / 2) {
+    if (size < 4 || size > 65536 || (size & (size - 1)) != 0) {
+        throw std::runtime_error("Error: Q15 FFT size must be a power of two from 4 to 65536, got " +
+                                 std::to_string(size) + ".");
+    }
+
+    cos_q31.resize(half + 1);
+    sin_q31.resize(half + 1);
+    for (int k = 0; k <= half; k++) {
+        double angle = 2.0 * M_PI * k / n;
+        cos_q31[k] = to_q31(std::cos(angle));
+        sin_q31[k] = to_q31(std::sin(angle));
+    }
+
+    // e^(-2 pi i j / len) for every butterfly span, stage after stage.
+    for (int len = 2; len <= half; len <<= 1) {
+        for (int j = 0; j < len / 2; j++) {
+            stage_twiddles.push_back(cos_q31[j * (n / len)]);
+            stage_twiddles.push_back(-sin_q31[j * (n / len)]);
+        }
+    }
+
+    int bits = 0;
+    while ((1 << bits) < half) {
+        bits++;
+    }
+    for (int i = 0; i < half; i++) {
+        int j = 0;
+        for (int b = 0; b < bits; b++) {
+            j |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        if (i < j) {
+            swaps.push_back(i);
+            swaps.push_back(j);
+        }
+    }
+
+    work.resize(2 * half);
+}
+
+/**
+ * @brief Forward real FFT.
+ * @param in size() real samples. The sum of their absolute values must
+ *           stay below 2^30 (true for Q15 samples times a unit-mean window
+ *           up to size 16384).
+ * @param out Output, size()/2 + 1 complex bins as interleaved re, im.
+ */
+void Q15Fft::forward(const int32_t *in, int32_t *out) {
+    // Pack even samples as real and odd samples as imaginary parts, in bit-reversed order.
+    int32_t *z = work.data();
+    for (int i = 0; i < 2 * half; i++) {
+        z[i] = in[i];
+    }
+    for (size_t s = 0; s < swaps.size(); s += 2) {
+        const uint32_t i = swaps[s], j = swaps[s + 1];
+        int32_t re = z[2 * i], im = z[2 * i + 1];
+        z[2 * i] = z[2 * j];
+        z[2 * i + 1] = z[2 * j + 1];
+        z[2 * j] = re;
+        z[2 * j + 1] = im;
+    }
+
+    // Radix-2 decimation in time, each stage reading its twiddles contiguously.
+    const int32_t *w = stage_twiddles.data();
+    for (int len = 2; len <= half; len <<= 1) {
+        const int span = len / 2;
+        for (int i = 0; i < half; i += len) {
+            int32_t *a = z + 2 * i;
+            int32_t *b = a + 2 * span;
+            for (int j = 0; j < span; j++) {
+                const int32_t wr = w[2 * j];
+                const int32_t wi = w[2 * j + 1];
+                const int32_t tr = mul_q31(b[2 * j], wr) - mul_q31(b[2 * j + 1], wi);
+                const int32_t ti = mul_q31(b[2 * j], wi) + mul_q31(b[2 * j + 1], wr);
+                b[2 * j] = a[2 * j] - tr;
+                b[2 * j + 1] = a[2 * j + 1] - ti;
+                a[2 * j] += tr;
+                a[2 * j + 1] += ti;
+            }
+        }
+        w += 2 * span;
+    }
+
+    // Split step: X[k] = E[k] + e^(-2 pi i k / n) O[k], with
+    // E = (Z[k] + conj Z[half-k]) / 2 and O = (Z[k] - conj Z[half-k]) / 2i.
+    for (int k = 0; k <= half; k++) {
+        const int32_t *zk = z + 2 * (k % half);
+        const int32_t *zc = z + 2 * ((half - k) % half);
+        const int32_t er = static_cast<int32_t>((static_cast<int64_t>(zk[0]) + zc[0]) >> 1);
+        const int32_t ei = static_cast<int32_t>((static_cast<int64_t>(zk[1]) - zc[1]) >> 1);
+        const int32_t orr = static_cast<int32_t>((static_cast<int64_t>(zk[1]) + zc[1]) >> 1);
+        const int32_t oi = static_cast<int32_t>((static_cast<int64_t>(zc[0]) - zk[0]) >> 1);
+        const int32_t wr = cos_q31[k];
+        const int32_t wi = -sin_q31[k];
+        out[2 * k] = er + mul_q31(orr, wr) - mul_q31(oi, wi);
+        out[2 * k + 1] = ei + mul_q31(orr, wi) + mul_q31(oi, wr);
+    }
+}
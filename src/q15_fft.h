@@ -0,0 +1,54 @@
+#ifndef _Q15_FFT_H_
+#define _Q15_FFT_H_
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class Q15Fft
+ * @brief Integer real-input FFT for CPUs where double-precision FFTW is too slow.
+ *
+ * Input is real samples of at most 16 bits (Q15) in int32 slots; the
+ * transform runs in 32-bit integers with Q31 twiddles, 64-bit products and
+ * no per-stage scaling. That cannot overflow: every output is bounded by the
+ * sum of the absolute inputs, and inputs are limited so that sum stays
+ * below 2^30 (see forward()). Output bins are in the same units as the input
+ * sums, i.e. what FFTW would give for the same integer input.
+ *
+ * The real transform of size N is computed as a complex radix-2 FFT of size
+ * N/2 on the even/odd samples, followed by the usual split step.
+ */
+class Q15Fft {
+public:
+    /**
+     * @brief Constructor that builds the twiddle and bit-reversal tables.
+     * @param size Transform length; a power of two, 4 to 65536.
+     * @throws std::runtime_error if size is not supported.
+     */
+    explicit Q15Fft(int size);
+
+    /**
+     * @brief Transform length.
+     */
+    int size() const { return n; }
+
+    /**
+     * @brief Forward real FFT.
+     * @param in size() real samples. The sum of their absolute values must
+     *           stay below 2^30 (true for Q15 samples times a unit-mean window
+     *           up to size 16384).
+     * @param out Output, size()/2 + 1 complex bins as interleaved re, im.
+     */
+    void forward(const int32_t *in, int32_t *out);
+
+private:
+    int n;                          // Real transform length
+    int half;                       // Complex transform length, n / 2
+    std::vector<int32_t> cos_q31;   // cos(2 pi k / n), k = 0 .. n/2, Q31
+    std::vector<int32_t> sin_q31;   // sin(2 pi k / n), k = 0 .. n/2, Q31
+    std::vector<int32_t> stage_twiddles; // Per butterfly stage, interleaved re, im
+    std::vector<uint32_t> swaps;    // Bit-reversal pairs (i, j) with i < j, flattened
+    std::vector<int32_t> work;      // Complex scratch, half values interleaved
+};
+
+#endif // _Q15_FFT_H_
@@ -0,0 +1,133 @@
+#include "realtime.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static std::string permission_hint(int err) {
+    if (err == EPERM) {
+        return " (permission denied: run as root, grant CAP_SYS_NICE/CAP_IPC_LOCK, "
+               "or raise rtprio/memlock in /etc/security/limits.conf or LimitRTPRIO=/LimitMEMLOCK= in the systemd unit)";
+    }
+    if (err == ENOMEM) {
+        return " (memlock limit too low: raise memlock in /etc/security/limits.conf or LimitMEMLOCK= in the systemd unit)";
+    }
+    return "";
+}
+
+/**
+ * @brief Locks all current and future pages of the process into RAM.
+ * @param error Set to a readable reason on failure.
+ * @return True on success.
+ */
+bool realtime_lock_memory(std::string &error) {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        int err = errno;
+        error = std::string("mlockall failed: ") + std::strerror(err) + permission_hint(err);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Pins a thread to one CPU and gives it SCHED_FIFO priority.
+ * @param thread The thread to configure.
+ * @param cpu CPU index to pin to, or -1 to leave the affinity unchanged.
+ * @param priority SCHED_FIFO priority (1-99), or 0 to leave the policy unchanged.
+ * @param error Set to a readable reason on failure.
+ * @return True if every requested setting was applied.
+ */
+bool realtime_configure_thread(pthread_t thread, int cpu, int priority, std::string &error) {
+    bool ok = true;
+    error.clear();
+
+    if (cpu >= 0) {
+        long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        if (cpu >= num_cpus) {
+            error += "CPU " + std::to_string(cpu) + " does not exist (" + std::to_string(num_cpus) + " online). ";
+            ok = false;
+        } else {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            int err = pthread_setaffinity_np(thread, sizeof(set), &set);
+            if (err != 0) {
+                error += std::string("Pinning to CPU ") + std::to_string(cpu) + " failed: " + std::strerror(err) + ". ";
+                ok = false;
+            }
+        }
+    }
+
+    if (priority > 0) {
+        sched_param param;
+        std::memset(&param, 0, sizeof(param));
+        param.sched_priority = priority;
+        int err = pthread_setschedparam(thread, SCHED_FIFO, &param);
+        if (err != 0) {
+            error += std::string("SCHED_FIFO priority ") + std::to_string(priority) + " failed: " +
+                     std::strerror(err) + permission_hint(err) + ". ";
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+/**
+ * @brief Restricts a thread to a set of CPUs, leaving its scheduling policy alone.
+ * @param thread The thread to configure.
+ * @param cpus CPU indices; empty leaves the affinity unchanged.
+ * @param error Set to a readable reason on failure.
+ * @return True on success.
+ */
+bool realtime_set_cpus(pthread_t thread, const std::vector<int> &cpus, std::string &error) {
+    error.clear();
+    if (cpus.empty()) {
+        return true;
+    }
+
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu < 0 || cpu >= num_cpus) {
+            error = "CPU " + std::to_string(cpu) + " does not exist (" + std::to_string(num_cpus) + " online).";
+            return false;
+        }
+        CPU_SET(cpu, &set);
+    }
+    int err = pthread_setaffinity_np(thread, sizeof(set), &set);
+    if (err != 0) {
+        error = std::string("Pinning to the CPU set failed: ") + std::strerror(err) + ".";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Touches every page of a buffer so it is resident before use.
+ */
+void realtime_prefault(void *data, size_t bytes) {
+    volatile char *p = static_cast<volatile char*>(data);
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    for (size_t i = 0; i < bytes; i += page) {
+        p[i] = p[i];
+    }
+}
+
+/**
+ * @brief Touches the calling thread's stack so later deep calls don't fault.
+ * @param bytes How much stack to pre-fault.
+ */
+void realtime_prefault_stack(size_t bytes) {
+    // Fixed-size frame; only the first `bytes` of it are touched.
+    const size_t max_bytes = 512 * 1024;
+    char stack[max_bytes];
+    volatile char *p = stack;
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    for (size_t i = 0; i < bytes && i < max_bytes; i += page) {
+        p[i] = 0;
+    }
+}
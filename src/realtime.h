@@ -0,0 +1,52 @@
+#ifndef _REALTIME_H_
+#define _REALTIME_H_
+
+#include <cstddef>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Locks all current and future pages of the process into RAM.
+ *
+ * Call after the long-lived buffers are allocated: MCL_CURRENT faults in
+ * everything already mapped (FFTW arrays, capture ring, SPI buffers), so the
+ * real-time threads never take a page fault on them.
+ * @param error Set to a readable reason on failure.
+ * @return True on success.
+ */
+bool realtime_lock_memory(std::string &error);
+
+/**
+ * @brief Pins a thread to one CPU and gives it SCHED_FIFO priority.
+ * @param thread The thread to configure.
+ * @param cpu CPU index to pin to, or -1 to leave the affinity unchanged.
+ * @param priority SCHED_FIFO priority (1-99), or 0 to leave the policy unchanged.
+ * @param error Set to a readable reason on failure.
+ * @return True if every requested setting was applied.
+ */
+bool realtime_configure_thread(pthread_t thread, int cpu, int priority, std::string &error);
+
+/**
+ * @brief Restricts a thread to a set of CPUs, leaving its scheduling policy alone.
+ *
+ * Threads it creates afterwards (e.g. FFTW's workers) inherit the set.
+ * @param thread The thread to configure.
+ * @param cpus CPU indices; empty leaves the affinity unchanged.
+ * @param error Set to a readable reason on failure.
+ * @return True on success.
+ */
+bool realtime_set_cpus(pthread_t thread, const std::vector<int> &cpus, std::string &error);
+
+/**
+ * @brief Touches every page of a buffer so it is resident before use.
+ */
+void realtime_prefault(void *data, size_t bytes);
+
+/**
+ * @brief Touches the calling thread's stack so later deep calls don't fault.
+ * @param bytes How much stack to pre-fault.
+ */
+void realtime_prefault_stack(size_t bytes = 256 * 1024);
+
+#endif // _REALTIME_H_
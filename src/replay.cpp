@@ -0,0 +1,135 @@
+// chromesthat_replay: plays a frame log recorded with --record-path back to
+// any LED output, frame for frame and at the recorded timing.
+#include <iostream>
+#include <vector>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include "config.h"
+#include "frame_log.h"
+#include "led_output.h"
+
+volatile bool keepRunning = true;
+
+void signalHandler(int signum) {
+    (void)signum;
+    keepRunning = false;
+}
+
+void printUsage(const char *program) {
+    std::cout << "Usage: " << program << " LOG [--fast] [--speed X] [--start SECONDS] [--OPTION VALUE ...]\n"
+              << "\n  --fast                   Send frames as fast as the output takes them\n"
+              << "  --speed X                Play at X times the recorded rate (1)\n"
+              << "  --start SECONDS          Skip the first SECONDS of the recording (0)\n"
+              << "\nOutput options (--config, --output, --spi-device, --output-host, ...) are as for\n"
+              << "chromesthat; --num-leds is taken from the log." << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+
+    std::vector<std::string> args(argv + 1, argv + argc);
+    std::string log_path;
+    bool fast = false;
+    double speed = 1.0;
+    double start_seconds = 0.0;
+    std::vector<std::string> config_args;
+
+    try {
+        for (size_t i = 0; i < args.size(); i++) {
+            const std::string &arg = args[i];
+            if (arg == "--help" || arg == "-h") {
+                printUsage(argv[0]);
+                return 0;
+            } else if (arg == "--fast") {
+                fast = true;
+            } else if ((arg == "--speed" || arg == "--start") && i + 1 < args.size()) {
+                char *end;
+                double value = std::strtod(args[++i].c_str(), &end);
+                if (*end != '\0' || (arg == "--speed" ? value <= 0 : value < 0)) {
+                    throw std::runtime_error("Error: Invalid value '" + args[i] + "' for " + arg + ".");
+                }
+                (arg == "--speed" ? speed : start_seconds) = value;
+            } else if (i == 0 && arg.compare(0, 2, "--") != 0) {
+                log_path = arg;
+            } else {
+                config_args.push_back(arg);
+            }
+        }
+        if (log_path.empty()) {
+            throw std::runtime_error("Error: No frame log given.");
+        }
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    try {
+        FrameLogReader log(log_path);
+        const FrameLogHeader &header = log.header();
+
+        Config config = config_from_args(config_args);
+        if (static_cast<uint32_t>(config.num_leds) != header.num_leds) {
+            std::cout << "Using the recorded strip length of " << header.num_leds << " LEDs." << std::endl;
+            config.num_leds = static_cast<int>(header.num_leds);
+        }
+        std::unique_ptr<LedOutput> output = make_led_output(config);
+
+        time_t recorded = static_cast<time_t>(header.start_unix_ns / 1000000000);
+        char when[64];
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&recorded));
+        std::cout << "Replaying " << log_path << ": " << header.num_leds << " LEDs at "
+                  << header.frame_rate << " fps, recorded " << when << "." << std::endl;
+
+        signal(SIGINT, signalHandler);
+        signal(SIGTERM, signalHandler);
+
+        const uint64_t skip_ns = static_cast<uint64_t>(start_seconds * 1e9);
+        const size_t frame_bytes = header.num_leds * sizeof(Pixel);
+        std::chrono::steady_clock::time_point start;
+        uint64_t first_time_ns = 0;
+        bool started = false;
+        uint64_t frames = 0;
+        uint64_t last_time_ns = 0;
+
+        FrameLogRecord record;
+        const Pixel *pixels;
+        while (keepRunning && (pixels = log.next(record)) != nullptr) {
+            if (record.time_ns < skip_ns) {
+                continue;
+            }
+            if (!started) {
+                start = std::chrono::steady_clock::now();
+                first_time_ns = record.time_ns;
+                started = true;
+            }
+            if (!fast) {
+                // Schedule against the recording's own clock so timing errors don't accumulate.
+                std::this_thread::sleep_until(start + std::chrono::nanoseconds(
+                    static_cast<int64_t>((record.time_ns - first_time_ns) / speed)));
+            }
+
+            std::memcpy(output->buffer(), pixels, frame_bytes);
+            output->show();
+            frames++;
+            last_time_ns = record.time_ns;
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Sent " << frames << " frames (" << last_time_ns / 1e9 << " s of recording) in "
+                  << (started ? seconds : 0.0) << " s." << std::endl;
+
+        output->clear();
+        output->show();
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
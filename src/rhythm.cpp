@@ -0,0 +1,184 @@
+#include "rhythm.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "analyzer.h"
+
+// Time constants of the running statistics, in seconds.
+#define FLUX_AVERAGE_S 2.0   // Onset threshold mean/deviation
+#define TEMPO_MEMORY_S 8.0   // Autocorrelation forgetting
+
+// Onset threshold: this many deviations above the mean flux.
+#define ONSET_THRESHOLD 1.5
+// Shortest time between two onsets.
+#define ONSET_REFRACTORY_S 0.1
+
+// Tempo prior: log-normal around this tempo, one octave wide.
+#define PREFERRED_BPM 120.0
+
+// How strongly an onset pulls the beat phase and period towards itself.
+#define PHASE_GAIN 0.2
+#define PERIOD_GAIN 0.02
+
+/**
+ * @brief Constructor that preallocates every buffer.
+ * @param hop_seconds Time between analysis frames (one capture block).
+ * @param min_bpm Slowest tempo considered.
+ * @param max_bpm Fastest tempo considered.
+ */
+RhythmTracker::RhythmTracker(double hop_seconds, float min_bpm, float max_bpm)
+    : hop(hop_seconds), prev_log(MAX_FFT_SIZE / 2 + 1) {
+
+    min_lag = std::max(1, static_cast<int>(std::floor(60.0 / (max_bpm * hop))));
+    max_lag = std::max(min_lag + 2, static_cast<int>(std::ceil(60.0 / (min_bpm * hop))));
+    novelty.resize(max_lag + 1);
+    acf.resize(max_lag + 1);
+
+    tempo_weight.resize(max_lag + 1);
+    for (int lag = 0; lag <= max_lag; lag++) {
+        double octaves = lag > 0 ? std::log2(60.0 / (lag * hop) / PREFERRED_BPM) : 0;
+        tempo_weight[lag] = std::exp(-0.5 * octaves * octaves);
+    }
+
+    reset();
+}
+
+/**
+ * @brief Forgets all state (e.g. after the stream restarts).
+ */
+void RhythmTracker::reset() {
+    prev_bins = 0;
+    last_seq = 0;
+    started = false;
+    flux_mean = 0;
+    flux_dev = 0;
+    prev_novelty = 0;
+    frames_since_onset = 0;
+    strength = 0;
+    onset = false;
+    std::fill(novelty.begin(), novelty.end(), 0.0);
+    novelty_pos = 0;
+    std::fill(acf.begin(), acf.end(), 0.0);
+    period_frames = 60.0 / (PREFERRED_BPM * hop);
+    tempo_confidence = 0;
+    phase = 0;
+}
+
+/**
+ * @brief Feeds one analysis frame. Never allocates.
+ * @param magnitudes Bin magnitudes from the analyzer.
+ * @param first_bin First bin refreshed every frame (see Analyzer::first_live_bin()).
+ * @param num_bins Number of bins; a change (new analyzer) restarts the flux.
+ * @param seq Capture block counter of the frame, used to account for skipped frames.
+ */
+void RhythmTracker::update(const double *magnitudes, int first_bin, int num_bins, uint64_t seq) {
+    // Frames the FFT stage merged or dropped still take time: keep the novelty curve evenly spaced.
+    if (started && seq > last_seq + 1) {
+        uint64_t missed = std::min<uint64_t>(seq - last_seq - 1, novelty.size());
+        for (uint64_t i = 0; i < missed; i++) {
+            push_novelty(0);
+            advance_phase();
+        }
+    }
+    last_seq = seq;
+
+    // Half-wave rectified log spectral flux: only rising energy counts.
+    double flux = 0;
+    bool restart = !started || num_bins != prev_bins;
+    for (int i = first_bin; i < num_bins; i++) {
+        float value = std::log1p(static_cast<float>(magnitudes[i]));
+        flux += std::max(0.0f, value - prev_log[i]);
+        prev_log[i] = value;
+    }
+    prev_bins = num_bins;
+    started = true;
+    if (restart) {
+        flux = flux_mean;
+    }
+
+    // Adaptive threshold from running mean and mean absolute deviation.
+    double alpha = 1.0 - std::exp(-hop / FLUX_AVERAGE_S);
+    double deviation = std::fabs(flux - flux_mean);
+    flux_mean += alpha * (flux - flux_mean);
+    flux_dev += alpha * (deviation - flux_dev);
+
+    double novelty_value = std::max(0.0, flux - flux_mean);
+    double threshold = ONSET_THRESHOLD * flux_dev;
+    strength = flux_dev > 0 ? static_cast<float>(std::min(1.0, novelty_value / (2 * threshold))) : 0.0f;
+
+    frames_since_onset++;
+    onset = novelty_value > threshold && prev_novelty <= threshold &&
+            frames_since_onset * hop >= ONSET_REFRACTORY_S;
+    if (onset) {
+        frames_since_onset = 0;
+    }
+    prev_novelty = novelty_value;
+
+    push_novelty(novelty_value);
+    update_tempo();
+    advance_phase();
+
+    if (onset) {
+        // Pull the oscillator towards the onset: error is in beats, -0.5 - 0.5.
+        double error = phase >= 0.5 ? phase - 1.0 : phase;
+        phase -= PHASE_GAIN * error;
+        if (phase < 0) {
+            phase += 1.0;
+        }
+        period_frames *= 1.0 + PERIOD_GAIN * error * tempo_confidence;
+    }
+}
+
+void RhythmTracker::push_novelty(double value) {
+    // Running autocorrelation: each lag forgets exponentially, then adds this frame's product.
+    const double forget = std::exp(-hop / TEMPO_MEMORY_S);
+    const int size = static_cast<int>(novelty.size());
+    novelty[novelty_pos] = value;
+    for (int lag = 0; lag <= max_lag; lag++) {
+        int past = novelty_pos - lag;
+        if (past < 0) {
+            past += size;
+        }
+        acf[lag] = forget * acf[lag] + value * novelty[past];
+    }
+    novelty_pos = (novelty_pos + 1) % size;
+}
+
+void RhythmTracker::update_tempo() {
+    if (acf[0] <= 0) {
+        return;
+    }
+
+    int best = 0;
+    double best_score = 0;
+    for (int lag = min_lag; lag <= max_lag; lag++) {
+        double score = acf[lag] * tempo_weight[lag];
+        if (score > best_score) {
+            best_score = score;
+            best = lag;
+        }
+    }
+    if (best == 0) {
+        return;
+    }
+
+    // Parabolic interpolation around the peak for a fractional lag.
+    double lag = best;
+    if (best > min_lag && best < max_lag) {
+        double a = acf[best - 1], b = acf[best], c = acf[best + 1];
+        double denom = a - 2 * b + c;
+        if (denom < 0) {
+            lag += 0.5 * (a - c) / denom;
+        }
+    }
+
+    tempo_confidence = static_cast<float>(std::min(1.0, acf[best] / acf[0]));
+    // Follow the autocorrelation gradually so the phase loop is not thrown off.
+    period_frames += 0.1 * tempo_confidence * (lag - period_frames);
+}
+
+void RhythmTracker::advance_phase() {
+    phase += 1.0 / period_frames;
+    phase -= std::floor(phase);
+}
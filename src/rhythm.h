@@ -0,0 +1,101 @@
+#ifndef _RHYTHM_H_
+#define _RHYTHM_H_
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class RhythmTracker
+ * @brief Onset detection and tempo tracking from the analysis magnitudes.
+ *
+ * Runs on the feature stage over the spectrum the FFT stage already
+ * computed. Each frame costs O(bins) for the spectral flux plus O(lags) for
+ * an exponentially forgetting autocorrelation of the onset curve; nothing is
+ * recomputed over a history window. The beat phase is a phase-locked loop
+ * that runs at the autocorrelation tempo and is nudged by detected onsets.
+ */
+class RhythmTracker {
+public:
+    /**
+     * @brief Constructor that preallocates every buffer.
+     * @param hop_seconds Time between analysis frames (one capture block).
+     * @param min_bpm Slowest tempo considered.
+     * @param max_bpm Fastest tempo considered.
+     */
+    RhythmTracker(double hop_seconds, float min_bpm = 60, float max_bpm = 200);
+
+    /**
+     * @brief Feeds one analysis frame. Never allocates.
+     * @param magnitudes Bin magnitudes from the analyzer.
+     * @param first_bin First bin refreshed every frame (see Analyzer::first_live_bin()).
+     * @param num_bins Number of bins; a change (new analyzer) restarts the flux.
+     * @param seq Capture block counter of the frame, used to account for skipped frames.
+     */
+    void update(const double *magnitudes, int first_bin, int num_bins, uint64_t seq);
+
+    /**
+     * @brief Forgets all state (e.g. after the stream restarts).
+     */
+    void reset();
+
+    /**
+     * @brief Onset strength of the last frame, 0.0 - 1.0.
+     */
+    float onset_strength() const { return strength; }
+
+    /**
+     * @brief True if the last frame was detected as an onset.
+     */
+    bool is_onset() const { return onset; }
+
+    /**
+     * @brief Current tempo estimate in beats per minute.
+     */
+    float bpm() const { return static_cast<float>(60.0 / (period_frames * hop)); }
+
+    /**
+     * @brief Position within the current beat at the last frame, 0.0 (on the beat) - 1.0.
+     */
+    float beat_phase() const { return static_cast<float>(phase); }
+
+    /**
+     * @brief How periodic the onset curve is, 0.0 - 1.0. Low values mean the tempo is a guess.
+     */
+    float confidence() const { return tempo_confidence; }
+
+private:
+    double hop;
+    int min_lag;
+    int max_lag;
+
+    // Spectral flux
+    std::vector<float> prev_log;  // log(1 + magnitude) of the previous frame
+    int prev_bins;
+    uint64_t last_seq;
+    bool started;
+
+    // Adaptive onset threshold
+    double flux_mean;
+    double flux_dev;
+    double prev_novelty;
+    int frames_since_onset;
+    float strength;
+    bool onset;
+
+    // Tempo: novelty history and its running autocorrelation per lag
+    std::vector<double> novelty;  // Circular, max_lag + 1 frames
+    int novelty_pos;
+    std::vector<double> acf;
+    std::vector<double> tempo_weight;
+    double period_frames;
+    float tempo_confidence;
+
+    // Beat phase-locked loop
+    double phase;
+
+    void push_novelty(double value);
+    void update_tempo();
+    void advance_phase();
+};
+
+#endif // _RHYTHM_H_
@@ -0,0 +1,113 @@
+#include "rt_events.h"
+
+#include <thread>
+
+// Records in flight to the reporter; more than this per poll only loses detail.
+#define RT_EVENT_QUEUE 256
+
+// The reporter polls the queue this often and prints at most once per interval.
+#define REPORT_POLL_MS 100
+#define REPORT_INTERVAL_MS 1000
+
+/**
+ * @brief Human-readable name of an event type.
+ */
+const char *rt_event_name(RtEvent event) {
+    switch (event) {
+    case RT_EVENT_INPUT_OVERFLOW:   return "input overflow";
+    case RT_EVENT_OUTPUT_UNDERFLOW: return "output underflow";
+    case RT_EVENT_SHORT_BUFFER:     return "short buffer";
+    case RT_EVENT_CAPTURE_OVERRUN:  return "capture overrun (analysis behind)";
+    default:                        return "unknown event";
+    }
+}
+
+/**
+ * @brief Constructor.
+ * @param out Where the reporter writes its summaries.
+ */
+RtEventLog::RtEventLog(std::ostream &out)
+    : out(out), queue(RT_EVENT_QUEUE), reporter("rt-events", [this]() { report_step(); }) {
+    for (int i = 0; i < RT_EVENT_COUNT; i++) {
+        counts[i] = 0;
+        reported[i] = 0;
+        have_first[i] = false;
+    }
+    last_report = clock::now();
+}
+
+RtEventLog::~RtEventLog() {
+    stop();
+}
+
+/**
+ * @brief Records an event. Real-time safe; one producer thread at a time.
+ * @param event What happened.
+ * @param value Frames involved.
+ * @param stream_time Stream time of the block (s).
+ */
+void RtEventLog::record(RtEvent event, uint32_t value, double stream_time) {
+    counts[event].fetch_add(1, std::memory_order_relaxed);
+    RtEventRecord r;
+    r.event = event;
+    r.value = value;
+    r.stream_time = stream_time;
+    queue.push(r);
+}
+
+/**
+ * @brief Starts the reporter thread.
+ */
+void RtEventLog::start() {
+    reporter.start();
+}
+
+/**
+ * @brief Stops the reporter thread after a final report.
+ */
+void RtEventLog::stop() {
+    reporter.stop();
+    drain();
+    report();
+}
+
+void RtEventLog::report_step() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(REPORT_POLL_MS));
+    drain();
+
+    clock::time_point now = clock::now();
+    if (now - last_report >= std::chrono::milliseconds(REPORT_INTERVAL_MS)) {
+        report();
+        last_report = now;
+    }
+}
+
+// Keeps the first record of each type; the counters have the totals.
+void RtEventLog::drain() {
+    RtEventRecord r;
+    while (queue.pop(r)) {
+        if (r.event < RT_EVENT_COUNT && !have_first[r.event]) {
+            first[r.event] = r;
+            have_first[r.event] = true;
+        }
+    }
+}
+
+// One line per event type that fired since the last report.
+void RtEventLog::report() {
+    for (int i = 0; i < RT_EVENT_COUNT; i++) {
+        uint64_t total = counts[i].load(std::memory_order_relaxed);
+        uint64_t fresh = total - reported[i];
+        if (fresh == 0) {
+            have_first[i] = false;
+            continue;
+        }
+        out << "Audio: " << rt_event_name(static_cast<RtEvent>(i)) << " x" << fresh;
+        if (have_first[i]) {
+            out << " (first at " << first[i].stream_time << " s, " << first[i].value << " frames)";
+        }
+        out << ", " << total << " since start" << std::endl;
+        reported[i] = total;
+        have_first[i] = false;
+    }
+}
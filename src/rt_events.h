@@ -0,0 +1,98 @@
+#ifndef _RT_EVENTS_H_
+#define _RT_EVENTS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#include "spsc_queue.h"
+#include "stage.h"
+
+/**
+ * @brief Things that go wrong on the real-time side of capture.
+ */
+enum RtEvent {
+    RT_EVENT_INPUT_OVERFLOW,    // The device dropped input before the callback ran
+    RT_EVENT_OUTPUT_UNDERFLOW,  // The device reported an output underflow
+    RT_EVENT_SHORT_BUFFER,      // The callback got fewer frames than the stream was opened with
+    RT_EVENT_CAPTURE_OVERRUN,   // The FFT stage fell behind and a capture block was dropped
+    RT_EVENT_COUNT
+};
+
+/**
+ * @brief Fixed-size record of one event, passed from the real-time side to the reporter.
+ */
+struct RtEventRecord {
+    uint32_t event;             // RtEvent
+    uint32_t value;             // Frames involved
+    double stream_time;         // Stream time of the block (s)
+};
+
+/**
+ * @class RtEventLog
+ * @brief Collects diagnostics from the audio callback without I/O, locks or allocation.
+ *
+ * record() bumps an atomic counter and pushes a fixed-size record into a
+ * lock-free queue; if the queue is full only the record is lost, never the
+ * count. A reporter thread drains the queue and prints at most one line per
+ * event type per interval, so a burst of overflows becomes a single summary
+ * instead of a stream of writes that slows the system down further.
+ */
+class RtEventLog {
+public:
+    /**
+     * @brief Constructor.
+     * @param out Where the reporter writes its summaries.
+     */
+    explicit RtEventLog(std::ostream &out);
+    ~RtEventLog();
+
+    /**
+     * @brief Records an event. Real-time safe; one producer thread at a time.
+     * @param event What happened.
+     * @param value Frames involved.
+     * @param stream_time Stream time of the block (s).
+     */
+    void record(RtEvent event, uint32_t value, double stream_time);
+
+    /**
+     * @brief Events of a type recorded since start.
+     */
+    uint64_t count(RtEvent event) const { return counts[event].load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Starts the reporter thread.
+     */
+    void start();
+
+    /**
+     * @brief Stops the reporter thread after a final report.
+     */
+    void stop();
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    std::ostream &out;
+    std::atomic<uint64_t> counts[RT_EVENT_COUNT];
+    SpscQueue<RtEventRecord> queue;
+
+    // Reporter thread state
+    uint64_t reported[RT_EVENT_COUNT];      // counts[] at the last report
+    bool have_first[RT_EVENT_COUNT];
+    RtEventRecord first[RT_EVENT_COUNT];    // First record of each type this interval
+    clock::time_point last_report;
+    StageThread reporter;
+
+    void report_step();
+    void drain();
+    void report();
+};
+
+/**
+ * @brief Human-readable name of an event type.
+ */
+const char *rt_event_name(RtEvent event);
+
+#endif // _RT_EVENTS_H_
@@ -0,0 +1,207 @@
+#include "shm_feed.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Constructor that creates (or replaces) the shared-memory object.
+ * @param name POSIX shared-memory name, e.g. "/chromesthat".
+ * @throws std::runtime_error if the object cannot be created or mapped.
+ */
+ShmFeedWriter::ShmFeedWriter(const std::string &name) : name(name), next_index(0) {
+    // A feed left behind by a crashed run is replaced; readers still mapping it keep the old one.
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Error: Cannot create shared memory '" + name + "': " + strerror(errno));
+    }
+    if (ftruncate(fd, sizeof(ShmFeedHeader)) < 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Error: Cannot size shared memory '" + name + "': " + strerror(errno));
+    }
+    void *mem = mmap(nullptr, sizeof(ShmFeedHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Error: Cannot map shared memory '" + name + "': " + strerror(errno));
+    }
+
+    feed = static_cast<ShmFeedHeader *>(mem);
+    feed->version = SHM_FEED_VERSION;
+    feed->slot_count = SHM_FEED_SLOTS;
+    feed->max_bins = SHM_FEED_MAX_BINS;
+    feed->published.store(0, std::memory_order_relaxed);
+    feed->layout.generation.store(0, std::memory_order_relaxed);
+    for (ShmFeedFrame &frame : feed->frames) {
+        frame.generation.store(0, std::memory_order_relaxed);
+    }
+    // Readers check the magic last, once everything else is in place.
+    std::atomic_thread_fence(std::memory_order_release);
+    feed->magic = SHM_FEED_MAGIC;
+}
+
+/**
+ * @brief Destructor that unmaps and removes the shared-memory object.
+ */
+ShmFeedWriter::~ShmFeedWriter() {
+    munmap(feed, sizeof(ShmFeedHeader));
+    shm_unlink(name.c_str());
+}
+
+/**
+ * @brief Touches the whole mapping so publishing never page-faults.
+ */
+void ShmFeedWriter::prefault() {
+    volatile uint8_t *p = reinterpret_cast<volatile uint8_t *>(feed);
+    for (size_t i = 0; i < sizeof(ShmFeedHeader); i += 4096) {
+        p[i] = p[i];
+    }
+}
+
+/**
+ * @brief Publishes a new bin layout. Call before the first frame that uses it.
+ * @param bin_frequency Centre frequency of every bin (Hz).
+ * @param num_bins Number of bins, at most SHM_FEED_MAX_BINS.
+ */
+void ShmFeedWriter::set_layout(const float *bin_frequency, uint32_t num_bins) {
+    ShmFeedLayout &layout = feed->layout;
+    uint32_t generation = layout.generation.load(std::memory_order_relaxed);
+    layout.generation.store(generation + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    layout.num_bins = std::min<uint32_t>(num_bins, SHM_FEED_MAX_BINS);
+    std::memcpy(layout.bin_frequency, bin_frequency, layout.num_bins * sizeof(float));
+
+    layout.generation.store(generation + 2, std::memory_order_release);
+}
+
+/**
+ * @brief Starts writing the next frame slot.
+ * @return The slot to fill; readers will skip it until end_frame().
+ */
+ShmFeedFrame *ShmFeedWriter::begin_frame() {
+    ShmFeedFrame *frame = &feed->frames[next_index % SHM_FEED_SLOTS];
+    uint32_t generation = frame->generation.load(std::memory_order_relaxed);
+    frame->generation.store(generation + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    frame->index = next_index;
+    frame->layout = feed->layout.generation.load(std::memory_order_relaxed);
+    return frame;
+}
+
+/**
+ * @brief Completes the frame from begin_frame() and makes it the newest.
+ */
+void ShmFeedWriter::end_frame(ShmFeedFrame *frame) {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    frame->monotonic_ns = static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+
+    frame->generation.store(frame->generation.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    feed->published.store(++next_index, std::memory_order_release);
+}
+
+/**
+ * @brief Constructor that maps an existing feed.
+ * @param name POSIX shared-memory name the producer was started with.
+ * @throws std::runtime_error if the feed does not exist or is incompatible.
+ */
+ShmFeedReader::ShmFeedReader(const std::string &name) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Error: Cannot open shared memory '" + name + "': " + strerror(errno));
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(ShmFeedHeader)) {
+        close(fd);
+        throw std::runtime_error("Error: Shared memory '" + name + "' is not a compatible feed.");
+    }
+    void *mem = mmap(nullptr, sizeof(ShmFeedHeader), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        throw std::runtime_error("Error: Cannot map shared memory '" + name + "': " + strerror(errno));
+    }
+
+    feed = static_cast<const ShmFeedHeader *>(mem);
+    if (feed->magic != SHM_FEED_MAGIC || feed->version != SHM_FEED_VERSION ||
+        feed->slot_count != SHM_FEED_SLOTS || feed->max_bins != SHM_FEED_MAX_BINS) {
+        munmap(mem, sizeof(ShmFeedHeader));
+        throw std::runtime_error("Error: Shared memory '" + name + "' is not a compatible feed.");
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+}
+
+ShmFeedReader::~ShmFeedReader() {
+    munmap(const_cast<ShmFeedHeader *>(feed), sizeof(ShmFeedHeader));
+}
+
+/**
+ * @brief Number of frames the producer has published.
+ */
+uint64_t ShmFeedReader::published() const {
+    return feed->published.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief The frame with the given index, to be read in place.
+ * @param index Frame number, less than published().
+ * @param token Output, pass to valid() after reading.
+ * @return nullptr if the frame was already overwritten or is being written.
+ */
+const ShmFeedFrame *ShmFeedReader::frame(uint64_t index, uint32_t &token) const {
+    const ShmFeedFrame *frame = &feed->frames[index % SHM_FEED_SLOTS];
+    token = frame->generation.load(std::memory_order_acquire);
+    if ((token & 1) || frame->index != index) {
+        return nullptr;
+    }
+    return frame;
+}
+
+/**
+ * @brief The newest complete frame, to be read in place.
+ * @param index Output, the frame's number.
+ * @param token Output, pass to valid() after reading.
+ * @return nullptr if nothing has been published yet.
+ */
+const ShmFeedFrame *ShmFeedReader::latest(uint64_t &index, uint32_t &token) const {
+    uint64_t count = published();
+    if (count == 0) {
+        return nullptr;
+    }
+    index = count - 1;
+    return frame(index, token);
+}
+
+/**
+ * @brief True if the frame did not change while it was being read.
+ */
+bool ShmFeedReader::valid(const ShmFeedFrame *frame, uint32_t token) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return frame->generation.load(std::memory_order_relaxed) == token;
+}
+
+/**
+ * @brief The bin frequency table, to be read in place; check with layout_valid().
+ * @param token Output, pass to layout_valid() after reading.
+ */
+const ShmFeedLayout *ShmFeedReader::layout(uint32_t &token) const {
+    token = feed->layout.generation.load(std::memory_order_acquire);
+    return &feed->layout;
+}
+
+/**
+ * @brief True if the layout did not change while it was being read.
+ */
+bool ShmFeedReader::layout_valid(uint32_t token) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return !(token & 1) && feed->layout.generation.load(std::memory_order_relaxed) == token;
+}
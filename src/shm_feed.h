@@ -0,0 +1,192 @@
+#ifndef _SHM_FEED_H_
+#define _SHM_FEED_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "notes.h"
+
+// Shared-memory feed of every analysis frame, for local visualisers and loggers.
+//
+// The producer owns a POSIX shared-memory object holding a ring of frame
+// slots. Each slot is guarded by a seqlock: its generation is odd while the
+// producer writes it and even once the frame is complete. Readers map the
+// object read-only and read frames in place; afterwards they check that the
+// generation is unchanged and drop the frame if it is not. Readers never
+// write to the mapping, so any number of them can attach without the
+// producer noticing.
+//
+// This header only depends on notes.h so other programs can use the reader.
+
+#define SHM_FEED_MAGIC    0x46534843u // "CHSF"
+#define SHM_FEED_VERSION  1
+#define SHM_FEED_SLOTS    8
+#define SHM_FEED_MAX_BINS 8193        // MAX_FFT_SIZE / 2 + 1
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+              "The feed needs address-free atomics to work across processes");
+
+/**
+ * @struct ShmFeedFrame
+ * @brief One analysis frame as published in shared memory.
+ */
+struct ShmFeedFrame {
+    std::atomic<uint32_t> generation; // Seqlock: odd while being written
+    uint32_t layout;                  // Bin layout generation the magnitudes use
+    uint64_t index;                   // Frame number since the producer started
+    uint64_t capture_seq;             // Capture block the frame was computed from
+    double stream_time;               // Audio stream time of that block (s)
+    int64_t monotonic_ns;             // CLOCK_MONOTONIC when published
+    float levels[NUM_NOTES];          // Detected notes, 0.0 - 1.0 per pitch class
+    float chroma[NUM_NOTES];          // Strongest bin magnitude per pitch class
+    float onset_strength;
+    float bpm;
+    float beat_phase;
+    uint32_t onset;                   // 1 if an onset was detected in this frame
+    int32_t peak_bin;                 // Strongest bin, 0 if below threshold
+    uint32_t num_bins;
+    float magnitudes[SHM_FEED_MAX_BINS];
+};
+
+/**
+ * @struct ShmFeedLayout
+ * @brief Centre frequency of every magnitude bin; changes when the analyzer is swapped.
+ */
+struct ShmFeedLayout {
+    std::atomic<uint32_t> generation; // Seqlock: odd while being written
+    uint32_t num_bins;
+    float bin_frequency[SHM_FEED_MAX_BINS];
+};
+
+/**
+ * @struct ShmFeedHeader
+ * @brief The whole shared-memory object.
+ */
+struct ShmFeedHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t max_bins;
+    std::atomic<uint64_t> published;  // Frames published so far; the newest is published - 1
+    ShmFeedLayout layout;
+    alignas(64) ShmFeedFrame frames[SHM_FEED_SLOTS];
+};
+
+/**
+ * @class ShmFeedWriter
+ * @brief Producer side: creates the shared-memory object and publishes frames into it.
+ *
+ * Frames are written in place (begin_frame() / end_frame()), so publishing
+ * costs no more than filling the fields. Single producer thread only.
+ */
+class ShmFeedWriter {
+public:
+    /**
+     * @brief Constructor that creates (or replaces) the shared-memory object.
+     * @param name POSIX shared-memory name, e.g. "/chromesthat".
+     * @throws std::runtime_error if the object cannot be created or mapped.
+     */
+    explicit ShmFeedWriter(const std::string &name);
+
+    /**
+     * @brief Destructor that unmaps and removes the shared-memory object.
+     */
+    ~ShmFeedWriter();
+
+    /**
+     * @brief Publishes a new bin layout. Call before the first frame that uses it.
+     * @param bin_frequency Centre frequency of every bin (Hz).
+     * @param num_bins Number of bins, at most SHM_FEED_MAX_BINS.
+     */
+    void set_layout(const float *bin_frequency, uint32_t num_bins);
+
+    /**
+     * @brief Starts writing the next frame slot.
+     * @return The slot to fill; readers will skip it until end_frame().
+     */
+    ShmFeedFrame *begin_frame();
+
+    /**
+     * @brief Completes the frame from begin_frame() and makes it the newest.
+     */
+    void end_frame(ShmFeedFrame *frame);
+
+    /**
+     * @brief Touches the whole mapping so publishing never page-faults.
+     */
+    void prefault();
+
+private:
+    std::string name;
+    ShmFeedHeader *feed;
+    uint64_t next_index;
+};
+
+/**
+ * @class ShmFeedReader
+ * @brief Consumer side: maps the feed read-only and reads frames in place.
+ *
+ * Typical use:
+ *
+ *   uint64_t index;
+ *   uint32_t token;
+ *   const ShmFeedFrame *frame = reader.latest(index, token);
+ *   ... read frame->levels, frame->magnitudes ...
+ *   if (reader.valid(frame, token)) { use what was read }
+ *
+ * No call makes a system call after the constructor.
+ */
+class ShmFeedReader {
+public:
+    /**
+     * @brief Constructor that maps an existing feed.
+     * @param name POSIX shared-memory name the producer was started with.
+     * @throws std::runtime_error if the feed does not exist or is incompatible.
+     */
+    explicit ShmFeedReader(const std::string &name);
+    ~ShmFeedReader();
+
+    /**
+     * @brief Number of frames the producer has published.
+     */
+    uint64_t published() const;
+
+    /**
+     * @brief The frame with the given index, to be read in place.
+     * @param index Frame number, less than published().
+     * @param token Output, pass to valid() after reading.
+     * @return nullptr if the frame was already overwritten or is being written.
+     */
+    const ShmFeedFrame *frame(uint64_t index, uint32_t &token) const;
+
+    /**
+     * @brief The newest complete frame, to be read in place.
+     * @param index Output, the frame's number.
+     * @param token Output, pass to valid() after reading.
+     * @return nullptr if nothing has been published yet.
+     */
+    const ShmFeedFrame *latest(uint64_t &index, uint32_t &token) const;
+
+    /**
+     * @brief True if the frame did not change while it was being read.
+     */
+    bool valid(const ShmFeedFrame *frame, uint32_t token) const;
+
+    /**
+     * @brief The bin frequency table, to be read in place; check with layout_valid().
+     * @param token Output, pass to layout_valid() after reading.
+     */
+    const ShmFeedLayout *layout(uint32_t &token) const;
+
+    /**
+     * @brief True if the layout did not change while it was being read.
+     */
+    bool layout_valid(uint32_t token) const;
+
+private:
+    const ShmFeedHeader *feed;
+};
+
+#endif // _SHM_FEED_H_
@@ -0,0 +1,232 @@
+#include "signal_corpus.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+#include "notes.h"
+
+// Peak amplitude of a tone's fundamental; chords stay well below full scale.
+#define TONE_AMPLITUDE 0.1
+// Harmonics per tone, at 1/h of the fundamental.
+#define TONE_HARMONICS 4
+// Attack and release ramp of every tone (s).
+#define TONE_RAMP 0.01
+// Length of each note or chord in the stepped signals, and the gap after it (s).
+#define STEP_SECONDS 0.5
+#define GAP_SECONDS 0.1
+// Drum pattern tempo.
+#define DRUM_BPM 120.0
+
+static double midi_frequency(double midi) {
+    return A4_FREQUENCY * std::pow(2.0, (midi - A4_MIDI_NUMBER) / 12.0);
+}
+
+static std::vector<float> silence(int sample_rate, double seconds) {
+    return std::vector<float>(static_cast<size_t>(seconds * sample_rate), 0.0f);
+}
+
+// Adds a harmonic tone whose pitch moves linearly in semitones from midi_from
+// to midi_to, with short ramps at both ends.
+static void add_tone(std::vector<float> &samples, int sample_rate, double start, double end,
+                     double midi_from, double midi_to) {
+    const size_t first = static_cast<size_t>(start * sample_rate);
+    const size_t last = std::min(samples.size(), static_cast<size_t>(end * sample_rate));
+    const double length = end - start;
+    double phase = 0;
+    for (size_t i = first; i < last; i++) {
+        const double t = static_cast<double>(i) / sample_rate - start;
+        const double freq = midi_frequency(midi_from + (midi_to - midi_from) * t / length);
+        const double ramp = std::min(1.0, std::min(t, length - t) / TONE_RAMP);
+        double s = 0;
+        for (int h = 1; h <= TONE_HARMONICS; h++) {
+            if (freq * h < sample_rate / 2) {
+                s += std::sin(phase * h) / h;
+            }
+        }
+        samples[i] += static_cast<float>(TONE_AMPLITUDE * ramp * s);
+        phase = std::fmod(phase + 2 * M_PI * freq / sample_rate, 2 * M_PI);
+    }
+}
+
+static void add_note(CorpusSignal &signal, int sample_rate, double start, double end, int midi) {
+    add_tone(signal.samples, sample_rate, start, end, midi, midi);
+    signal.labels.push_back({start, end, midi});
+}
+
+// A glissando, labelled with the span of time each semitone is the nearest one.
+static void add_glide(CorpusSignal &signal, int sample_rate, double start, double end, int midi_from, int midi_to) {
+    add_tone(signal.samples, sample_rate, start, end, midi_from, midi_to);
+    const double rate = (midi_to - midi_from) / (end - start); // Semitones per second
+    const int step = midi_to > midi_from ? 1 : -1;
+    for (int m = midi_from; m != midi_to + step; m += step) {
+        double t0 = start + (m - 0.5 * step - midi_from) / rate;
+        double t1 = start + (m + 0.5 * step - midi_from) / rate;
+        signal.labels.push_back({std::max(start, t0), std::min(end, t1), m});
+    }
+}
+
+// Triads stepping round the circle of fifths, major and minor in turn, with
+// the root in the octave above C3 and the upper notes voiced above it.
+static CorpusSignal chord_sequence(const std::string &name, const std::string &category, int sample_rate,
+                                   int chords) {
+    CorpusSignal signal = {name, category, silence(sample_rate, chords * (STEP_SECONDS + GAP_SECONDS)), {}};
+    for (int c = 0; c < chords; c++) {
+        const double start = c * (STEP_SECONDS + GAP_SECONDS);
+        const int root = 48 + (c * 7) % 12;
+        const int third = c & 1 ? 3 : 4;
+        for (int interval : {0, third, 7}) {
+            add_note(signal, sample_rate, start, start + STEP_SECONDS, root + interval);
+        }
+    }
+    return signal;
+}
+
+static void add_noise(std::vector<float> &samples, double snr_db, std::mt19937 &rng) {
+    double power = 0;
+    for (float s : samples) {
+        power += static_cast<double>(s) * s;
+    }
+    const double rms = std::sqrt(power / std::max<size_t>(1, samples.size()));
+    std::normal_distribution<float> noise(0.0f, static_cast<float>(rms / std::pow(10.0, snr_db / 20.0)));
+    for (float &s : samples) {
+        s += noise(rng);
+    }
+}
+
+// Kick on every beat, snare on two and four, closed hi-hat on every eighth.
+static void add_drums(std::vector<float> &samples, int sample_rate, std::mt19937 &rng) {
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    const double beat = 60.0 / DRUM_BPM;
+    const double length = static_cast<double>(samples.size()) / sample_rate;
+    for (int eighth = 0; eighth * beat / 2 < length; eighth++) {
+        const size_t first = static_cast<size_t>(eighth * beat / 2 * sample_rate);
+        const size_t last = std::min(samples.size(), first + static_cast<size_t>(0.3 * sample_rate));
+        const bool kick = eighth % 2 == 0;
+        const bool snare = eighth % 4 == 2;
+        double phase = 0;
+        float previous = 0;
+        for (size_t i = first; i < last; i++) {
+            const double t = static_cast<double>(i - first) / sample_rate;
+            const float n = noise(rng);
+            double s = 0.1 * (n - previous) * std::exp(-t * 80); // Hi-hat: differenced noise
+            previous = n;
+            if (kick) {
+                phase += 2 * M_PI * (50 + 70 * std::exp(-t * 30)) / sample_rate;
+                s += 0.5 * std::sin(phase) * std::exp(-t * 12);
+            }
+            if (snare) {
+                s += (0.2 * n + 0.2 * std::sin(2 * M_PI * 190 * t)) * std::exp(-t * 25);
+            }
+            samples[i] += static_cast<float>(s);
+        }
+    }
+}
+
+/**
+ * @brief Generates the test corpus: single notes, chords, glissandi, chords in
+ * noise at set SNRs, and drums over sustained tones.
+ * @param sample_rate Rate of the generated samples in Hz.
+ * @param seed Seed for the noise and drum generators.
+ */
+std::vector<CorpusSignal> generate_corpus(int sample_rate, unsigned seed) {
+    std::vector<CorpusSignal> corpus;
+    std::mt19937 rng(seed);
+
+    // One note at a time from E2 up to G6.
+    const int singles[] = {40, 45, 50, 55, 59, 64, 69, 74, 79, 84, 91};
+    const int num_singles = sizeof(singles) / sizeof(singles[0]);
+    CorpusSignal single = {"single-notes", "single", silence(sample_rate, num_singles * (STEP_SECONDS + GAP_SECONDS)), {}};
+    for (int i = 0; i < num_singles; i++) {
+        const double start = i * (STEP_SECONDS + GAP_SECONDS);
+        add_note(single, sample_rate, start, start + STEP_SECONDS, singles[i]);
+    }
+    corpus.push_back(single);
+
+    corpus.push_back(chord_sequence("chords", "chord", sample_rate, 12));
+
+    CorpusSignal glide_up = {"glide-up", "glide", silence(sample_rate, 4.0), {}};
+    add_glide(glide_up, sample_rate, 0.0, 4.0, 48, 72);
+    corpus.push_back(glide_up);
+    CorpusSignal glide_down = {"glide-down", "glide", silence(sample_rate, 4.0), {}};
+    add_glide(glide_down, sample_rate, 0.0, 4.0, 84, 66);
+    corpus.push_back(glide_down);
+
+    for (int snr : {20, 10, 0}) {
+        const std::string name = "chords-noise-" + std::to_string(snr) + "db";
+        CorpusSignal noisy = chord_sequence(name, "noise", sample_rate, 8);
+        add_noise(noisy.samples, snr, rng);
+        corpus.push_back(noisy);
+    }
+
+    // Sustained chords under a drum pattern, and the drums alone.
+    CorpusSignal drums = {"drums-over-chords", "drums", silence(sample_rate, 6.0), {}};
+    for (int c = 0; c < 3; c++) {
+        const int root = 48 + c * 5;
+        for (int interval : {0, 4, 7}) {
+            add_note(drums, sample_rate, c * 2.0, c * 2.0 + 1.9, root + interval);
+        }
+    }
+    add_drums(drums.samples, sample_rate, rng);
+    corpus.push_back(drums);
+    CorpusSignal drums_only = {"drums-only", "drums", silence(sample_rate, 4.0), {}};
+    add_drums(drums_only.samples, sample_rate, rng);
+    corpus.push_back(drums_only);
+
+    return corpus;
+}
+
+static void put_u16(std::ofstream &out, uint16_t v) {
+    const char bytes[2] = {static_cast<char>(v & 0xff), static_cast<char>(v >> 8)};
+    out.write(bytes, 2);
+}
+
+static void put_u32(std::ofstream &out, uint32_t v) {
+    put_u16(out, static_cast<uint16_t>(v & 0xffff));
+    put_u16(out, static_cast<uint16_t>(v >> 16));
+}
+
+/**
+ * @brief Writes each signal as NAME.wav (32-bit float mono) and NAME.labels
+ * ("start end midi" per line) in a directory, for chromesthat_bench and other tools.
+ * @throws std::runtime_error if a file cannot be written.
+ */
+void write_corpus(const std::vector<CorpusSignal> &corpus, int sample_rate, const std::string &dir) {
+    for (const CorpusSignal &signal : corpus) {
+        const std::string base = dir + "/" + signal.name;
+        std::ofstream wav(base + ".wav", std::ios::binary);
+        if (!wav) {
+            throw std::runtime_error("Error: Cannot write '" + base + ".wav'.");
+        }
+        const uint32_t data_bytes = static_cast<uint32_t>(signal.samples.size() * sizeof(float));
+        wav.write("RIFF", 4);
+        put_u32(wav, 36 + data_bytes);
+        wav.write("WAVEfmt ", 8);
+        put_u32(wav, 16);
+        put_u16(wav, 3);                // IEEE float
+        put_u16(wav, 1);                // Mono
+        put_u32(wav, static_cast<uint32_t>(sample_rate));
+        put_u32(wav, static_cast<uint32_t>(sample_rate * sizeof(float)));
+        put_u16(wav, sizeof(float));
+        put_u16(wav, 32);
+        wav.write("data", 4);
+        put_u32(wav, data_bytes);
+        for (float s : signal.samples) {
+            uint32_t bits;
+            std::memcpy(&bits, &s, sizeof(bits));
+            put_u32(wav, bits);
+        }
+
+        std::ofstream labels(base + ".labels");
+        for (const NoteLabel &label : signal.labels) {
+            labels << label.start << ' ' << label.end << ' ' << label.midi << '\n';
+        }
+        if (!wav || !labels) {
+            throw std::runtime_error("Error: Cannot write the corpus to '" + dir + "'.");
+        }
+    }
+}
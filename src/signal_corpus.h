@@ -0,0 +1,45 @@
+#ifndef _SIGNAL_CORPUS_H_
+#define _SIGNAL_CORPUS_H_
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief A note known to sound in a corpus signal.
+ */
+struct NoteLabel {
+    double start;   // Seconds from the start of the signal
+    double end;
+    int midi;       // MIDI note number of the fundamental
+};
+
+/**
+ * @brief One labelled test signal.
+ */
+struct CorpusSignal {
+    std::string name;       // e.g. "chord-noise-10db"; also the file name written by write_corpus()
+    std::string category;   // single, chord, glide, noise or drums
+    std::vector<float> samples;
+    std::vector<NoteLabel> labels;
+};
+
+/**
+ * @brief Generates the test corpus: single notes, chords, glissandi, chords in
+ * noise at set SNRs, and drums over sustained tones.
+ *
+ * Tones have a few harmonics and short attack and release ramps; only their
+ * fundamentals are labelled. Drum hits are unlabelled, so any note they
+ * trigger counts against the detector. The same seed gives the same corpus.
+ * @param sample_rate Rate of the generated samples in Hz.
+ * @param seed Seed for the noise and drum generators.
+ */
+std::vector<CorpusSignal> generate_corpus(int sample_rate, unsigned seed = 1);
+
+/**
+ * @brief Writes each signal as NAME.wav (32-bit float mono) and NAME.labels
+ * ("start end midi" per line) in a directory, for chromesthat_bench and other tools.
+ * @throws std::runtime_error if a file cannot be written.
+ */
+void write_corpus(const std::vector<CorpusSignal> &corpus, int sample_rate, const std::string &dir);
+
+#endif // _SIGNAL_CORPUS_H_
@@ -0,0 +1,342 @@
+#include "spectrum_log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+// Bins per Rice-coded group, and the bits that store each group's parameter.
+#define GROUP_BINS 16
+#define PARAMETER_BITS 5
+
+// Caps what a corrupt chunk header can make the reader allocate.
+#define MAX_PAYLOAD_SIZE (256u << 20)
+
+namespace {
+
+// LSB-first bit packer.
+class BitWriter {
+public:
+    explicit BitWriter(uint8_t *out) : start(out), out(out), acc(0), count(0) {}
+
+    void put(uint32_t value, int bits) {
+        acc |= static_cast<uint64_t>(value) << count;
+        count += bits;
+        while (count >= 8) {
+            *out++ = static_cast<uint8_t>(acc);
+            acc >>= 8;
+            count -= 8;
+        }
+    }
+
+    void put_unary(uint32_t q) {
+        for (; q >= 24; q -= 24) {
+            put(0xffffff, 24);
+        }
+        put((1u << q) - 1, q + 1);   // q ones, then a zero
+    }
+
+    size_t finish() {
+        if (count > 0) {
+            *out++ = static_cast<uint8_t>(acc);
+        }
+        return static_cast<size_t>(out - start);
+    }
+
+private:
+    uint8_t *start;
+    uint8_t *out;
+    uint64_t acc;
+    int count;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t *in, size_t size) : in(in), end(in + size), acc(0), count(0) {}
+
+    bool get(int bits, uint32_t &value) {
+        while (count < bits) {
+            if (in == end) {
+                return false;
+            }
+            acc |= static_cast<uint64_t>(*in++) << count;
+            count += 8;
+        }
+        value = static_cast<uint32_t>(acc & ((uint64_t(1) << bits) - 1));
+        acc >>= bits;
+        count -= bits;
+        return true;
+    }
+
+    bool get_unary(uint32_t limit, uint32_t &q) {
+        q = 0;
+        for (;;) {
+            uint32_t bit;
+            if (!get(1, bit)) {
+                return false;
+            }
+            if (!bit) {
+                return true;
+            }
+            if (++q > limit) {
+                return false;
+            }
+        }
+    }
+
+private:
+    const uint8_t *in;
+    const uint8_t *end;
+    uint64_t acc;
+    int count;
+};
+
+inline uint32_t zigzag(int32_t v) { return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31); }
+inline int32_t unzigzag(uint32_t u) { return static_cast<int32_t>(u >> 1) ^ -static_cast<int32_t>(u & 1); }
+
+} // namespace
+
+/**
+ * @brief Largest output spectrum_log_encode() can produce.
+ */
+size_t spectrum_log_max_coded(int frames, int bins, int bits) {
+    // With the parameter at bits + 1 every value fits in bits + 2 bits, and the
+    // encoder never picks a parameter that costs more than that.
+    const size_t groups = static_cast<size_t>(bins + GROUP_BINS - 1) / GROUP_BINS;
+    return (static_cast<size_t>(frames) * groups * (1 + PARAMETER_BITS + GROUP_BINS * (bits + 2)) + 7) / 8 + 8;
+}
+
+/**
+ * @brief Codes a block of quantised spectra.
+ * @param values frames * bins quantised values, frame after frame.
+ * @param frames Frames in the block.
+ * @param bins Values per frame.
+ * @param bits 8 or 16.
+ * @param out Output, at least spectrum_log_max_coded() bytes.
+ * @return Bytes written to out.
+ */
+size_t spectrum_log_encode(const uint16_t *values, int frames, int bins, int bits, uint8_t *out) {
+    BitWriter writer(out);
+    uint32_t u[GROUP_BINS];
+    for (int f = 0; f < frames; f++) {
+        const uint16_t *cur = values + static_cast<size_t>(f) * bins;
+        const uint16_t *prev = f > 0 ? cur - bins : nullptr;
+        for (int g = 0; g < bins; g += GROUP_BINS) {
+            const int n = std::min(GROUP_BINS, bins - g);
+            uint32_t any = 0;
+            for (int i = 0; i < n; i++) {
+                u[i] = zigzag(static_cast<int32_t>(cur[g + i]) - (prev ? prev[g + i] : 0));
+                any |= u[i];
+            }
+            if (!any) {
+                writer.put(0, 1);
+                continue;
+            }
+
+            // The Rice parameter with the fewest bits for this group.
+            int best_k = 0;
+            uint64_t best_cost = ~uint64_t(0);
+            for (int k = 0; k <= bits + 1; k++) {
+                uint64_t cost = static_cast<uint64_t>(n) * (k + 1);
+                for (int i = 0; i < n; i++) {
+                    cost += u[i] >> k;
+                }
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_k = k;
+                }
+            }
+
+            writer.put(1, 1);
+            writer.put(static_cast<uint32_t>(best_k), PARAMETER_BITS);
+            for (int i = 0; i < n; i++) {
+                writer.put_unary(u[i] >> best_k);
+                writer.put(u[i] & ((1u << best_k) - 1), best_k);
+            }
+        }
+    }
+    return writer.finish();
+}
+
+/**
+ * @brief Decodes spectra coded by spectrum_log_encode().
+ * @param values Output, frames * bins values.
+ * @return False if the data is malformed or too short.
+ */
+bool spectrum_log_decode(const uint8_t *in, size_t size, int frames, int bins, int bits, uint16_t *values) {
+    BitReader reader(in, size);
+    const int32_t max_value = (1 << bits) - 1;
+    for (int f = 0; f < frames; f++) {
+        uint16_t *cur = values + static_cast<size_t>(f) * bins;
+        const uint16_t *prev = f > 0 ? cur - bins : nullptr;
+        for (int g = 0; g < bins; g += GROUP_BINS) {
+            const int n = std::min(GROUP_BINS, bins - g);
+            uint32_t changed, k;
+            if (!reader.get(1, changed)) {
+                return false;
+            }
+            if (!changed) {
+                for (int i = 0; i < n; i++) {
+                    cur[g + i] = prev ? prev[g + i] : 0;
+                }
+                continue;
+            }
+            if (!reader.get(PARAMETER_BITS, k) || k > static_cast<uint32_t>(bits) + 1) {
+                return false;
+            }
+            for (int i = 0; i < n; i++) {
+                uint32_t q, r = 0;
+                if (!reader.get_unary(1u << (bits + 2 - k), q) || (k > 0 && !reader.get(k, r))) {
+                    return false;
+                }
+                int32_t v = (prev ? prev[g + i] : 0) + unzigzag((q << k) | r);
+                if (v < 0 || v > max_value) {
+                    return false;
+                }
+                cur[g + i] = static_cast<uint16_t>(v);
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Constructor that opens the log and reads (or rebuilds) its index.
+ * @throws std::runtime_error if the file cannot be read or is not a spectrum log.
+ */
+SpectrumLogReader::SpectrumLogReader(const std::string &path)
+    : has_index(false), layout_offset(0), bins(0) {
+    file = fopen(path.c_str(), "rb");
+    if (!file) {
+        throw std::runtime_error("Error: Cannot open spectrum log '" + path + "'.");
+    }
+    if (fread(&file_header, sizeof(file_header), 1, file) != 1 ||
+        std::memcmp(file_header.magic, SPECTRUM_LOG_MAGIC, sizeof(file_header.magic)) != 0) {
+        fclose(file);
+        throw std::runtime_error("Error: '" + path + "' is not a spectrum log.");
+    }
+    if (file_header.version != SPECTRUM_LOG_VERSION || (file_header.bits != 8 && file_header.bits != 16)) {
+        fclose(file);
+        throw std::runtime_error("Error: Unsupported spectrum log version " +
+                                 std::to_string(file_header.version) + " in '" + path + "'.");
+    }
+
+    has_index = read_index();
+    if (!has_index) {
+        rebuild_index();
+    }
+}
+
+SpectrumLogReader::~SpectrumLogReader() {
+    fclose(file);
+}
+
+// Loads the index written on a clean stop; false if there is none.
+bool SpectrumLogReader::read_index() {
+    SpectrumLogTrailer trailer;
+    if (fseek(file, -static_cast<long>(sizeof(trailer)), SEEK_END) != 0) {
+        return false;
+    }
+    const long trailer_offset = ftell(file);
+    if (fread(&trailer, sizeof(trailer), 1, file) != 1 ||
+        std::memcmp(trailer.magic, SPECTRUM_LOG_INDEX_MAGIC, sizeof(trailer.magic)) != 0 ||
+        trailer.index_offset + trailer.entries * sizeof(SpectrumLogIndexEntry) != static_cast<uint64_t>(trailer_offset)) {
+        return false;
+    }
+    index.resize(trailer.entries);
+    return fseek(file, static_cast<long>(trailer.index_offset), SEEK_SET) == 0 &&
+           (index.empty() || fread(index.data(), sizeof(SpectrumLogIndexEntry), index.size(), file) == index.size());
+}
+
+// Walks the chunks of a log that was cut short, up to the first incomplete one.
+void SpectrumLogReader::rebuild_index() {
+    index.clear();
+    uint64_t offset = sizeof(SpectrumLogHeader);
+    uint64_t layout = 0;
+    SpectrumLogChunk chunk;
+    while (fseek(file, static_cast<long>(offset), SEEK_SET) == 0 && fread(&chunk, sizeof(chunk), 1, file) == 1) {
+        const uint64_t next = offset + sizeof(chunk) + chunk.payload_size;
+        if (chunk.payload_size > MAX_PAYLOAD_SIZE || fseek(file, static_cast<long>(next) - 1, SEEK_SET) != 0 ||
+            fgetc(file) == EOF) {
+            break;
+        }
+        if (chunk.type == SPECTRUM_LOG_LAYOUT) {
+            layout = offset;
+        } else if (chunk.type == SPECTRUM_LOG_BLOCK && layout != 0) {
+            SpectrumLogIndexEntry entry;
+            entry.time_ns = chunk.time_ns;
+            entry.offset = offset;
+            entry.layout_offset = layout;
+            index.push_back(entry);
+        }
+        offset = next;
+    }
+}
+
+/**
+ * @brief The last block starting at or before time_ns (the first if none does).
+ */
+size_t SpectrumLogReader::find_block(uint64_t time_ns) const {
+    auto it = std::upper_bound(index.begin(), index.end(), time_ns,
+                               [](uint64_t t, const SpectrumLogIndexEntry &e) { return t < e.time_ns; });
+    return it == index.begin() ? 0 : static_cast<size_t>(it - index.begin()) - 1;
+}
+
+bool SpectrumLogReader::read_layout(uint64_t offset) {
+    if (offset == layout_offset && !frequencies.empty()) {
+        return true;
+    }
+    SpectrumLogChunk chunk;
+    if (fseek(file, static_cast<long>(offset), SEEK_SET) != 0 || fread(&chunk, sizeof(chunk), 1, file) != 1 ||
+        chunk.type != SPECTRUM_LOG_LAYOUT || chunk.payload_size > MAX_PAYLOAD_SIZE ||
+        chunk.payload_size % sizeof(float) != 0) {
+        return false;
+    }
+    frequencies.resize(chunk.payload_size / sizeof(float));
+    if (!frequencies.empty() && fread(frequencies.data(), sizeof(float), frequencies.size(), file) != frequencies.size()) {
+        frequencies.clear();
+        return false;
+    }
+    layout_offset = offset;
+    return true;
+}
+
+/**
+ * @brief Loads and decodes one block.
+ * @return False if the block is truncated or corrupt.
+ */
+bool SpectrumLogReader::read_block(size_t block) {
+    frames.clear();
+    block_events.clear();
+    if (block >= index.size() || !read_layout(index[block].layout_offset)) {
+        return false;
+    }
+
+    SpectrumLogChunk chunk;
+    SpectrumLogBlock info;
+    if (fseek(file, static_cast<long>(index[block].offset), SEEK_SET) != 0 ||
+        fread(&chunk, sizeof(chunk), 1, file) != 1 || chunk.type != SPECTRUM_LOG_BLOCK ||
+        fread(&info, sizeof(info), 1, file) != 1 || info.num_bins != frequencies.size() ||
+        sizeof(info) + static_cast<uint64_t>(info.frame_count) * sizeof(SpectrumLogFrame) +
+            static_cast<uint64_t>(info.event_count) * sizeof(SpectrumLogEvent) + info.spectra_size !=
+            chunk.payload_size ||
+        chunk.payload_size > MAX_PAYLOAD_SIZE) {
+        return false;
+    }
+
+    frames.resize(info.frame_count);
+    block_events.resize(info.event_count);
+    coded.resize(info.spectra_size);
+    bins = static_cast<int>(info.num_bins);
+    values.resize(static_cast<size_t>(info.frame_count) * bins);
+    if ((!frames.empty() && fread(frames.data(), sizeof(SpectrumLogFrame), frames.size(), file) != frames.size()) ||
+        (!block_events.empty() &&
+         fread(block_events.data(), sizeof(SpectrumLogEvent), block_events.size(), file) != block_events.size()) ||
+        (!coded.empty() && fread(coded.data(), 1, coded.size(), file) != coded.size()) ||
+        !spectrum_log_decode(coded.data(), coded.size(), num_frames(), bins, static_cast<int>(file_header.bits),
+                             values.data())) {
+        frames.clear();
+        block_events.clear();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,202 @@
+#ifndef _SPECTRUM_LOG_H_
+#define _SPECTRUM_LOG_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Compact archive of what the analyzer saw: every spectrum as quantised log
+// magnitude, with the detected notes, beats, chords and keys alongside.
+// Written by SpectrumRecorder, read back by chromesthat_review. Layout (host
+// byte order, little-endian on every target we build for):
+//
+//   SpectrumLogHeader
+//   { SpectrumLogChunk, payload[payload_size] } ...
+//   SpectrumLogIndexEntry[entries], SpectrumLogTrailer   (written on a clean stop)
+//
+// A LAYOUT chunk holds one float bin frequency (Hz) per bin. It comes before
+// the first block and again whenever the analyzer changes. A BLOCK chunk holds
+// up to frames_per_block frames with the same layout:
+//
+//   SpectrumLogBlock
+//   SpectrumLogFrame[frame_count]
+//   SpectrumLogEvent[event_count]
+//   coded spectra[spectra_size]       (see spectrum_log_encode())
+//
+// Each spectrum bin is quantised as round((dB - floor_db) / step_db), clamped
+// to 0 .. 2^bits - 1; 0 means at or below the floor. Blocks are coded
+// independently, so the index can seek straight to one. A log cut short
+// without its index is still readable: the reader rebuilds the index by
+// walking the chunks.
+
+#define SPECTRUM_LOG_MAGIC         "CHRMSPEC"
+#define SPECTRUM_LOG_INDEX_MAGIC   "CHRMSIDX"
+#define SPECTRUM_LOG_VERSION       1
+
+enum SpectrumLogChunkType {
+    SPECTRUM_LOG_LAYOUT = 0,
+    SPECTRUM_LOG_BLOCK = 1
+};
+
+// SpectrumLogFrame flags.
+#define SPECTRUM_LOG_ONSET 0x01     // The rhythm tracker detected an onset
+#define SPECTRUM_LOG_BEAT  0x02     // The beat phase wrapped: a beat fell in this frame
+
+struct SpectrumLogHeader {
+    char magic[8];              // SPECTRUM_LOG_MAGIC, not NUL-terminated
+    uint32_t version;
+    uint32_t bits;              // 8 or 16 per quantised bin
+    int64_t start_unix_ns;      // Wall clock when recording started
+    float floor_db;             // Level of quantised value 0
+    float step_db;              // dB per quantisation step
+    uint32_t frames_per_block;
+    uint32_t reserved;
+};
+
+struct SpectrumLogChunk {
+    uint32_t type;              // SpectrumLogChunkType
+    uint32_t payload_size;
+    uint64_t time_ns;           // Stream time of the first frame after it, since the start
+};
+
+struct SpectrumLogBlock {
+    uint32_t frame_count;
+    uint32_t event_count;
+    uint32_t num_bins;
+    uint32_t spectra_size;      // Bytes of coded spectra
+};
+
+struct SpectrumLogFrame {
+    uint64_t time_ns;           // Stream time since the start of the recording
+    uint64_t seq;               // Capture block the spectrum was computed from
+    float bpm;
+    uint8_t flags;              // SPECTRUM_LOG_ONSET, SPECTRUM_LOG_BEAT
+    uint8_t chord;              // HarmonyEstimator chord index, HARMONY_NO_CHORD if none
+    uint8_t key;                // HarmonyEstimator key index
+    uint8_t reserved;
+};
+
+struct SpectrumLogEvent {
+    uint64_t time_ns;           // Stream time of the onset (on) or release (off)
+    uint32_t id;                // Same for the on and off of one note
+    uint8_t type;               // NoteEventType
+    uint8_t midi;
+    uint16_t reserved;
+    float value;                // Hz for a note-on, seconds held for a note-off
+    uint32_t reserved2;
+};
+
+struct SpectrumLogIndexEntry {
+    uint64_t time_ns;           // Time of the block's first frame
+    uint64_t offset;            // File offset of the block's chunk
+    uint64_t layout_offset;     // File offset of the LAYOUT chunk in force
+};
+
+struct SpectrumLogTrailer {
+    char magic[8];              // SPECTRUM_LOG_INDEX_MAGIC
+    uint64_t index_offset;
+    uint64_t entries;
+};
+
+static_assert(sizeof(SpectrumLogHeader) == 40 && sizeof(SpectrumLogChunk) == 16 &&
+              sizeof(SpectrumLogBlock) == 16 && sizeof(SpectrumLogFrame) == 24 &&
+              sizeof(SpectrumLogEvent) == 24 && sizeof(SpectrumLogIndexEntry) == 24 &&
+              sizeof(SpectrumLogTrailer) == 24, "Spectrum log structs must have no padding");
+
+/**
+ * @brief Largest output spectrum_log_encode() can produce.
+ */
+size_t spectrum_log_max_coded(int frames, int bins, int bits);
+
+/**
+ * @brief Codes a block of quantised spectra.
+ *
+ * Every bin is coded as its change from the previous frame (the first frame
+ * from zero), zigzagged and Rice-coded in groups of 16 bins with the best
+ * parameter per group. A group that did not change costs one bit, so the
+ * quiet bins below the floor are almost free.
+ * @param values frames * bins quantised values, frame after frame.
+ * @param frames Frames in the block.
+ * @param bins Values per frame.
+ * @param bits 8 or 16.
+ * @param out Output, at least spectrum_log_max_coded() bytes.
+ * @return Bytes written to out.
+ */
+size_t spectrum_log_encode(const uint16_t *values, int frames, int bins, int bits, uint8_t *out);
+
+/**
+ * @brief Decodes spectra coded by spectrum_log_encode().
+ * @param values Output, frames * bins values.
+ * @return False if the data is malformed or too short.
+ */
+bool spectrum_log_decode(const uint8_t *in, size_t size, int frames, int bins, int bits, uint16_t *values);
+
+/**
+ * @class SpectrumLogReader
+ * @brief Reads a spectrum log a block at a time, in any order.
+ */
+class SpectrumLogReader {
+public:
+    /**
+     * @brief Constructor that opens the log and reads (or rebuilds) its index.
+     * @throws std::runtime_error if the file cannot be read or is not a spectrum log.
+     */
+    explicit SpectrumLogReader(const std::string &path);
+    ~SpectrumLogReader();
+
+    const SpectrumLogHeader &header() const { return file_header; }
+
+    /**
+     * @brief False if the log has no index (recording cut short) and it was rebuilt.
+     */
+    bool indexed() const { return has_index; }
+
+    size_t num_blocks() const { return index.size(); }
+    const SpectrumLogIndexEntry &block_entry(size_t block) const { return index[block]; }
+
+    /**
+     * @brief The last block starting at or before time_ns (the first if none does).
+     */
+    size_t find_block(uint64_t time_ns) const;
+
+    /**
+     * @brief Loads and decodes one block.
+     * @return False if the block is truncated or corrupt.
+     */
+    bool read_block(size_t block);
+
+    // The block loaded by read_block().
+    int num_frames() const { return static_cast<int>(frames.size()); }
+    int num_bins() const { return bins; }
+    const SpectrumLogFrame &frame(int f) const { return frames[f]; }
+    const uint16_t *spectrum(int f) const { return &values[static_cast<size_t>(f) * bins]; }
+    const std::vector<SpectrumLogEvent> &events() const { return block_events; }
+    const std::vector<float> &bin_frequency() const { return frequencies; }
+
+    /**
+     * @brief The level in dB a quantised value stands for.
+     */
+    double level_db(uint16_t value) const { return file_header.floor_db + value * file_header.step_db; }
+
+private:
+    FILE *file;
+    SpectrumLogHeader file_header;
+    bool has_index;
+    std::vector<SpectrumLogIndexEntry> index;
+
+    uint64_t layout_offset;     // LAYOUT chunk frequencies was read from
+    std::vector<float> frequencies;
+    int bins;
+    std::vector<SpectrumLogFrame> frames;
+    std::vector<SpectrumLogEvent> block_events;
+    std::vector<uint16_t> values;
+    std::vector<uint8_t> coded;
+
+    bool read_index();
+    void rebuild_index();
+    bool read_layout(uint64_t offset);
+};
+
+#endif // _SPECTRUM_LOG_H_
@@ -0,0 +1,272 @@
+#include "spectrum_recorder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "realtime.h"
+
+// Frames in flight between the feature stage and the writer (about 1.5 s at 86 fps).
+#define RECORDER_BUFFERS 128
+
+// Frames per coded block (about 3 s at 86 fps): the unit of seeking, and the
+// most a crash can lose.
+#define FRAMES_PER_BLOCK 256
+
+// The quantisation floor sits this far below the detection threshold, so the
+// archive shows what was nearly detected too.
+#define FLOOR_BELOW_THRESHOLD_DB 24.0f
+
+// dB per quantisation step: 8 bits span 127.5 dB, 16 bits 655 dB.
+#define STEP_DB_8  0.5f
+#define STEP_DB_16 0.01f
+
+// How often the writer flushes to the file.
+#define FLUSH_INTERVAL_MS 1000
+
+// How long the idle writer waits before re-checking for stop().
+#define WRITER_WAIT_MS 100
+
+/**
+ * @brief Constructor that creates the log file and writes its header.
+ * @param path File to write; an existing file is replaced.
+ * @param bits 8 or 16 bits per quantised bin.
+ * @param max_bins Most bins any analyzer produces.
+ * @param min_magnitude Detection threshold; the quantisation floor is set below it.
+ * @throws std::runtime_error if the file cannot be created.
+ */
+SpectrumRecorder::SpectrumRecorder(const std::string &path, int bits, int max_bins, double min_magnitude)
+    : bits(bits),
+      floor_db(20.0f * std::log10(static_cast<float>(std::max(min_magnitude, 1e-6))) - FLOOR_BELOW_THRESHOLD_DB),
+      step_db(bits == 8 ? STEP_DB_8 : STEP_DB_16),
+      queue(RECORDER_BUFFERS, DROP_NEWEST, [max_bins](SpectrumRecord &r) {
+          r.num_events = 0;
+          r.magnitudes.resize(max_bins);
+          r.bin_frequency.resize(max_bins);
+      }),
+      writer("spectrum-log", [this]() { write_step(); }),
+      started(false), failed(false), finished(false), start_time(0), last_beat_phase(0),
+      file_offset(0), layout_offset(0), block_bins(0),
+      block_values(static_cast<size_t>(FRAMES_PER_BLOCK) * max_bins),
+      coded(spectrum_log_max_coded(FRAMES_PER_BLOCK, max_bins, bits)) {
+
+    if (bits != 8 && bits != 16) {
+        throw std::runtime_error("Error: Spectrum logs store 8 or 16 bits per bin, not " + std::to_string(bits) + ".");
+    }
+    block_frames.reserve(FRAMES_PER_BLOCK);
+    block_events.reserve(FRAMES_PER_BLOCK * 2);
+
+    file = fopen(path.c_str(), "wb");
+    if (!file) {
+        throw std::runtime_error("Error: Cannot create spectrum log '" + path + "'.");
+    }
+
+    SpectrumLogHeader header;
+    std::memcpy(header.magic, SPECTRUM_LOG_MAGIC, sizeof(header.magic));
+    header.version = SPECTRUM_LOG_VERSION;
+    header.bits = static_cast<uint32_t>(bits);
+    header.start_unix_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    header.floor_db = floor_db;
+    header.step_db = step_db;
+    header.frames_per_block = FRAMES_PER_BLOCK;
+    header.reserved = 0;
+    if (fwrite(&header, sizeof(header), 1, file) != 1) {
+        fclose(file);
+        throw std::runtime_error("Error: Cannot write spectrum log '" + path + "'.");
+    }
+    file_offset = sizeof(header);
+    last_flush = clock::now();
+}
+
+/**
+ * @brief Destructor that writes out queued frames and the index, and closes the file.
+ */
+SpectrumRecorder::~SpectrumRecorder() {
+    stop();
+    fclose(file);
+}
+
+/**
+ * @brief Starts the writer thread.
+ */
+void SpectrumRecorder::start(std::function<void()> init) {
+    writer.start(init);
+}
+
+/**
+ * @brief Stops the writer thread after it has written every queued frame, then writes the index.
+ */
+void SpectrumRecorder::stop() {
+    writer.stop();
+    if (finished) {
+        return;
+    }
+    SpectrumRecord *record;
+    while ((record = queue.try_receive()) != nullptr) {
+        add_record(*record);
+        queue.release(record);
+    }
+    write_block();
+    write_index();
+    fflush(file);
+    finished = true;
+}
+
+/**
+ * @brief Touches every pooled buffer so it is resident before streaming starts.
+ */
+void SpectrumRecorder::prefault() {
+    queue.for_each([](SpectrumRecord &r) {
+        realtime_prefault(r.magnitudes.data(), r.magnitudes.size() * sizeof(float));
+        realtime_prefault(r.bin_frequency.data(), r.bin_frequency.size() * sizeof(float));
+    });
+}
+
+void SpectrumRecorder::write_step() {
+    SpectrumRecord *record = queue.receive(WRITER_WAIT_MS);
+    if (record) {
+        add_record(*record);
+        queue.release(record);
+    }
+
+    clock::time_point now = clock::now();
+    if (now - last_flush >= std::chrono::milliseconds(FLUSH_INTERVAL_MS)) {
+        fflush(file);
+        last_flush = now;
+    }
+}
+
+void SpectrumRecorder::add_record(const SpectrumRecord &record) {
+    if (failed) {
+        return;
+    }
+    if (!started) {
+        start_time = record.stream_time;
+        started = true;
+    }
+    if (record.new_layout || record.num_bins != block_bins) {
+        write_block();
+        write_layout(record);
+    }
+
+    SpectrumLogFrame frame;
+    frame.time_ns = static_cast<uint64_t>(std::max(0.0, record.stream_time - start_time) * 1e9);
+    frame.seq = record.seq;
+    frame.bpm = record.bpm;
+    // The phase runs 0 -> 1 between beats; a drop means a beat fell in this frame.
+    frame.flags = (record.onset ? SPECTRUM_LOG_ONSET : 0) |
+                  (record.beat_phase + 0.5f < last_beat_phase ? SPECTRUM_LOG_BEAT : 0);
+    frame.chord = static_cast<uint8_t>(record.chord);
+    frame.key = static_cast<uint8_t>(record.key);
+    frame.reserved = 0;
+    last_beat_phase = record.beat_phase;
+    block_frames.push_back(frame);
+
+    for (int i = 0; i < record.num_events; i++) {
+        const NoteEvent &e = record.events[i];
+        SpectrumLogEvent event;
+        event.time_ns = static_cast<uint64_t>(std::max(0.0, e.stream_time - start_time) * 1e9);
+        event.id = e.id;
+        event.type = e.type;
+        event.midi = static_cast<uint8_t>(e.midi);
+        event.reserved = 0;
+        event.value = e.type == NOTE_ON ? e.frequency : e.duration;
+        event.reserved2 = 0;
+        block_events.push_back(event);
+    }
+
+    // Quantise the log magnitude; bins at or below the floor skip the log entirely.
+    const float floor_magnitude = std::pow(10.0f, floor_db / 20.0f);
+    const float scale = 20.0f / step_db;
+    const float offset = floor_db / step_db;
+    const float max_value = static_cast<float>((1 << bits) - 1);
+    uint16_t *out = &block_values[(block_frames.size() - 1) * block_bins];
+    for (int i = 0; i < block_bins; i++) {
+        const float m = record.magnitudes[i];
+        if (m <= floor_magnitude) {
+            out[i] = 0;
+            continue;
+        }
+        const float q = scale * std::log10(m) - offset + 0.5f;
+        out[i] = static_cast<uint16_t>(std::min(max_value, q));
+    }
+
+    if (block_frames.size() == FRAMES_PER_BLOCK) {
+        write_block();
+    }
+}
+
+void SpectrumRecorder::write_layout(const SpectrumRecord &record) {
+    block_bins = record.num_bins;
+    SpectrumLogChunk chunk;
+    chunk.type = SPECTRUM_LOG_LAYOUT;
+    chunk.payload_size = static_cast<uint32_t>(block_bins * sizeof(float));
+    chunk.time_ns = static_cast<uint64_t>(std::max(0.0, record.stream_time - start_time) * 1e9);
+    const uint64_t offset = file_offset;
+    if (put(&chunk, sizeof(chunk)) && put(record.bin_frequency.data(), chunk.payload_size)) {
+        layout_offset = offset;
+    }
+}
+
+void SpectrumRecorder::write_block() {
+    if (block_frames.empty() || failed) {
+        return;
+    }
+
+    SpectrumLogBlock info;
+    info.frame_count = static_cast<uint32_t>(block_frames.size());
+    info.event_count = static_cast<uint32_t>(block_events.size());
+    info.num_bins = static_cast<uint32_t>(block_bins);
+    info.spectra_size = static_cast<uint32_t>(
+        spectrum_log_encode(block_values.data(), static_cast<int>(info.frame_count), block_bins, bits, coded.data()));
+
+    SpectrumLogChunk chunk;
+    chunk.type = SPECTRUM_LOG_BLOCK;
+    chunk.payload_size = static_cast<uint32_t>(sizeof(info) + block_frames.size() * sizeof(SpectrumLogFrame) +
+                                               block_events.size() * sizeof(SpectrumLogEvent) + info.spectra_size);
+    chunk.time_ns = block_frames.front().time_ns;
+
+    SpectrumLogIndexEntry entry;
+    entry.time_ns = chunk.time_ns;
+    entry.offset = file_offset;
+    entry.layout_offset = layout_offset;
+
+    if (put(&chunk, sizeof(chunk)) && put(&info, sizeof(info)) &&
+        put(block_frames.data(), block_frames.size() * sizeof(SpectrumLogFrame)) &&
+        put(block_events.data(), block_events.size() * sizeof(SpectrumLogEvent)) &&
+        put(coded.data(), info.spectra_size)) {
+        index.push_back(entry);
+    }
+    block_frames.clear();
+    block_events.clear();
+}
+
+void SpectrumRecorder::write_index() {
+    if (failed) {
+        return;
+    }
+    SpectrumLogTrailer trailer;
+    std::memcpy(trailer.magic, SPECTRUM_LOG_INDEX_MAGIC, sizeof(trailer.magic));
+    trailer.index_offset = file_offset;
+    trailer.entries = index.size();
+    if (put(index.data(), index.size() * sizeof(SpectrumLogIndexEntry))) {
+        put(&trailer, sizeof(trailer));
+    }
+}
+
+// Appends to the file; on failure (disk full or similar) recording stops, but the show goes on.
+bool SpectrumRecorder::put(const void *data, size_t size) {
+    if (failed) {
+        return false;
+    }
+    if (size > 0 && fwrite(data, size, 1, file) != 1) {
+        std::cerr << "Spectrum recorder: write failed, recording stopped." << std::endl;
+        failed = true;
+        return false;
+    }
+    file_offset += size;
+    return true;
+}
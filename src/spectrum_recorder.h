@@ -0,0 +1,124 @@
+#ifndef _SPECTRUM_RECORDER_H_
+#define _SPECTRUM_RECORDER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "partial_tracker.h"
+#include "spectrum_log.h"
+#include "stage.h"
+
+/**
+ * @brief One analysis frame queued for the spectrum log.
+ */
+struct SpectrumRecord {
+    uint64_t seq;           // Capture block the spectrum was computed from
+    double stream_time;
+    int num_bins;
+    bool new_layout;        // bin_frequency holds the bins of a new analyzer
+    float bpm;
+    float beat_phase;
+    bool onset;
+    int chord;
+    int key;
+    int num_events;
+    NoteEvent events[MAX_NOTE_EVENTS];
+    std::vector<float> magnitudes;
+    std::vector<float> bin_frequency;
+};
+
+/**
+ * @class SpectrumRecorder
+ * @brief Archives every analysis frame to a spectrum log (see spectrum_log.h).
+ *
+ * The feature stage fills a pooled SpectrumRecord (one copy of the spectrum)
+ * and queues it. Quantisation, coding and file writes happen on the
+ * recorder's own thread; if it falls behind, frames are dropped (and counted)
+ * rather than delaying the caller. At 8 bits an hour of music is typically a
+ * few tens of MB.
+ */
+class SpectrumRecorder {
+public:
+    /**
+     * @brief Constructor that creates the log file and writes its header.
+     * @param path File to write; an existing file is replaced.
+     * @param bits 8 or 16 bits per quantised bin.
+     * @param max_bins Most bins any analyzer produces.
+     * @param min_magnitude Detection threshold; the quantisation floor is set below it.
+     * @throws std::runtime_error if the file cannot be created.
+     */
+    SpectrumRecorder(const std::string &path, int bits, int max_bins, double min_magnitude);
+
+    /**
+     * @brief Destructor that writes out queued frames and the index, and closes the file.
+     */
+    ~SpectrumRecorder();
+
+    /**
+     * @brief Starts the writer thread.
+     */
+    void start(std::function<void()> init = std::function<void()>());
+
+    /**
+     * @brief Stops the writer thread after it has written every queued frame, then writes the index.
+     */
+    void stop();
+
+    /**
+     * @brief A free record to fill, or nullptr if the writer is behind. Single producer thread only.
+     */
+    SpectrumRecord *begin_record() { return queue.acquire(); }
+
+    /**
+     * @brief Queues a record obtained from begin_record().
+     */
+    void end_record(SpectrumRecord *record) { queue.send(record); }
+
+    /**
+     * @brief Frames dropped because the writer thread fell behind.
+     */
+    uint64_t dropped_count() const { return queue.dropped_count(); }
+
+    /**
+     * @brief Touches every pooled buffer so it is resident before streaming starts.
+     */
+    void prefault();
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    FILE *file;
+    int bits;
+    float floor_db;
+    float step_db;
+    StageLink<SpectrumRecord> queue;
+    StageThread writer;
+
+    // Writer thread state
+    bool started;
+    bool failed;                     // A write failed; nothing more is recorded
+    bool finished;                   // The index has been written
+    double start_time;               // Stream time of the first frame
+    float last_beat_phase;
+    uint64_t file_offset;            // Bytes written so far
+    uint64_t layout_offset;          // Offset of the LAYOUT chunk in force, 0 if none yet
+    int block_bins;
+    std::vector<SpectrumLogFrame> block_frames;
+    std::vector<SpectrumLogEvent> block_events;
+    std::vector<uint16_t> block_values;
+    std::vector<uint8_t> coded;
+    std::vector<SpectrumLogIndexEntry> index;
+    clock::time_point last_flush;
+
+    void write_step();
+    void add_record(const SpectrumRecord &record);
+    void write_layout(const SpectrumRecord &record);
+    void write_block();
+    void write_index();
+    bool put(const void *data, size_t size);
+};
+
+#endif // _SPECTRUM_RECORDER_H_
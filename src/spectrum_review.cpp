@@ -0,0 +1,221 @@
+// chromesthat_review: inspects a spectrum log recorded with --spectrum-log-path:
+// a summary, the detected notes, beats, chords and keys, or the spectrogram as
+// CSV, for any stretch of the recording.
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+
+#include "harmony.h"
+#include "notes.h"
+#include "partial_tracker.h"
+#include "spectrum_log.h"
+
+void printUsage(const char *program) {
+    std::cout << "Usage: " << program << " LOG [--from SECONDS] [--to SECONDS] [--events | --spectrogram]\n"
+              << "\n  --from SECONDS           Start of the stretch to show (0)\n"
+              << "  --to SECONDS             End of the stretch to show (the end of the log)\n"
+              << "  --events                 List note-ons, note-offs, beats and chord and key changes\n"
+              << "  --spectrogram            Print the spectrum of every frame as CSV: time, then dB per\n"
+              << "                           bin (empty at or below the floor)\n"
+              << "\nWithout --events or --spectrogram, prints a summary of the log." << std::endl;
+}
+
+static void print_summary(SpectrumLogReader &log, const std::string &path) {
+    const SpectrumLogHeader &header = log.header();
+    time_t recorded = static_cast<time_t>(header.start_unix_ns / 1000000000);
+    char when[64];
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&recorded));
+
+    uint64_t frames = 0;
+    uint64_t events = 0;
+    uint64_t beats = 0;
+    double duration = 0;
+    int bins = 0;
+    for (size_t b = 0; b < log.num_blocks(); b++) {
+        if (!log.read_block(b)) {
+            std::cout << "Block " << b << " is damaged; the summary stops there." << std::endl;
+            break;
+        }
+        frames += log.num_frames();
+        events += log.events().size();
+        for (int f = 0; f < log.num_frames(); f++) {
+            beats += (log.frame(f).flags & SPECTRUM_LOG_BEAT) ? 1 : 0;
+        }
+        if (log.num_frames() > 0) {
+            duration = log.frame(log.num_frames() - 1).time_ns / 1e9;
+        }
+        bins = log.num_bins();
+    }
+
+    FILE *file = fopen(path.c_str(), "rb");
+    long bytes = 0;
+    if (file) {
+        fseek(file, 0, SEEK_END);
+        bytes = ftell(file);
+        fclose(file);
+    }
+
+    std::cout << path << ": recorded " << when << ", " << header.bits << " bits per bin ("
+              << header.step_db << " dB steps above " << header.floor_db << " dB)" << std::endl
+              << "  " << duration << " s, " << frames << " frames of " << bins << " bins in " << log.num_blocks()
+              << " blocks" << (log.indexed() ? "" : " (no index: the recording was cut short)") << std::endl
+              << "  " << events << " note events, " << beats << " beats" << std::endl
+              << "  " << bytes << " bytes";
+    if (frames > 0 && duration > 0) {
+        std::cout << ": " << static_cast<double>(bytes) / frames << " bytes per frame, "
+                  << bytes / duration * 3600 / 1e6 << " MB per hour";
+    }
+    std::cout << std::endl;
+}
+
+static void print_events(SpectrumLogReader &log, uint64_t from_ns, uint64_t to_ns) {
+    int chord = -1;
+    int key = -1;
+    for (size_t b = log.find_block(from_ns); b < log.num_blocks() && log.block_entry(b).time_ns < to_ns; b++) {
+        if (!log.read_block(b)) {
+            std::cerr << "Block " << b << " is damaged; skipped." << std::endl;
+            continue;
+        }
+
+        // Frames and events are each in time order; merge them.
+        const std::vector<SpectrumLogEvent> &events = log.events();
+        size_t e = 0;
+        for (int f = 0; f <= log.num_frames(); f++) {
+            const uint64_t frame_ns = f < log.num_frames() ? log.frame(f).time_ns : ~uint64_t(0);
+            for (; e < events.size() && events[e].time_ns <= frame_ns; e++) {
+                const SpectrumLogEvent &ev = events[e];
+                if (ev.time_ns < from_ns || ev.time_ns >= to_ns) {
+                    continue;
+                }
+                std::cout << std::fixed << std::setprecision(3) << ev.time_ns / 1e9 << "  "
+                          << (ev.type == NOTE_ON ? "note on  " : "note off ") << note_name(ev.midi)
+                          << ev.midi / NUM_NOTES - 1 << " #" << ev.id << " ";
+                if (ev.type == NOTE_ON) {
+                    std::cout << std::setprecision(1) << ev.value << " Hz" << std::endl;
+                } else {
+                    std::cout << std::setprecision(3) << ev.value << " s" << std::endl;
+                }
+            }
+            if (f == log.num_frames()) {
+                break;
+            }
+
+            const SpectrumLogFrame &frame = log.frame(f);
+            if (frame.time_ns < from_ns || frame.time_ns >= to_ns) {
+                continue;
+            }
+            if (frame.flags & SPECTRUM_LOG_BEAT) {
+                std::cout << std::fixed << std::setprecision(3) << frame.time_ns / 1e9 << "  beat     "
+                          << std::setprecision(1) << frame.bpm << " BPM" << std::endl;
+            }
+            if (frame.chord != chord || frame.key != key) {
+                chord = frame.chord;
+                key = frame.key;
+                std::cout << std::fixed << std::setprecision(3) << frame.time_ns / 1e9 << "  harmony  "
+                          << harmony_name(chord) << " in " << harmony_name(key) << std::endl;
+            }
+        }
+    }
+}
+
+static void print_spectrogram(SpectrumLogReader &log, uint64_t from_ns, uint64_t to_ns) {
+    std::vector<float> layout;
+    for (size_t b = log.find_block(from_ns); b < log.num_blocks() && log.block_entry(b).time_ns < to_ns; b++) {
+        if (!log.read_block(b)) {
+            std::cerr << "Block " << b << " is damaged; skipped." << std::endl;
+            continue;
+        }
+        // A header row before the first frame and whenever the bins change.
+        if (layout != log.bin_frequency()) {
+            layout = log.bin_frequency();
+            std::cout << "time_s";
+            for (float hz : layout) {
+                std::cout << "," << hz;
+            }
+            std::cout << std::endl;
+        }
+        for (int f = 0; f < log.num_frames(); f++) {
+            const SpectrumLogFrame &frame = log.frame(f);
+            if (frame.time_ns < from_ns || frame.time_ns >= to_ns) {
+                continue;
+            }
+            const uint16_t *values = log.spectrum(f);
+            std::cout << std::fixed << std::setprecision(4) << frame.time_ns / 1e9 << std::setprecision(2);
+            for (int i = 0; i < log.num_bins(); i++) {
+                std::cout << ",";
+                if (values[i] > 0) {
+                    std::cout << log.level_db(values[i]);
+                }
+            }
+            std::cout << "\n";
+        }
+    }
+    std::cout.flush();
+}
+
+int main(int argc, char *argv[]) {
+
+    std::vector<std::string> args(argv + 1, argv + argc);
+    std::string log_path;
+    double from_seconds = 0.0;
+    double to_seconds = -1.0;
+    bool events = false;
+    bool spectrogram = false;
+
+    try {
+        for (size_t i = 0; i < args.size(); i++) {
+            const std::string &arg = args[i];
+            if (arg == "--help" || arg == "-h") {
+                printUsage(argv[0]);
+                return 0;
+            } else if (arg == "--events") {
+                events = true;
+            } else if (arg == "--spectrogram") {
+                spectrogram = true;
+            } else if ((arg == "--from" || arg == "--to") && i + 1 < args.size()) {
+                char *end;
+                double value = std::strtod(args[++i].c_str(), &end);
+                if (*end != '\0' || value < 0) {
+                    throw std::runtime_error("Error: Invalid value '" + args[i] + "' for " + arg + ".");
+                }
+                (arg == "--from" ? from_seconds : to_seconds) = value;
+            } else if (log_path.empty() && arg.compare(0, 2, "--") != 0) {
+                log_path = arg;
+            } else {
+                throw std::runtime_error("Error: Unknown option '" + arg + "'.");
+            }
+        }
+        if (log_path.empty()) {
+            throw std::runtime_error("Error: No spectrum log given.");
+        }
+        if (events && spectrogram) {
+            throw std::runtime_error("Error: Choose --events or --spectrogram, not both.");
+        }
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    try {
+        SpectrumLogReader log(log_path);
+        const uint64_t from_ns = static_cast<uint64_t>(from_seconds * 1e9);
+        const uint64_t to_ns = to_seconds < 0 ? ~uint64_t(0) : static_cast<uint64_t>(to_seconds * 1e9);
+        if (events) {
+            print_events(log, from_ns, to_ns);
+        } else if (spectrogram) {
+            print_spectrogram(log, from_ns, to_ns);
+        } else {
+            print_summary(log, log_path);
+        }
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
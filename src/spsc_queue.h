@@ -0,0 +1,71 @@
+#ifndef _SPSC_QUEUE_H_
+#define _SPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @class SpscQueue
+ * @brief Bounded lock-free queue for exactly one producer and one consumer thread.
+ *
+ * push() and pop() never block or allocate, so they are safe to call from the
+ * audio callback. The capacity is rounded up to a power of two.
+ */
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) : head(0), tail(0) {
+        size_t size = 1;
+        while (size < capacity + 1) {
+            size <<= 1;
+        }
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    /**
+     * @brief Appends an item. Producer thread only.
+     * @return False if the queue is full.
+     */
+    bool push(const T &item) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        const size_t next = (t + 1) & mask;
+        if (next == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        slots[t] = item;
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest item. Consumer thread only.
+     * @return False if the queue is empty.
+     */
+    bool pop(T &item) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = slots[h];
+        head.store((h + 1) & mask, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Number of queued items; exact only when both sides are idle.
+     */
+    size_t size() const {
+        return (tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire)) & mask;
+    }
+
+private:
+    std::vector<T> slots;
+    size_t mask;
+    // Producer and consumer indices on separate cache lines to avoid false sharing.
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+};
+
+#endif // _SPSC_QUEUE_H_
@@ -0,0 +1,206 @@
+#ifndef _STAGE_H_
+#define _STAGE_H_
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <semaphore.h>
+#include <string>
+#include <thread>
+
+#include "buffer_pool.h"
+#include "spsc_queue.h"
+
+/**
+ * @brief What a link does when its consumer falls behind.
+ */
+enum DropPolicy {
+    DROP_NEWEST, // A full queue rejects new buffers (the producer reuses them)
+    KEEP_LATEST  // The consumer skips to the newest buffer and recycles the rest
+};
+
+/**
+ * @class StageLink
+ * @brief Connects two pipeline stages: a buffer pool plus a bounded lock-free queue.
+ *
+ * The producer acquires a buffer, fills it and sends it; the consumer receives
+ * it by pointer and releases it back to the pool. All calls are non-blocking
+ * except receive(), which waits on a semaphore that send() posts, so the
+ * producer side is safe to use from the audio callback.
+ */
+template <typename T>
+class StageLink {
+public:
+    /**
+     * @brief Constructor.
+     * @param count Number of buffers in flight between the two stages.
+     * @param policy What to drop when the consumer falls behind.
+     * @param init Called once per buffer to size it.
+     */
+    template <typename Init>
+    StageLink(size_t count, DropPolicy policy, Init init)
+        : pool(count, init), queue(count), policy(policy), spare(nullptr), dropped(0) {
+        sem_init(&ready, 0, 0);
+    }
+
+    ~StageLink() {
+        sem_destroy(&ready);
+    }
+
+    /**
+     * @brief Gets an empty buffer to fill. Producer thread only.
+     * @return nullptr if every buffer is in flight.
+     */
+    T *acquire() {
+        if (spare) {
+            T *buf = spare;
+            spare = nullptr;
+            return buf;
+        }
+        T *buf = pool.acquire();
+        if (!buf) {
+            dropped++;
+        }
+        return buf;
+    }
+
+    /**
+     * @brief Passes a filled buffer to the consumer. Producer thread only.
+     * @return False if the queue was full and the buffer was dropped.
+     */
+    bool send(T *buf) {
+        if (!queue.push(buf)) {
+            // Only the consumer may release to the pool; keep it for the next acquire().
+            spare = buf;
+            dropped++;
+            return false;
+        }
+        sem_post(&ready);
+        return true;
+    }
+
+    /**
+     * @brief Takes the next buffer without waiting. Consumer thread only.
+     * @return nullptr if nothing is queued. With KEEP_LATEST, older buffers are skipped.
+     */
+    T *try_receive() {
+        T *buf = nullptr;
+        if (!queue.pop(buf)) {
+            return nullptr;
+        }
+        if (policy == KEEP_LATEST) {
+            T *newer;
+            while (queue.pop(newer)) {
+                pool.release(buf);
+                dropped++;
+                buf = newer;
+            }
+        }
+        return buf;
+    }
+
+    /**
+     * @brief Waits up to timeout_ms for a buffer. Consumer thread only.
+     * @return nullptr on timeout.
+     */
+    T *receive(int timeout_ms) {
+        T *buf = try_receive();
+        if (buf) {
+            return buf;
+        }
+
+        timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += static_cast<long>(timeout_ms) * 1000000;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000;
+        deadline.tv_nsec %= 1000000000;
+        // Posts outnumber buffers when KEEP_LATEST skips some; an empty wake-up is harmless.
+        while (sem_timedwait(&ready, &deadline) == 0) {
+            buf = try_receive();
+            if (buf) {
+                return buf;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Returns a consumed buffer to the pool. Consumer thread only.
+     */
+    void release(T *buf) {
+        pool.release(buf);
+    }
+
+    /**
+     * @brief Buffers dropped so far, by either side.
+     */
+    uint64_t dropped_count() const { return dropped; }
+
+    /**
+     * @brief Visits every buffer. Only while no stage is running.
+     */
+    template <typename Fn>
+    void for_each(Fn fn) { pool.for_each(fn); }
+
+private:
+    BufferPool<T> pool;
+    SpscQueue<T*> queue;
+    DropPolicy policy;
+    T *spare; // Producer-owned buffer that could not be sent
+    std::atomic<uint64_t> dropped;
+    sem_t ready;
+};
+
+/**
+ * @class StageThread
+ * @brief Runs one pipeline stage's step function in a loop on its own thread.
+ *
+ * The step function should block briefly on its input (e.g. receive() with a
+ * timeout) so stop() is noticed promptly.
+ */
+class StageThread {
+public:
+    StageThread(const std::string &name, std::function<void()> step)
+        : name(name), step(step), running(false) {}
+
+    ~StageThread() {
+        stop();
+    }
+
+    /**
+     * @brief Starts the thread. init, if set, runs on the thread before the first step.
+     */
+    void start(std::function<void()> init = std::function<void()>()) {
+        running = true;
+        thread = std::thread([this, init]() {
+            if (init) {
+                init();
+            }
+            while (running) {
+                step();
+            }
+        });
+    }
+
+    /**
+     * @brief Stops the thread and waits for it to exit.
+     */
+    void stop() {
+        running = false;
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    const std::string &stage_name() const { return name; }
+
+private:
+    std::string name;
+    std::function<void()> step;
+    std::atomic<bool> running;
+    std::thread thread;
+};
+
+#endif // _STAGE_H_
@@ -0,0 +1,83 @@
+#include "window.h"
+
+#include <cmath>
+#include <stdexcept>
+
+/**
+ * @brief Parses a window name ("rectangular", "hann", "blackman-harris", "kaiser").
+ * @throws std::runtime_error for unknown names.
+ */
+WindowType window_from_name(const std::string &name) {
+    if (name == "rectangular" || name == "none") return WINDOW_RECTANGULAR;
+    if (name == "hann")                          return WINDOW_HANN;
+    if (name == "blackman-harris" || name == "blackman_harris") return WINDOW_BLACKMAN_HARRIS;
+    if (name == "kaiser")                        return WINDOW_KAISER;
+    throw std::runtime_error("Error: Unknown window '" + name +
+                             "' (supported: rectangular, hann, blackman-harris, kaiser).");
+}
+
+/**
+ * @brief The name window_from_name() accepts for a window.
+ */
+const char *window_name(WindowType type) {
+    switch (type) {
+    case WINDOW_RECTANGULAR:     return "rectangular";
+    case WINDOW_HANN:            return "hann";
+    case WINDOW_BLACKMAN_HARRIS: return "blackman-harris";
+    case WINDOW_KAISER:          return "kaiser";
+    }
+    return "unknown";
+}
+
+// Zeroth-order modified Bessel function of the first kind, by its power series.
+static double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    double q = x * x / 4.0;
+    for (int k = 1; k < 64 && term > sum * 1e-17; k++) {
+        term *= q / (static_cast<double>(k) * k);
+        sum += term;
+    }
+    return sum;
+}
+
+/**
+ * @brief Fills out with a periodic window of the given length, scaled to unit mean.
+ * @param type Which window.
+ * @param kaiser_beta Shape parameter, only used by WINDOW_KAISER.
+ * @param out Output, size values.
+ * @param size Window length in samples.
+ */
+void window_fill(WindowType type, double kaiser_beta, double *out, int size) {
+    // Periodic (DFT-even) windows: the period is size, not size - 1.
+    const double step = 2.0 * M_PI / size;
+    const double kaiser_norm = bessel_i0(kaiser_beta);
+
+    double sum = 0;
+    for (int i = 0; i < size; i++) {
+        double w = 1.0;
+        switch (type) {
+        case WINDOW_RECTANGULAR:
+            break;
+        case WINDOW_HANN:
+            w = 0.5 - 0.5 * std::cos(step * i);
+            break;
+        case WINDOW_BLACKMAN_HARRIS:
+            w = 0.35875 - 0.48829 * std::cos(step * i) + 0.14128 * std::cos(2 * step * i) -
+                0.01168 * std::cos(3 * step * i);
+            break;
+        case WINDOW_KAISER: {
+            double r = 2.0 * i / size - 1.0;
+            w = bessel_i0(kaiser_beta * std::sqrt(1.0 - r * r)) / kaiser_norm;
+            break;
+        }
+        }
+        out[i] = w;
+        sum += w;
+    }
+
+    const double scale = size / sum;
+    for (int i = 0; i < size; i++) {
+        out[i] *= scale;
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef _WINDOW_H_
+#define _WINDOW_H_
+
+#include <string>
+
+/**
+ * @brief Analysis window applied to each FFT frame.
+ */
+enum WindowType {
+    WINDOW_RECTANGULAR,     // No window (strong leakage)
+    WINDOW_HANN,            // Good general choice, -31 dB first sidelobe
+    WINDOW_BLACKMAN_HARRIS, // 4-term, -92 dB sidelobes but a wider main lobe
+    WINDOW_KAISER           // Sidelobe/main lobe trade-off set by beta
+};
+
+/**
+ * @brief Parses a window name ("rectangular", "hann", "blackman-harris", "kaiser").
+ * @throws std::runtime_error for unknown names.
+ */
+WindowType window_from_name(const std::string &name);
+
+/**
+ * @brief The name window_from_name() accepts for a window.
+ */
+const char *window_name(WindowType type);
+
+/**
+ * @brief Fills out with a periodic window of the given length.
+ *
+ * The window is scaled so its mean is 1 (unit coherent gain): a sine centred
+ * on a bin gives the same peak magnitude whatever the window, so note
+ * thresholds stay comparable when switching windows.
+ * @param type Which window.
+ * @param kaiser_beta Shape parameter, only used by WINDOW_KAISER.
+ * @param out Output, size values.
+ * @param size Window length in samples.
+ */
+void window_fill(WindowType type, double kaiser_beta, double *out, int size);
+
+#endif // _WINDOW_H_